@@ -0,0 +1,56 @@
+QT += core gui sql
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += c++14
+
+TARGET = DownloadAssistant
+
+# MSVC specific settings
+msvc {
+    QMAKE_CXXFLAGS += /Zc:__cplusplus
+    QMAKE_CXXFLAGS += /std:c++17
+    QMAKE_CXXFLAGS += /permissive-
+}
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+include(../core/core.pri)
+
+SRC_DIR = $$PWD/../src
+
+SOURCES += \
+    $$SRC_DIR/main.cpp \
+    $$SRC_DIR/mainwindow.cpp \
+    $$SRC_DIR/tasktablewidget.cpp \
+    $$SRC_DIR/filebrowserdialog.cpp
+
+HEADERS += \
+    $$SRC_DIR/mainwindow.h \
+    $$SRC_DIR/tasktablewidget.h \
+    $$SRC_DIR/filebrowserdialog.h
+
+FORMS += \
+    $$SRC_DIR/mainwindow.ui
+
+RESOURCES += $$PWD/../DownloadAssistant.qrc
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
+
+# Windows specific settings
+win32 {
+    LIBS += -lws2_32 -liphlpapi
+    DEFINES += WIN32_LEAN_AND_MEAN
+}
+
+# Release configuration
+CONFIG(release, debug|release) {
+    DESTDIR = release
+} else {
+    DESTDIR = debug
+}
@@ -0,0 +1,25 @@
+# 任务记账基准：用不做 I/O 的下载器驱动 DownloadManager，测量添加、保存、加载、状态切换和查询
+QT = core sql network concurrent
+CONFIG += console c++14
+CONFIG -= app_bundle
+
+TARGET = bookkeeping
+
+# MSVC specific settings
+msvc {
+    QMAKE_CXXFLAGS += /Zc:__cplusplus
+    QMAKE_CXXFLAGS += /std:c++17
+    QMAKE_CXXFLAGS += /permissive-
+}
+
+include(../../core/core.pri)
+
+INCLUDEPATH += $$PWD/../common
+HEADERS += $$PWD/../common/sampledata.h
+
+SOURCES += \
+    main.cpp
+
+win32 {
+    DEFINES += WIN32_LEAN_AND_MEAN
+}
@@ -0,0 +1,352 @@
+// 任务记账基准：用不做任何 I/O 的下载器驱动 DownloadManager，
+// 测量任务数为 1k/10k/100k/1M 时添加、批量添加、保存、加载、状态切换和状态查询的耗时。
+// 任务数据库照常写入（SQLite 是记账成本的一部分），日志默认只记录警告以上，避免控制台输出淹没结果。
+//
+// 用法：bookkeeping [--sizes 1000,10000,100000,1000000] [--root 目录] [--output 文件]
+//                   [--baseline 上次结果.json] [--tolerance 0.25]
+// 给出 --baseline 时与上次结果逐项比较每次操作的耗时，超出容差的项输出到标准错误，退出码为 2。
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QSysInfo>
+#include <QTextStream>
+#include "downloader.h"
+#include "downloadmanager.h"
+#include "logger.h"
+#include "pathutils.h"
+#include "sampledata.h"
+
+namespace {
+
+// 逐个 addTask 每次都单独提交事务，超过这个数量只测量前面一部分
+const int kDefaultSingleAddLimit = 10000;
+// 参与开始、暂停、继续、完成的任务数上限
+const int kDefaultTransitionLimit = 10000;
+// 状态栏刷新的模拟次数
+const int kStatusQueryRounds = 1000;
+// 界面刷新任务列表的模拟次数和显示的等待任务数
+const int kVisibleTaskRounds = 20;
+const int kVisiblePendingTasks = 500;
+// 总耗时低于此值的项噪声太大，不参与基线比较
+const double kMinComparableMs = 5.0;
+
+// 只改状态、发信号的下载器，完成由基准主动触发
+class NoopDownloader : public Downloader
+{
+public:
+    bool startDownload(DownloadTask *task) override
+    {
+        task->setStatus(DownloadTask::Downloading);
+        m_running.insert(task);
+        emit downloadStarted(task);
+        return true;
+    }
+
+    void pauseDownload(DownloadTask *task) override
+    {
+        if (!m_running.contains(task))
+            return;
+        task->setStatus(DownloadTask::Paused);
+        emit downloadPaused(task);
+    }
+
+    void resumeDownload(DownloadTask *task) override
+    {
+        if (task->status() != DownloadTask::Paused)
+            return;
+        if (!m_running.contains(task)) {
+            startDownload(task);
+            return;
+        }
+        task->setStatus(DownloadTask::Downloading);
+        emit downloadResumed(task);
+    }
+
+    void cancelDownload(DownloadTask *task) override
+    {
+        if (!m_running.remove(task))
+            return;
+        task->setStatus(DownloadTask::Cancelled);
+        emit downloadCancelled(task);
+    }
+
+    void complete(DownloadTask *task)
+    {
+        if (!m_running.remove(task))
+            return;
+        emit downloadCompleted(task);
+    }
+
+private:
+    QSet<DownloadTask*> m_running;
+};
+
+class Recorder
+{
+public:
+    explicit Recorder(int tasks) : m_tasks(tasks) {}
+
+    void start() { m_timer.start(); }
+
+    void stop(const QString &operation, int count)
+    {
+        qint64 nsecs = m_timer.nsecsElapsed();
+        QJsonObject result;
+        result["tasks"] = m_tasks;
+        result["operation"] = operation;
+        result["count"] = count;
+        result["totalMs"] = nsecs / 1e6;
+        result["usPerOp"] = count > 0 ? nsecs / 1e3 / count : 0.0;
+        m_results.append(result);
+        QTextStream(stderr) << QString("  %1 %2: %3 次，%4 ms")
+                                   .arg(m_tasks).arg(operation).arg(count)
+                                   .arg(nsecs / 1e6, 0, 'f', 1)
+                            << Qt::endl;
+    }
+
+    const QJsonArray &results() const { return m_results; }
+
+private:
+    int m_tasks;
+    QElapsedTimer m_timer;
+    QJsonArray m_results;
+};
+
+void useFreshDataDirectory(const QString &path)
+{
+    QDir dir(path);
+    dir.removeRecursively();
+    dir.mkpath(".");
+    setDataDirectory(path);
+}
+
+QJsonArray runSize(int tasks, const QString &root, int singleAddLimit, int transitionLimit)
+{
+    Recorder recorder(tasks);
+
+    // 逐个添加：每个任务一次数据库提交
+    useFreshDataDirectory(QDir(root).filePath(QString("n%1-single").arg(tasks)));
+    {
+        DownloadManager manager(new NoopDownloader);
+        int count = qMin(tasks, singleAddLimit);
+        recorder.start();
+        for (int i = 0; i < count; ++i)
+            manager.addTask(sampleUrl(i), sampleSavePath(i));
+        recorder.stop("addTask", count);
+    }
+
+    QString bulkDir = QDir(root).filePath(QString("n%1-bulk").arg(tasks));
+    useFreshDataDirectory(bulkDir);
+    NoopDownloader *downloader = new NoopDownloader;
+    DownloadManager *manager = new DownloadManager(downloader);
+    // 并发上限放开到参与状态切换的任务数，测量的是记账而不是排队
+    manager->setConcurrencyLimits(transitionLimit, transitionLimit);
+
+    QStringList urls;
+    urls.reserve(tasks);
+    for (int i = 0; i < tasks; ++i)
+        urls.append(sampleUrl(i));
+    recorder.start();
+    const QStringList taskIds = manager->addTasks(urls, sampleSavePath(0));
+    recorder.stop("addTasks", tasks);
+    urls.clear();
+
+    recorder.start();
+    manager->saveTasks();
+    recorder.stop("saveTasks", tasks);
+
+    // 与主窗口刷新状态栏时的查询相同
+    recorder.start();
+    qint64 checksum = 0;
+    for (int round = 0; round < kStatusQueryRounds; ++round) {
+        checksum += manager->taskCount();
+        checksum += manager->taskCount(DownloadTask::Downloading);
+        checksum += manager->taskCount(DownloadTask::Pending);
+        checksum += manager->taskCount(DownloadTask::Paused);
+        checksum += manager->historyCount(DownloadManager::CompletedHistory);
+        checksum += manager->historyCount(DownloadManager::FailedHistory);
+    }
+    recorder.stop("statusQuery", kStatusQueryRounds);
+
+    recorder.start();
+    for (int round = 0; round < kVisibleTaskRounds; ++round)
+        checksum += manager->getVisibleTasks(kVisiblePendingTasks).size();
+    recorder.stop("visibleTasks", kVisibleTaskRounds);
+
+    // 状态切换：暂停和完成会让队列启动下一个等待任务，这部分开销计入各自的阶段
+    const QStringList moving = taskIds.mid(0, qMin(tasks, transitionLimit));
+    recorder.start();
+    for (const QString &taskId : moving)
+        manager->startTask(taskId);
+    recorder.stop("startTask", moving.size());
+
+    recorder.start();
+    for (const QString &taskId : moving)
+        manager->pauseTask(taskId);
+    recorder.stop("pauseTask", moving.size());
+
+    recorder.start();
+    for (const QString &taskId : moving)
+        manager->resumeTask(taskId);
+    recorder.stop("resumeTask", moving.size());
+
+    recorder.start();
+    for (const QString &taskId : moving) {
+        DownloadTask *task = manager->getTask(taskId);
+        if (task && task->status() == DownloadTask::Downloading)
+            downloader->complete(task);
+    }
+    // 结束的任务在外观对象销毁后才释放记录槽位，计入完成阶段
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    recorder.stop("completeTask", moving.size());
+
+    // 析构时保存全部未完成任务
+    int remaining = manager->taskCount();
+    recorder.start();
+    delete manager;
+    recorder.stop("shutdown", remaining);
+
+    recorder.start();
+    manager = new DownloadManager(new NoopDownloader);
+    recorder.stop("loadTasks", manager->taskCount());
+    delete manager;
+
+    Q_UNUSED(checksum);
+    return recorder.results();
+}
+
+QString resultKey(const QJsonObject &result)
+{
+    return QString("%1/%2").arg(result["tasks"].toInt()).arg(result["operation"].toString());
+}
+
+// 与基线逐项比较，返回超出容差的项数
+int compareWithBaseline(QJsonArray &results, const QJsonArray &baseline, double tolerance,
+                        QTextStream &err)
+{
+    QHash<QString, QJsonObject> previous;
+    for (const QJsonValue &value : baseline)
+        previous.insert(resultKey(value.toObject()), value.toObject());
+
+    int regressions = 0;
+    for (int i = 0; i < results.size(); ++i) {
+        QJsonObject result = results.at(i).toObject();
+        QJsonObject base = previous.value(resultKey(result));
+        if (base.isEmpty() || base["totalMs"].toDouble() < kMinComparableMs ||
+            base["usPerOp"].toDouble() <= 0)
+            continue;
+        double ratio = result["usPerOp"].toDouble() / base["usPerOp"].toDouble();
+        result["baselineUsPerOp"] = base.value("usPerOp");
+        result["ratio"] = ratio;
+        results.replace(i, result);
+        if (ratio > 1.0 + tolerance) {
+            ++regressions;
+            err << QString("变慢: %1 %2 us/次 -> %3 us/次（%4 倍）")
+                       .arg(resultKey(result))
+                       .arg(base["usPerOp"].toDouble(), 0, 'f', 2)
+                       .arg(result["usPerOp"].toDouble(), 0, 'f', 2)
+                       .arg(ratio, 0, 'f', 2)
+                << Qt::endl;
+        }
+    }
+    return regressions;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("bookkeeping");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("DownloadAssistant 任务记账基准");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "任务数，逗号分隔。", "list", "1000,10000,100000,1000000");
+    QCommandLineOption rootOption("root", "任务数据库所在的工作目录。", "dir",
+                                  QDir(QDir::tempPath()).filePath("bookkeeping-bench"));
+    QCommandLineOption singleOption("single-limit", "逐个添加测量的任务数上限。", "count",
+                                    QString::number(kDefaultSingleAddLimit));
+    QCommandLineOption transitionOption("transition-limit", "状态切换测量的任务数上限。", "count",
+                                        QString::number(kDefaultTransitionLimit));
+    QCommandLineOption outputOption("output", "JSON 结果写入的文件，默认输出到标准输出。", "file");
+    QCommandLineOption baselineOption("baseline", "与之比较的上次结果。", "file");
+    QCommandLineOption toleranceOption("tolerance", "允许的变慢比例。", "ratio", "0.25");
+    QCommandLineOption verboseOption("verbose-log", "按默认级别记录日志。");
+    parser.addOptions({sizesOption, rootOption, singleOption, transitionOption, outputOption,
+                       baselineOption, toleranceOption, verboseOption});
+    parser.process(app);
+
+    QString root = QDir(parser.value(rootOption)).absolutePath();
+    QTextStream err(stderr);
+
+    QJsonArray baseline;
+    if (parser.isSet(baselineOption)) {
+        QFile file(parser.value(baselineOption));
+        if (!file.open(QIODevice::ReadOnly)) {
+            err << "无法读取基线: " << file.fileName() << Qt::endl;
+            return 1;
+        }
+        baseline = QJsonDocument::fromJson(file.readAll()).object()["results"].toArray();
+    }
+
+    // 日志目录取创建日志时的数据目录，先创建，固定在工作目录下
+    setDataDirectory(root);
+    QDir().mkpath(root);
+    Logger *logger = Logger::instance();
+    if (!parser.isSet(verboseOption))
+        logger->setLogLevel(Logger::Warning);
+
+    QJsonArray sizes;
+    QJsonArray results;
+    const QStringList sizeList = parser.value(sizesOption).split(',', Qt::SkipEmptyParts);
+    for (const QString &text : sizeList) {
+        int tasks = text.trimmed().toInt();
+        if (tasks <= 0) {
+            err << "无效的任务数: " << text << Qt::endl;
+            return 1;
+        }
+        sizes.append(tasks);
+        err << "任务数 " << tasks << Qt::endl;
+        const QJsonArray sizeResults = runSize(tasks, root, parser.value(singleOption).toInt(),
+                                               parser.value(transitionOption).toInt());
+        for (const QJsonValue &value : sizeResults)
+            results.append(value);
+    }
+
+    int regressions = 0;
+    if (!baseline.isEmpty())
+        regressions = compareWithBaseline(results, baseline, parser.value(toleranceOption).toDouble(), err);
+
+    QJsonObject report;
+    report["benchmark"] = "bookkeeping";
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["platform"] = QSysInfo::prettyProductName();
+    report["cpu"] = QSysInfo::currentCpuArchitecture();
+    report["sizes"] = sizes;
+    report["results"] = results;
+    if (!baseline.isEmpty())
+        report["regressions"] = regressions;
+    QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "无法写入: " << file.fileName() << Qt::endl;
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return regressions > 0 ? 2 : 0;
+}
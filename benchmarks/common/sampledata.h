@@ -0,0 +1,21 @@
+#ifndef SAMPLEDATA_H
+#define SAMPLEDATA_H
+
+#include <QString>
+
+// 基准测试共用的任务样本：第 i 个任务的地址和保存路径。
+// 每 100 个任务共用一个远程目录，每 10000 个任务共用一个保存目录，
+// 各基准使用同一份数据，结果可以互相对照。
+
+inline QString sampleUrl(int i)
+{
+    return QString("//fileserver/share/projects/batch%1/folder%2/file%3.dat")
+        .arg(i / 10000).arg(i / 100 % 100).arg(i);
+}
+
+inline QString sampleSavePath(int i)
+{
+    return QString("D:/Downloads/batch%1").arg(i / 10000);
+}
+
+#endif // SAMPLEDATA_H
@@ -0,0 +1,23 @@
+# 传输引擎吞吐基准：在本地目录模拟共享，用真实的 DownloadManager 复制合成目录树
+QT = core sql network concurrent
+CONFIG += console c++14
+CONFIG -= app_bundle
+
+TARGET = copyengine
+
+# MSVC specific settings
+msvc {
+    QMAKE_CXXFLAGS += /Zc:__cplusplus
+    QMAKE_CXXFLAGS += /std:c++17
+    QMAKE_CXXFLAGS += /permissive-
+}
+
+include(../../core/core.pri)
+
+SOURCES += \
+    main.cpp
+
+win32 {
+    DEFINES += WIN32_LEAN_AND_MEAN
+    LIBS += -lpsapi
+}
@@ -0,0 +1,406 @@
+// 传输引擎吞吐基准：在本地目录（建议用 tmpfs，如 /dev/shm）中生成合成的源目录树
+// 代替共享，通过 DownloadManager 走完整的添加、扫描、复制流程，输出 JSON 结果。
+//
+// 用法：copyengine [--root 目录] [--shapes huge,tiny,mixed] [--scale 比例] [--seed 种子]
+//                  [--simulate 参数] [--output 文件]
+// 源目录树：
+//   huge   一个 1 GiB 的文件（文件任务）
+//   tiny   100000 个 1~4 KiB 的小文件，每个子目录 1000 个（目录任务）
+//   mixed  1000 个文件，大小在 1 KiB~8 MiB 间按对数均匀分布（目录任务）
+// 文件数和大小乘以 --scale。源目录树生成后保留在 <root>/share 中，参数不变时下次直接复用。
+// 每种目录树在独立的子进程中测量，峰值内存和系统调用次数互不影响；
+// 统计的是整个进程，包含任务数据库和日志的开销，与实际运行时一致。
+// --simulate 让读取经过 SimulatedSourceDevice，注入远程共享的延迟、限速、错误和卡顿，
+// 例如 --simulate latency=20,jitter=5,bandwidth=10M,errors=0.001，参数格式见 simulatedsourcedevice.h。
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QTimer>
+#include <cmath>
+#include "downloadmanager.h"
+#include "pathutils.h"
+#include "simulatedsourcedevice.h"
+#include "sourcedevice.h"
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+const qint64 KiB = 1024;
+const qint64 MiB = 1024 * KiB;
+const qint64 GiB = 1024 * MiB;
+const int kTinyFilesPerDir = 1000;
+// 生成文件时反复写出的随机数据块
+const int kFillBlockSize = 1024 * 1024;
+
+struct TreeSpec {
+    int files;
+    qint64 bytes;
+};
+
+// 进程累计的资源用量，syscall 计数不可用时为 -1
+struct ResourceUsage {
+    double userSeconds;
+    double systemSeconds;
+    qint64 peakRssBytes;
+    qint64 readCalls;
+    qint64 writeCalls;
+};
+
+ResourceUsage resourceUsage()
+{
+    ResourceUsage usage = {0.0, 0.0, 0, -1, -1};
+#if defined(Q_OS_WIN)
+    FILETIME creation, exit, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        // FILETIME 以 100 纳秒为单位
+        auto seconds = [](const FILETIME &time) {
+            ULARGE_INTEGER value;
+            value.LowPart = time.dwLowDateTime;
+            value.HighPart = time.dwHighDateTime;
+            return static_cast<double>(value.QuadPart) / 1e7;
+        };
+        usage.userSeconds = seconds(user);
+        usage.systemSeconds = seconds(kernel);
+    }
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        usage.peakRssBytes = static_cast<qint64>(counters.PeakWorkingSetSize);
+    IO_COUNTERS io;
+    if (GetProcessIoCounters(GetCurrentProcess(), &io)) {
+        usage.readCalls = static_cast<qint64>(io.ReadOperationCount);
+        usage.writeCalls = static_cast<qint64>(io.WriteOperationCount);
+    }
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        usage.userSeconds = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+        usage.systemSeconds = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+#if defined(Q_OS_MACOS)
+        usage.peakRssBytes = ru.ru_maxrss;
+#else
+        usage.peakRssBytes = static_cast<qint64>(ru.ru_maxrss) * KiB;
+#endif
+    }
+#if defined(Q_OS_LINUX)
+    // syscr/syscw 为进程发起的读写类系统调用次数
+    QFile io("/proc/self/io");
+    if (io.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> lines = io.readAll().split('\n');
+        for (const QByteArray &line : lines) {
+            if (line.startsWith("syscr:"))
+                usage.readCalls = line.mid(6).trimmed().toLongLong();
+            else if (line.startsWith("syscw:"))
+                usage.writeCalls = line.mid(6).trimmed().toLongLong();
+        }
+    }
+#endif
+#endif
+    return usage;
+}
+
+QString shareDir(const QString &root, const QString &shape)
+{
+    return QDir(root).filePath("share/bench/" + shape);
+}
+
+// 基准中使用的共享地址：非 Windows 以 <root>/share 为挂载根，经 toUncPath 映射，
+// 与守护进程访问挂载共享的路径一致；Windows 上直接使用本地路径
+QString shareUrl(const QString &root, const QString &shape)
+{
+#ifdef Q_OS_WIN
+    return QDir::toNativeSeparators(shareDir(root, shape));
+#else
+    Q_UNUSED(root);
+    return "//bench/" + shape;
+#endif
+}
+
+QList<qint64> fileSizes(const QString &shape, double scale, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    QList<qint64> sizes;
+    if (shape == "huge") {
+        sizes.append(qMax<qint64>(1, static_cast<qint64>(GiB * scale)));
+    } else if (shape == "tiny") {
+        int count = qMax(1, static_cast<int>(100000 * scale));
+        for (int i = 0; i < count; ++i)
+            sizes.append(KiB + random.bounded(3 * KiB + 1));
+    } else if (shape == "mixed") {
+        int count = qMax(1, static_cast<int>(1000 * scale));
+        const double minLog = std::log(static_cast<double>(KiB));
+        const double maxLog = std::log(static_cast<double>(8 * MiB));
+        for (int i = 0; i < count; ++i)
+            sizes.append(static_cast<qint64>(std::exp(minLog + random.generateDouble() * (maxLog - minLog))));
+    }
+    return sizes;
+}
+
+QString relativeFilePath(const QString &shape, int index)
+{
+    if (shape == "huge")
+        return "huge.bin";
+    return QString("d%1/f%2.dat").arg(index / kTinyFilesPerDir, 3, 10, QChar('0')).arg(index);
+}
+
+bool writeFile(const QString &path, qint64 size, const QByteArray &block)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    qint64 written = 0;
+    while (written < size) {
+        qint64 chunk = qMin<qint64>(block.size(), size - written);
+        // 每个文件从不同偏移开始，避免内容完全相同
+        qint64 offset = (written + size) % (block.size() - chunk + 1);
+        if (file.write(block.constData() + offset, chunk) != chunk)
+            return false;
+        written += chunk;
+    }
+    return true;
+}
+
+// 生成源目录树，旁边的 <树名>.spec 记录生成参数，参数相同则直接复用
+bool prepareTree(const QString &root, const QString &shape, double scale, quint32 seed,
+                 TreeSpec *spec, QTextStream &log)
+{
+    const QList<qint64> sizes = fileSizes(shape, scale, seed);
+    spec->files = sizes.size();
+    spec->bytes = 0;
+    for (qint64 size : sizes)
+        spec->bytes += size;
+
+    QDir dir(shareDir(root, shape));
+    QByteArray marker = QString("%1 %2 %3\n").arg(scale).arg(seed).arg(spec->bytes).toUtf8();
+    QFile specFile(dir.absolutePath() + ".spec");
+    if (specFile.open(QIODevice::ReadOnly) && specFile.readAll() == marker)
+        return true;
+    specFile.close();
+    specFile.remove();
+
+    log << "生成源目录树 " << shape << ": " << spec->files << " 个文件，"
+        << spec->bytes << " 字节" << Qt::endl;
+    dir.removeRecursively();
+    if (!dir.mkpath("."))
+        return false;
+
+    QByteArray block(kFillBlockSize, Qt::Uninitialized);
+    QRandomGenerator random(seed);
+    random.fillRange(reinterpret_cast<quint32*>(block.data()), block.size() / sizeof(quint32));
+
+    for (int i = 0; i < sizes.size(); ++i) {
+        QString path = dir.filePath(relativeFilePath(shape, i));
+        if (i % kTinyFilesPerDir == 0)
+            QDir().mkpath(QFileInfo(path).absolutePath());
+        if (!writeFile(path, sizes.at(i), block))
+            return false;
+    }
+
+    // 生成完成后才写入，生成中断时下次会重新生成
+    if (!specFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    specFile.write(marker);
+    return true;
+}
+
+TreeSpec countTree(const QString &path)
+{
+    TreeSpec spec = {0, 0};
+    QDirIterator it(path, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        ++spec.files;
+        spec.bytes += it.fileInfo().size();
+    }
+    return spec;
+}
+
+// 子进程：用新的数据目录和目标目录复制一种源目录树，输出一行 JSON
+int runShape(QCoreApplication &app, const QString &root, const QString &shape, const TreeSpec &source)
+{
+    QDir runDir(QDir(root).filePath("run-" + shape));
+    runDir.removeRecursively();
+    runDir.mkpath("data");
+    runDir.mkpath("dest");
+    // 数据目录必须在日志和下载管理器创建之前设置
+    setDataDirectory(runDir.filePath("data"));
+    setShareMountRoot(QDir(root).filePath("share"));
+    QString destPath = runDir.filePath("dest");
+
+    QJsonObject result;
+    result["shape"] = shape;
+    QString error;
+    {
+        DownloadManager manager;
+        QObject::connect(&manager, &DownloadManager::taskCompleted, &app, &QCoreApplication::quit);
+        QObject::connect(&manager, &DownloadManager::taskFailed, [&](const QString &, const QString &message) {
+            error = message.isEmpty() ? QString("failed") : message;
+            app.quit();
+        });
+
+        QString url = shareUrl(root, shape);
+        QString taskId = shape == "huge" ? manager.addTask(url + "/huge.bin", destPath)
+                                         : manager.addDirectoryTask(url, destPath);
+
+        ResourceUsage before = resourceUsage();
+        QElapsedTimer timer;
+        timer.start();
+        // 在事件循环中启动，任务即使立即结束，退出请求也不会丢失
+        QTimer::singleShot(0, &manager, [&manager, taskId]() { manager.startTask(taskId); });
+        app.exec();
+        double seconds = timer.nsecsElapsed() / 1e9;
+        ResourceUsage after = resourceUsage();
+
+        TreeSpec copied = countTree(destPath);
+        result["files"] = copied.files;
+        result["bytes"] = copied.bytes;
+        result["seconds"] = seconds;
+        result["mbPerSec"] = seconds > 0 ? copied.bytes / static_cast<double>(MiB) / seconds : 0.0;
+        result["filesPerSec"] = seconds > 0 ? copied.files / seconds : 0.0;
+        result["cpuUserSec"] = after.userSeconds - before.userSeconds;
+        result["cpuSystemSec"] = after.systemSeconds - before.systemSeconds;
+        result["peakRssBytes"] = after.peakRssBytes;
+        result["readSyscalls"] = after.readCalls < 0 ? QJsonValue() : QJsonValue(after.readCalls - before.readCalls);
+        result["writeSyscalls"] = after.writeCalls < 0 ? QJsonValue() : QJsonValue(after.writeCalls - before.writeCalls);
+
+        if (!error.isEmpty())
+            result["status"] = "failed";
+        else if (copied.files != source.files || copied.bytes != source.bytes)
+            result["status"] = "mismatch";
+        else
+            result["status"] = "ok";
+        if (!error.isEmpty())
+            result["error"] = error;
+    }
+    runDir.removeRecursively();
+
+    QTextStream(stdout) << QJsonDocument(result).toJson(QJsonDocument::Compact) << Qt::endl;
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("copyengine");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("DownloadAssistant 传输引擎吞吐基准");
+    parser.addHelpOption();
+    QCommandLineOption rootOption("root", "生成源目录树和复制目标的目录，建议使用 tmpfs。", "dir",
+                                  QDir(QDir::tempPath()).filePath("copyengine-bench"));
+    QCommandLineOption shapesOption("shapes", "要测量的目录树，逗号分隔：huge、tiny、mixed。", "list",
+                                    "huge,tiny,mixed");
+    QCommandLineOption scaleOption("scale", "文件数和大小的缩放比例。", "factor", "1");
+    QCommandLineOption seedOption("seed", "生成文件大小和内容的随机种子。", "seed", "1");
+    QCommandLineOption outputOption("output", "JSON 结果写入的文件，默认输出到标准输出。", "file");
+    QCommandLineOption simulateOption("simulate", "模拟远程共享的读取条件。", "spec");
+    QCommandLineOption shapeOption("shape", "（内部）子进程测量单个目录树。", "shape");
+    parser.addOptions({rootOption, shapesOption, scaleOption, seedOption, outputOption, simulateOption,
+                       shapeOption});
+    parser.process(app);
+
+    QString root = QDir(parser.value(rootOption)).absolutePath();
+    double scale = parser.value(scaleOption).toDouble();
+    if (scale <= 0)
+        scale = 1.0;
+    quint32 seed = parser.value(seedOption).toUInt();
+    QTextStream err(stderr);
+
+    SimulatedSourceConfig simulation;
+    if (parser.isSet(simulateOption)) {
+        QString error;
+        if (!SimulatedSourceConfig::fromString(parser.value(simulateOption), &simulation, &error)) {
+            err << "--simulate: " << error << Qt::endl;
+            return 1;
+        }
+    }
+
+    if (parser.isSet(shapeOption)) {
+        QString shape = parser.value(shapeOption);
+        if (parser.isSet(simulateOption)) {
+            setSourceDeviceFactory([simulation](const QString &path) {
+                return new SimulatedSourceDevice(path, simulation);
+            });
+        }
+        TreeSpec source = countTree(shareDir(root, shape));
+        return runShape(app, root, shape, source);
+    }
+
+    QJsonArray results;
+    const QStringList shapes = parser.value(shapesOption).split(',', Qt::SkipEmptyParts);
+    for (const QString &shape : shapes) {
+        if (shape != "huge" && shape != "tiny" && shape != "mixed") {
+            err << "未知的目录树: " << shape << Qt::endl;
+            return 1;
+        }
+
+        TreeSpec source;
+        if (!prepareTree(root, shape, scale, seed, &source, err)) {
+            err << "无法生成源目录树: " << shareDir(root, shape) << Qt::endl;
+            return 1;
+        }
+
+        err << "测量 " << shape << " ..." << Qt::endl;
+        QProcess child;
+        // 子进程的日志只写入其数据目录，控制台输出丢弃，避免管道写满阻塞
+        child.setStandardErrorFile(QProcess::nullDevice());
+        QStringList arguments = {"--root", root, "--shape", shape};
+        if (parser.isSet(simulateOption))
+            arguments << "--simulate" << simulation.toString();
+        child.start(app.applicationFilePath(), arguments);
+        QJsonObject result;
+        if (child.waitForFinished(-1) && child.exitCode() == 0)
+            result = QJsonDocument::fromJson(child.readAllStandardOutput().trimmed()).object();
+        if (result.isEmpty()) {
+            result["shape"] = shape;
+            result["status"] = "crashed";
+        }
+        result["sourceFiles"] = source.files;
+        result["sourceBytes"] = source.bytes;
+        results.append(result);
+    }
+
+    QJsonObject report;
+    report["benchmark"] = "copyengine";
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["platform"] = QSysInfo::prettyProductName();
+    report["cpu"] = QSysInfo::currentCpuArchitecture();
+    report["root"] = root;
+    report["scale"] = scale;
+    report["seed"] = static_cast<qint64>(seed);
+    if (parser.isSet(simulateOption))
+        report["simulate"] = simulation.toString();
+    report["results"] = results;
+    QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "无法写入: " << file.fileName() << Qt::endl;
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
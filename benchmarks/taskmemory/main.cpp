@@ -0,0 +1,179 @@
+// 任务内存基准：比较改造前的布局（每个任务一个 QObject，以字符串 ID 为键）
+// 与 TaskRecordStore 记录布局的每任务内存占用。
+//
+// 用法：taskmemory [任务数，默认 100000]
+// 每种布局在独立的子进程中测量，避免前一种布局释放的堆内存被后一种复用。
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
+#include <QProcess>
+#include <QSet>
+#include <QStringList>
+#include <QTextStream>
+#include <QUuid>
+#include "directoryjob.h"
+#include "downloadtask.h"
+#include "taskrecordstore.h"
+#include "sampledata.h"
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_LINUX)
+#include <QFile>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 界面同时关注的任务比例，只有这些任务带外观对象
+const int kFacadePerMille = 10;
+
+// 与改造前的 DownloadTask 成员一致
+class LegacyTask : public QObject
+{
+public:
+    explicit LegacyTask(QObject *parent)
+        : QObject(parent)
+        , status(DownloadTask::Pending)
+        , progress(0.0)
+        , downloadedSize(0)
+        , totalSize(0)
+        , speed(0)
+        , supportsResume(false)
+    {
+    }
+
+    QString id;
+    QString url;
+    QString savePath;
+    QString fileName;
+    DownloadTask::Status status;
+    double progress;
+    qint64 downloadedSize;
+    qint64 totalSize;
+    qint64 speed;
+    QString errorMessage;
+    bool supportsResume;
+    QDateTime endTime;
+    QDateTime remoteModified;
+    QSharedPointer<DirectoryJob> directoryJob;
+};
+
+qint64 processBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS_EX counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(),
+                             reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters),
+                             sizeof(counters)))
+        return static_cast<qint64>(counters.PrivateUsage);
+    return 0;
+#elif defined(Q_OS_LINUX)
+    // statm 第二列为常驻内存页数
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly))
+        return 0;
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    return fields.size() > 1 ? fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+qint64 measureLegacy(int count)
+{
+    QObject owner;
+    QMap<QString, LegacyTask*> tasks;
+    QSet<LegacyTask*> pending;
+    QHash<LegacyTask*, DownloadTask::Status> indexedStatus;
+    QDateTime now = QDateTime::currentDateTime();
+
+    qint64 before = processBytes();
+    for (int i = 0; i < count; ++i) {
+        LegacyTask *task = new LegacyTask(&owner);
+        task->id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+        task->url = sampleUrl(i);
+        task->savePath = sampleSavePath(i);
+        task->fileName = DownloadTask::fileNameFromUrl(task->url);
+        task->totalSize = i;
+        task->remoteModified = now;
+        tasks.insert(task->id, task);
+        pending.insert(task);
+        indexedStatus.insert(task, task->status);
+    }
+    return processBytes() - before;
+}
+
+qint64 measureRecords(int count, bool withFacades)
+{
+    QObject owner;
+    TaskRecordStore records;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    qint64 before = processBytes();
+    for (int i = 0; i < count; ++i) {
+        TaskRecord record;
+        record.id = QUuid::createUuid();
+        QString url = sampleUrl(i);
+        record.fileName = DownloadTask::fileNameFromUrl(url);
+        record.totalSize = i;
+        record.remoteModified = now;
+        TaskHandle handle = records.insert(record, url, sampleSavePath(i));
+        if (withFacades && i % 1000 < kFacadePerMille)
+            new DownloadTask(&records, handle, &owner);
+    }
+    return processBytes() - before;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    QTextStream out(stdout);
+
+    // 子进程：taskmemory --layout <布局> <任务数>，只输出字节数
+    if (args.size() == 4 && args.at(1) == "--layout") {
+        QString layout = args.at(2);
+        int count = args.at(3).toInt();
+        qint64 bytes = 0;
+        if (layout == "legacy")
+            bytes = measureLegacy(count);
+        else if (layout == "records")
+            bytes = measureRecords(count, false);
+        else if (layout == "facades")
+            bytes = measureRecords(count, true);
+        out << bytes << Qt::endl;
+        return 0;
+    }
+
+    int count = args.size() > 1 ? args.at(1).toInt() : 100000;
+    if (count <= 0)
+        count = 100000;
+
+    out << "任务数: " << count << Qt::endl;
+    out << qSetFieldWidth(24) << Qt::left << "布局" << "总内存(字节)" << "每任务(字节)"
+        << qSetFieldWidth(0) << Qt::endl;
+
+    const QStringList layouts = {"legacy", "records", "facades"};
+    const QStringList labels = {"QObject 任务（改造前）", "记录存储",
+                                QString("记录存储 + %1‰ 外观对象").arg(kFacadePerMille)};
+    for (int i = 0; i < layouts.size(); ++i) {
+        QProcess child;
+        child.start(app.applicationFilePath(),
+                    {"--layout", layouts.at(i), QString::number(count)});
+        if (!child.waitForFinished(-1) || child.exitCode() != 0) {
+            out << labels.at(i) << ": 测量失败" << Qt::endl;
+            continue;
+        }
+        qint64 bytes = child.readAllStandardOutput().trimmed().toLongLong();
+        out << qSetFieldWidth(24) << labels.at(i) << QString::number(bytes)
+            << QString::number(static_cast<double>(bytes) / count, 'f', 1)
+            << qSetFieldWidth(0) << Qt::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,24 @@
+QT = core sql network concurrent
+
+CONFIG += console c++14
+CONFIG -= app_bundle
+
+msvc {
+    QMAKE_CXXFLAGS += /Zc:__cplusplus
+    QMAKE_CXXFLAGS += /std:c++17
+    QMAKE_CXXFLAGS += /permissive-
+}
+
+TARGET = taskmemory
+
+include(../../core/core.pri)
+
+INCLUDEPATH += $$PWD/../common
+HEADERS += $$PWD/../common/sampledata.h
+
+SOURCES += \
+    main.cpp
+
+win32 {
+    LIBS += -lpsapi
+}
@@ -0,0 +1,19 @@
+# 链接下载核心静态库，供 app、daemon 和基准测试包含
+QT += core sql network concurrent
+INCLUDEPATH += $$PWD/../src
+
+# 按 core 源码目录求出其构建目录，包含者位于哪一层目录都适用
+CORE_BUILD_DIR = $$shadowed($$PWD)
+CONFIG(release, debug|release) {
+    CORE_LIB_DIR = $$CORE_BUILD_DIR/release
+} else {
+    CORE_LIB_DIR = $$CORE_BUILD_DIR/debug
+}
+
+LIBS += -L$$CORE_LIB_DIR -ldownloadcore
+
+msvc {
+    PRE_TARGETDEPS += $$CORE_LIB_DIR/downloadcore.lib
+} else {
+    PRE_TARGETDEPS += $$CORE_LIB_DIR/libdownloadcore.a
+}
@@ -0,0 +1,84 @@
+# 下载核心：任务队列、持久化、同步调度和传输，不依赖 Qt Widgets
+TEMPLATE = lib
+CONFIG += staticlib c++14
+QT = core sql network concurrent
+
+TARGET = downloadcore
+
+# MSVC specific settings
+msvc {
+    QMAKE_CXXFLAGS += /Zc:__cplusplus
+    QMAKE_CXXFLAGS += /std:c++17
+    QMAKE_CXXFLAGS += /permissive-
+}
+
+SRC_DIR = $$PWD/../src
+
+SOURCES += \
+    $$SRC_DIR/bulkimporter.cpp \
+    $$SRC_DIR/controlserver.cpp \
+    $$SRC_DIR/downloadmanager.cpp \
+    $$SRC_DIR/downloadtask.cpp \
+    $$SRC_DIR/smbdownloader.cpp \
+    $$SRC_DIR/smbworker.cpp \
+    $$SRC_DIR/sourcedevice.cpp \
+    $$SRC_DIR/simulatedsourcedevice.cpp \
+    $$SRC_DIR/directoryworker.cpp \
+    $$SRC_DIR/logger.cpp \
+    $$SRC_DIR/smbpathchecker.cpp \
+    $$SRC_DIR/pathutils.cpp \
+    $$SRC_DIR/units.cpp \
+    $$SRC_DIR/syncmanifest.cpp \
+    $$SRC_DIR/scanfilter.cpp \
+    $$SRC_DIR/directoryjob.cpp \
+    $$SRC_DIR/taskstore.cpp \
+    $$SRC_DIR/taskrecordstore.cpp \
+    $$SRC_DIR/pathinterner.cpp \
+    $$SRC_DIR/diskspaceledger.cpp \
+    $$SRC_DIR/concurrencycontroller.cpp \
+    $$SRC_DIR/bandwidthlimiter.cpp \
+    $$SRC_DIR/scheduleprofile.cpp \
+    $$SRC_DIR/throughputestimator.cpp \
+    $$SRC_DIR/transfermetrics.cpp \
+    $$SRC_DIR/metricsexporter.cpp
+
+HEADERS += \
+    $$SRC_DIR/bulkimporter.h \
+    $$SRC_DIR/controlserver.h \
+    $$SRC_DIR/downloadmanager.h \
+    $$SRC_DIR/downloadtask.h \
+    $$SRC_DIR/downloader.h \
+    $$SRC_DIR/smbdownloader.h \
+    $$SRC_DIR/smbworker.h \
+    $$SRC_DIR/sourcedevice.h \
+    $$SRC_DIR/simulatedsourcedevice.h \
+    $$SRC_DIR/directoryworker.h \
+    $$SRC_DIR/logger.h \
+    $$SRC_DIR/smbpathchecker.h \
+    $$SRC_DIR/pathutils.h \
+    $$SRC_DIR/units.h \
+    $$SRC_DIR/syncmanifest.h \
+    $$SRC_DIR/scanfilter.h \
+    $$SRC_DIR/directoryjob.h \
+    $$SRC_DIR/taskstore.h \
+    $$SRC_DIR/taskrecordstore.h \
+    $$SRC_DIR/pathinterner.h \
+    $$SRC_DIR/diskspaceledger.h \
+    $$SRC_DIR/concurrencycontroller.h \
+    $$SRC_DIR/bandwidthlimiter.h \
+    $$SRC_DIR/scheduleprofile.h \
+    $$SRC_DIR/throughputestimator.h \
+    $$SRC_DIR/transfermetrics.h \
+    $$SRC_DIR/metricsexporter.h
+
+INCLUDEPATH += $$SRC_DIR
+
+win32 {
+    DEFINES += WIN32_LEAN_AND_MEAN
+}
+
+CONFIG(release, debug|release) {
+    DESTDIR = release
+} else {
+    DESTDIR = debug
+}
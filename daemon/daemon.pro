@@ -0,0 +1,32 @@
+# 无界面守护进程：与图形界面共用同一套任务队列、持久化和同步调度
+QT = core sql network concurrent
+CONFIG += console c++14
+CONFIG -= app_bundle
+
+TARGET = DownloadAssistantDaemon
+
+# MSVC specific settings
+msvc {
+    QMAKE_CXXFLAGS += /Zc:__cplusplus
+    QMAKE_CXXFLAGS += /std:c++17
+    QMAKE_CXXFLAGS += /permissive-
+}
+
+include(../core/core.pri)
+
+SOURCES += \
+    main.cpp
+
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/DownloadAssistant/bin
+!isEmpty(target.path): INSTALLS += target
+
+win32 {
+    DEFINES += WIN32_LEAN_AND_MEAN
+}
+
+CONFIG(release, debug|release) {
+    DESTDIR = release
+} else {
+    DESTDIR = debug
+}
@@ -0,0 +1,290 @@
+// 无界面守护进程：在没有显示器的服务器上运行下载队列和镜像同步。
+// 任务和设置与图形界面相同，保存在数据目录的 tasks.db 中。
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QTimer>
+#include <csignal>
+#include <functional>
+#include "bulkimporter.h"
+#include "controlserver.h"
+#include "downloadmanager.h"
+#include "logger.h"
+#include "metricsexporter.h"
+#include "pathutils.h"
+#include "scanfilter.h"
+#include "simulatedsourcedevice.h"
+#include "sourcedevice.h"
+
+namespace {
+// 控制台输出合计进度的间隔
+const qint64 kReportIntervalMs = 5000;
+
+// 信号处理函数中只能写 sig_atomic_t，由事件循环中的定时器检查后退出
+volatile std::sig_atomic_t s_quitRequested = 0;
+
+void requestQuit(int)
+{
+    s_quitRequested = 1;
+}
+
+QString formatBytes(qint64 bytes)
+{
+    const qint64 KB = 1024;
+    const qint64 MB = 1024 * KB;
+    const qint64 GB = 1024 * MB;
+
+    if (bytes >= GB)
+        return QString("%1 GB").arg(static_cast<double>(bytes) / GB, 0, 'f', 2);
+    if (bytes >= MB)
+        return QString("%1 MB").arg(static_cast<double>(bytes) / MB, 0, 'f', 2);
+    if (bytes >= KB)
+        return QString("%1 KB").arg(static_cast<double>(bytes) / KB, 0, 'f', 2);
+    return QString("%1 B").arg(bytes);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("DownloadAssistantDaemon");
+    QCoreApplication::setApplicationVersion("1.0.0");
+    QCoreApplication::setOrganizationName("DownloadAssistant");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("DownloadAssistant 无界面下载服务");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption dataDirOption("data-dir", "任务数据库、日志和同步清单所在目录，默认为程序目录。", "dir");
+    QCommandLineOption shareRootOption("share-root",
+                                       "共享的挂载根目录：\\\\server\\share\\a 对应 <dir>/server/share/a（非 Windows）。",
+                                       "dir");
+    QCommandLineOption addOption("add", "添加文件下载任务，可重复。", "url");
+    QCommandLineOption addDirOption("add-dir", "添加目录下载任务，可重复。", "url");
+    QCommandLineOption importOption("import",
+                                    "从列表文件导入文件任务，每行 地址[\\t保存目录[\\t优先级]]，可重复；"
+                                    "被拒绝的行写入 <file>.rejected.txt。",
+                                    "file");
+    QCommandLineOption savePathOption("save-path", "新任务的保存目录，默认使用设置中的保存路径。", "dir");
+    QCommandLineOption filterOption("filter", "目录任务的过滤规则。", "rules");
+    QCommandLineOption minConcurrencyOption("min-concurrency", "每个服务器同时传输任务数的下限，默认沿用设置。", "n");
+    QCommandLineOption maxConcurrencyOption("max-concurrency",
+                                            "每个服务器同时传输任务数的上限，在上下限之间按吞吐自动调整。", "n");
+    QCommandLineOption profileOption("profile",
+                                     "按时段限制传输，可重复，替换已保存的时段，如 "
+                                     "name=office,days=mon-fri,from=08:00,to=18:00,bandwidth=10M,concurrency=2,priority=0。",
+                                     "spec");
+    QCommandLineOption syncAllOption("sync-all", "启动后立即运行全部镜像同步。");
+    QCommandLineOption exitWhenIdleOption("exit-when-idle", "队列全部处理完后退出，不等待定时同步。");
+    QCommandLineOption simulateOption("simulate-source",
+                                      "测试用：读取时模拟远程共享的延迟、限速、错误和卡顿，"
+                                      "如 latency=20,bandwidth=10M,errors=0.001。",
+                                      "spec");
+    QCommandLineOption controlNameOption("control-name", "本机控制接口的服务名，其他进程经此提交任务。",
+                                         "name", ControlServer::defaultName());
+    QCommandLineOption noControlOption("no-control", "不启动本机控制接口。");
+    QCommandLineOption metricsFileOption("metrics-file",
+                                         "定期把 Prometheus 格式的运行指标写入文件，供 node_exporter 收集。", "file");
+    QCommandLineOption metricsIntervalOption("metrics-interval", "指标文件的写入间隔（秒），默认 15。",
+                                             "seconds", "15");
+    QCommandLineOption metricsPortOption("metrics-port",
+                                         "在 127.0.0.1 的指定端口上提供 HTTP 指标接口（/metrics）。", "port");
+    parser.addOptions({dataDirOption, shareRootOption, addOption, addDirOption, importOption, savePathOption,
+                       filterOption, minConcurrencyOption, maxConcurrencyOption, profileOption, syncAllOption,
+                       exitWhenIdleOption, simulateOption,
+                       controlNameOption, noControlOption, metricsFileOption, metricsIntervalOption,
+                       metricsPortOption});
+    parser.process(app);
+
+    // 数据目录必须在日志和下载管理器创建之前设置
+    if (parser.isSet(dataDirOption))
+        setDataDirectory(parser.value(dataDirOption));
+    if (parser.isSet(shareRootOption))
+        setShareMountRoot(parser.value(shareRootOption));
+    if (parser.isSet(simulateOption)) {
+        SimulatedSourceConfig simulation;
+        QString error;
+        if (!SimulatedSourceConfig::fromString(parser.value(simulateOption), &simulation, &error)) {
+            QTextStream(stderr) << "--simulate-source: " << error << Qt::endl;
+            return 1;
+        }
+        setSourceDeviceFactory([simulation](const QString &path) {
+            return new SimulatedSourceDevice(path, simulation);
+        });
+    }
+
+    if (parser.isSet(filterOption)) {
+        QString error;
+        ScanFilter::fromString(parser.value(filterOption), &error);
+        if (!error.isEmpty()) {
+            QTextStream(stderr) << "--filter: " << error << Qt::endl;
+            return 1;
+        }
+    }
+
+    Logger::instance()->info("守护进程启动");
+
+    std::signal(SIGINT, requestQuit);
+    std::signal(SIGTERM, requestQuit);
+    QTimer quitPoll;
+    QObject::connect(&quitPoll, &QTimer::timeout, &app, [&]() {
+        if (s_quitRequested)
+            app.quit();
+    });
+    quitPoll.start(200);
+
+    QTextStream out(stdout);
+
+    // 在打开任务数据库之前占用控制接口的服务名，避免两个实例同时使用同一个 tasks.db
+    ControlServer control(nullptr);
+    if (!parser.isSet(noControlOption) && !control.listen(parser.value(controlNameOption))) {
+        if (control.otherInstanceRunning()) {
+            QTextStream(stderr) << "已有实例在使用控制接口 " << parser.value(controlNameOption)
+                                << "，可用 --control-name 或 --no-control 另行启动" << Qt::endl;
+            return 1;
+        }
+        out << "控制接口未启动: " << control.errorString() << Qt::endl;
+    }
+
+    DownloadManager manager;
+
+    QObject::connect(&manager, &DownloadManager::taskCompleted, [&](const QString &taskId) {
+        out << "完成: " << taskId << Qt::endl;
+    });
+    QObject::connect(&manager, &DownloadManager::taskFailed, [&](const QString &taskId, const QString &error) {
+        out << "失败: " << taskId << " - " << error << Qt::endl;
+    });
+    QObject::connect(&manager, &DownloadManager::concurrencyChanged,
+                     [&](const QString &server, int limit, const QString &reason) {
+        out << "并发上限: " << (server.isEmpty() ? QStringLiteral("本地") : server)
+            << " -> " << limit << "（" << reason << "）" << Qt::endl;
+    });
+    QObject::connect(&manager, &DownloadManager::scheduleProfileChanged, [&](const QString &name) {
+        out << "时段: " << (name.isEmpty() ? QStringLiteral("不限") : name) << Qt::endl;
+    });
+    QObject::connect(&manager, &DownloadManager::syncFinished, [&](const QString &syncId, const QString &summary) {
+        out << "同步结束: " << syncId << " - " << summary << Qt::endl;
+    });
+
+    QElapsedTimer reportTimer;
+    reportTimer.start();
+    QObject::connect(&manager, &DownloadManager::progressSnapshot,
+                     [&](const DownloadManager::ProgressSnapshot &snapshot) {
+        if (reportTimer.elapsed() < kReportIntervalMs)
+            return;
+        reportTimer.restart();
+        QString eta = snapshot.stalled ? QStringLiteral("停滞")
+                      : snapshot.secondsRemaining < 0 ? QStringLiteral("未知")
+                      : (snapshot.queueRemainingExact ? QString() : QStringLiteral("至少"))
+                            + DownloadTask::durationText(snapshot.secondsRemaining);
+        out << QString("下载中 %1 个，%2 / %3，%4/s（平均 %5/s），队列剩余 %6")
+                   .arg(snapshot.activeCount)
+                   .arg(formatBytes(snapshot.bytesReceived))
+                   .arg(formatBytes(snapshot.bytesTotal))
+                   .arg(formatBytes(snapshot.speed))
+                   .arg(formatBytes(snapshot.averageSpeed))
+                   .arg(eta)
+            << Qt::endl;
+    });
+
+    if (parser.isSet(minConcurrencyOption) || parser.isSet(maxConcurrencyOption)) {
+        int minLimit = parser.isSet(minConcurrencyOption) ? parser.value(minConcurrencyOption).toInt()
+                                                          : manager.minConcurrency();
+        int maxLimit = parser.isSet(maxConcurrencyOption) ? parser.value(maxConcurrencyOption).toInt()
+                                                          : manager.maxConcurrency();
+        manager.setConcurrencyLimits(minLimit, maxLimit);
+    }
+
+    if (parser.isSet(profileOption)) {
+        QList<ScheduleProfile> profiles;
+        const QStringList specs = parser.values(profileOption);
+        for (const QString &spec : specs) {
+            ScheduleProfile profile;
+            QString error;
+            if (!ScheduleProfile::fromString(spec, &profile, &error)) {
+                QTextStream(stderr) << "--profile: " << error << Qt::endl;
+                return 1;
+            }
+            profiles.append(profile);
+        }
+        manager.setScheduleProfiles(profiles);
+    }
+
+    control.setManager(&manager);
+
+    MetricsExporter metrics(&manager);
+    if (parser.isSet(metricsFileOption)) {
+        metrics.writeFile(parser.value(metricsFileOption), parser.value(metricsIntervalOption).toInt() * 1000);
+        // 队列处理完退出时留下最终的计数
+        QObject::connect(&app, &QCoreApplication::aboutToQuit, &metrics, &MetricsExporter::writeNow);
+    }
+    if (parser.isSet(metricsPortOption)) {
+        bool ok = false;
+        int port = parser.value(metricsPortOption).toInt(&ok);
+        if (!ok || port <= 0 || port > 65535) {
+            QTextStream(stderr) << "--metrics-port: 端口无效" << Qt::endl;
+            return 1;
+        }
+        if (!metrics.listen(static_cast<quint16>(port)))
+            out << "指标接口未启动: " << metrics.errorString() << Qt::endl;
+    }
+
+    QString savePath = parser.value(savePathOption);
+    const QStringList files = parser.values(addOption);
+    for (const QString &url : files)
+        manager.addTask(url, savePath);
+    const QStringList directories = parser.values(addDirOption);
+    for (const QString &url : directories) {
+        QString localPath = savePath.isEmpty() ? manager.getDefaultSavePath() : savePath;
+        manager.addDirectoryTask(url, localPath, parser.value(filterOption));
+    }
+
+    // 列表导入完成后再开始队列，避免 --exit-when-idle 在导入途中判定队列为空
+    auto startQueue = [&]() {
+        manager.startAllTasks();
+        if (parser.isSet(syncAllOption))
+            manager.runAllSyncJobs();
+
+        if (parser.isSet(exitWhenIdleOption)) {
+            QObject::connect(&manager, &DownloadManager::queueDrained, &app, &QCoreApplication::quit);
+            if (manager.taskCount() == 0)
+                QTimer::singleShot(0, &app, &QCoreApplication::quit);
+        }
+    };
+
+    // 多个列表依次导入，前一个结束后再开始下一个
+    QStringList importLists = parser.values(importOption);
+    BulkImporter importer(&manager);
+    if (!savePath.isEmpty())
+        importer.setDefaultSavePath(savePath);
+    std::function<void()> importNext = [&]() {
+        while (!importLists.isEmpty()) {
+            QString listPath = importLists.takeFirst();
+            importer.setRejectFile(listPath + ".rejected.txt");
+            if (importer.start(listPath)) {
+                out << "导入: " << listPath << Qt::endl;
+                return;
+            }
+            out << "无法打开列表: " << listPath << Qt::endl;
+        }
+        startQueue();
+    };
+    QObject::connect(&importer, &BulkImporter::finished, [&](const BulkImporter::Summary &summary) {
+        if (!summary.error.isEmpty())
+            out << "读取列表失败: " << summary.error << Qt::endl;
+        out << QString("导入结束 - 加入 %1，重复 %2，拒绝 %3")
+                   .arg(summary.accepted).arg(summary.duplicates).arg(summary.rejected)
+            << Qt::endl;
+        for (const QString &sample : summary.rejectedSamples)
+            out << "  " << sample << Qt::endl;
+        QTimer::singleShot(0, &app, importNext);
+    });
+    importNext();
+
+    out << QString("数据目录: %1，未完成任务: %2").arg(dataDirectory()).arg(manager.taskCount()) << Qt::endl;
+    int ret = app.exec();
+    Logger::instance()->info("守护进程退出");
+    return ret;
+}
@@ -0,0 +1,72 @@
+#include "bandwidthlimiter.h"
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
+
+namespace {
+
+// 令牌上限：空闲后最多允许这么长时间的突发
+const qint64 kBurstMs = 250;
+// 每次等待的最长时间，期间检查取消和上限变化
+const qint64 kMaxWaitMs = 100;
+
+QMutex g_mutex;
+qint64 g_rate = 0;
+double g_tokens = 0.0;
+QElapsedTimer g_clock;
+qint64 g_lastRefill = 0;
+
+// 调用方持有 g_mutex
+void refill()
+{
+    if (!g_clock.isValid())
+        g_clock.start();
+    qint64 now = g_clock.elapsed();
+    g_tokens += static_cast<double>(now - g_lastRefill) * g_rate / 1000.0;
+    g_tokens = qMin(g_tokens, static_cast<double>(g_rate) * kBurstMs / 1000.0);
+    g_lastRefill = now;
+}
+
+} // namespace
+
+void setBandwidthLimit(qint64 bytesPerSecond)
+{
+    QMutexLocker locker(&g_mutex);
+    refill();
+    qint64 rate = qMax<qint64>(0, bytesPerSecond);
+    // 放宽或取消限制时清掉按旧速率累积的透支，等待中的线程在下一次检查时继续
+    if ((rate == 0 || (g_rate > 0 && rate > g_rate)) && g_tokens < 0)
+        g_tokens = 0.0;
+    g_rate = rate;
+}
+
+qint64 bandwidthLimit()
+{
+    QMutexLocker locker(&g_mutex);
+    return g_rate;
+}
+
+void throttleTransfer(qint64 bytes, const bool *cancelled)
+{
+    {
+        QMutexLocker locker(&g_mutex);
+        if (g_rate == 0)
+            return;
+        refill();
+        g_tokens -= bytes;
+    }
+
+    while (!(cancelled && *cancelled)) {
+        qint64 waitMs;
+        {
+            QMutexLocker locker(&g_mutex);
+            if (g_rate == 0)
+                return;
+            refill();
+            if (g_tokens >= 0)
+                return;
+            waitMs = static_cast<qint64>(-g_tokens * 1000.0 / g_rate) + 1;
+        }
+        QThread::msleep(static_cast<unsigned long>(qMin(waitMs, kMaxWaitMs)));
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef BANDWIDTHLIMITER_H
+#define BANDWIDTHLIMITER_H
+
+#include <QtGlobal>
+
+// 全部传输共用的令牌桶：工作线程每读到一块数据就取走相应的令牌，不够时等待。
+// 令牌可以透支，透支的部分按速率等待偿还，多个线程并发读取时合计速率不超过上限。
+// 修改上限立即对正在进行的传输生效，不需要重新开始传输。
+
+// 合计速率上限（字节/秒），0 表示不限
+void setBandwidthLimit(qint64 bytesPerSecond);
+qint64 bandwidthLimit();
+
+// 在工作线程中调用，取走 bytes 字节的令牌；等待期间 *cancelled 变为 true 时提前返回
+void throttleTransfer(qint64 bytes, const bool *cancelled);
+
+#endif // BANDWIDTHLIMITER_H
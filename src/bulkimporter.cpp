@@ -0,0 +1,297 @@
+#include "bulkimporter.h"
+#include "logger.h"
+#include <QDir>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+namespace {
+
+// 每批读取的行数：足够分摊一次事务的开销，主线程加入一批的停顿也不会太长
+const int kBatchLines = 5000;
+// 在途批次数，读取线程最多领先主线程这么多批
+const int kBatchesInFlight = 2;
+const int kMaxRejectedSamples = 20;
+
+struct ParsedLine {
+    bool skipped;
+    QString url;
+    QString savePath;
+    int priority;
+    QString reason;     // 非空表示被拒绝
+    QString key;
+};
+
+// 去重键：共享路径不区分大小写，分隔符统一后的完整地址。
+// 直接比较字符串，不同地址不会因哈希冲突被误判为重复
+QString urlKey(const QString &url)
+{
+    QString normalized = url.toLower();
+    normalized.replace('\\', '/');
+    return normalized;
+}
+
+bool isRemotePath(const QString &path)
+{
+    return path.startsWith("\\\\") || path.startsWith("//") || QDir::isAbsolutePath(path);
+}
+
+ParsedLine parseLine(const QByteArray &raw)
+{
+    ParsedLine parsed = {false, QString(), QString(), 0, QString(), QString()};
+    QString line = QString::fromUtf8(raw);
+    while (line.endsWith('\n') || line.endsWith('\r'))
+        line.chop(1);
+    if (line.startsWith(QChar(0xFEFF)))
+        line.remove(0, 1);
+    if (line.trimmed().isEmpty() || line.trimmed().startsWith('#')) {
+        parsed.skipped = true;
+        return parsed;
+    }
+
+    const QStringList fields = line.split('\t');
+    if (fields.size() > 3) {
+        parsed.reason = QObject::tr("字段过多");
+        return parsed;
+    }
+
+    parsed.url = fields.at(0).trimmed();
+    if (!isRemotePath(parsed.url)) {
+        parsed.reason = QObject::tr("不是共享路径或绝对路径");
+        return parsed;
+    }
+    if (parsed.url.endsWith('/') || parsed.url.endsWith('\\')) {
+        parsed.reason = QObject::tr("缺少文件名");
+        return parsed;
+    }
+    for (const QChar ch : parsed.url) {
+        if (ch.category() == QChar::Other_Control) {
+            parsed.reason = QObject::tr("包含控制字符");
+            return parsed;
+        }
+    }
+
+    parsed.savePath = fields.value(1).trimmed();
+    if (!parsed.savePath.isEmpty() && !QDir::isAbsolutePath(parsed.savePath)) {
+        parsed.reason = QObject::tr("保存目录不是绝对路径");
+        return parsed;
+    }
+
+    QString priority = fields.value(2).trimmed();
+    if (!priority.isEmpty()) {
+        bool ok = false;
+        parsed.priority = priority.toInt(&ok);
+        if (!ok || parsed.priority < -128 || parsed.priority > 127) {
+            parsed.reason = QObject::tr("优先级无效");
+            return parsed;
+        }
+    }
+
+    parsed.key = urlKey(parsed.url);
+    return parsed;
+}
+
+} // namespace
+
+BulkImporter::BulkImporter(DownloadManager *manager, QObject *parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_defaultSavePath(manager->getDefaultSavePath())
+    , m_startTasks(false)
+    , m_listSize(0)
+    , m_thread(nullptr)
+    , m_readFinished(false)
+    , m_freeSlots(kBatchesInFlight)
+{
+}
+
+BulkImporter::~BulkImporter()
+{
+    if (m_thread) {
+        cancel();
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+void BulkImporter::setDefaultSavePath(const QString &path)
+{
+    m_defaultSavePath = path;
+}
+
+void BulkImporter::setStartTasks(bool start)
+{
+    m_startTasks = start;
+}
+
+void BulkImporter::setRejectFile(const QString &path)
+{
+    m_rejectPath = path;
+}
+
+bool BulkImporter::start(const QString &listPath)
+{
+    if (m_thread)
+        return false;
+
+    m_list.setFileName(listPath);
+    if (!m_list.open(QIODevice::ReadOnly)) {
+        LOG_ERROR(QString("无法打开导入列表: %1 - %2").arg(listPath).arg(m_list.errorString()));
+        return false;
+    }
+    m_listSize = m_list.size();
+    LOG_INFO(QString("开始导入任务列表: %1，%2 字节").arg(listPath).arg(m_listSize));
+
+    m_summary = Summary{0, 0, 0, 0, QStringList(), false, QString()};
+    m_cancelled.storeRelaxed(0);
+    m_readFinished = false;
+    m_readError.clear();
+    m_batches.clear();
+    // 上一次取消时多放出的空位在这里收回，每次导入都恰好有 kBatchesInFlight 个空位
+    int available = m_freeSlots.available();
+    if (available > kBatchesInFlight)
+        m_freeSlots.acquire(available - kBatchesInFlight);
+    else if (available < kBatchesInFlight)
+        m_freeSlots.release(kBatchesInFlight - available);
+
+    // 队列中已有的任务也参与去重
+    m_seen.clear();
+    const QStringList existing = m_manager->taskUrls();
+    m_seen.reserve(existing.size());
+    for (const QString &url : existing)
+        m_seen.insert(urlKey(url));
+
+    m_thread = QThread::create([this]() { readList(); });
+    m_thread->start();
+    return true;
+}
+
+void BulkImporter::cancel()
+{
+    if (!m_thread)
+        return;
+    m_cancelled.storeRelaxed(1);
+    // 读取线程可能正在等待空位
+    m_freeSlots.release(kBatchesInFlight);
+}
+
+void BulkImporter::readList()
+{
+    QFile rejects;
+    if (!m_rejectPath.isEmpty()) {
+        rejects.setFileName(m_rejectPath);
+        if (!rejects.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+            LOG_WARNING(QString("无法写入拒绝列表: %1").arg(m_rejectPath));
+    }
+
+    qint64 lineNumber = 0;
+    while (!m_cancelled.loadRelaxed() && !m_list.atEnd()) {
+        QList<QByteArray> lines;
+        lines.reserve(kBatchLines);
+        while (lines.size() < kBatchLines && !m_list.atEnd())
+            lines.append(m_list.readLine());
+
+        const QList<ParsedLine> parsed = QtConcurrent::blockingMapped(lines, parseLine);
+
+        Batch batch;
+        batch.requests.reserve(parsed.size());
+        batch.lines = parsed.size();
+        batch.duplicates = 0;
+        batch.rejected = 0;
+        for (int i = 0; i < parsed.size(); ++i) {
+            const ParsedLine &line = parsed.at(i);
+            ++lineNumber;
+            if (line.skipped)
+                continue;
+            QString reason = line.reason;
+            if (reason.isEmpty() && m_seen.contains(line.key)) {
+                ++batch.duplicates;
+                continue;
+            }
+            if (!reason.isEmpty()) {
+                ++batch.rejected;
+                QString text = QString::fromUtf8(lines.at(i)).trimmed();
+                if (rejects.isOpen())
+                    rejects.write(QString("%1\t%2\t%3\n").arg(lineNumber).arg(reason).arg(text).toUtf8());
+                if (batch.rejectedSamples.size() < kMaxRejectedSamples)
+                    batch.rejectedSamples.append(QObject::tr("第 %1 行：%2").arg(lineNumber).arg(reason));
+                continue;
+            }
+            m_seen.insert(line.key);
+            batch.requests.append({line.url,
+                                   line.savePath.isEmpty() ? m_defaultSavePath : line.savePath,
+                                   line.priority});
+        }
+        batch.bytesRead = m_list.pos();
+
+        m_freeSlots.acquire();
+        if (m_cancelled.loadRelaxed())
+            break;
+        {
+            QMutexLocker locker(&m_mutex);
+            m_batches.append(batch);
+        }
+        QMetaObject::invokeMethod(this, "takeBatches", Qt::QueuedConnection);
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_list.error() != QFileDevice::NoError)
+            m_readError = m_list.errorString();
+        m_readFinished = true;
+    }
+    QMetaObject::invokeMethod(this, "takeBatches", Qt::QueuedConnection);
+}
+
+void BulkImporter::takeBatches()
+{
+    QList<Batch> batches;
+    bool readFinished;
+    {
+        QMutexLocker locker(&m_mutex);
+        batches.swap(m_batches);
+        readFinished = m_readFinished;
+    }
+
+    for (const Batch &batch : batches) {
+        m_freeSlots.release();
+        if (m_cancelled.loadRelaxed())
+            continue;
+
+        const QStringList taskIds = m_manager->addTasks(batch.requests);
+        if (m_startTasks) {
+            for (const QString &taskId : taskIds)
+                m_manager->startTask(taskId);
+        }
+
+        m_summary.lines += batch.lines;
+        m_summary.accepted += taskIds.size();
+        m_summary.duplicates += batch.duplicates;
+        m_summary.rejected += batch.rejected;
+        for (const QString &sample : batch.rejectedSamples) {
+            if (m_summary.rejectedSamples.size() < kMaxRejectedSamples)
+                m_summary.rejectedSamples.append(sample);
+        }
+        emit progress(batch.bytesRead, m_listSize, m_summary.accepted, m_summary.rejected);
+    }
+
+    if (readFinished && m_thread)
+        finish();
+}
+
+void BulkImporter::finish()
+{
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+    m_list.close();
+    m_seen.clear();
+    m_seen.squeeze();
+
+    m_summary.cancelled = m_cancelled.loadRelaxed() != 0;
+    m_summary.error = m_readError;
+    LOG_INFO(QString("任务列表导入%1 - 行数: %2，加入: %3，重复: %4，拒绝: %5")
+             .arg(m_summary.cancelled ? tr("已取消") : tr("完成"))
+             .arg(m_summary.lines).arg(m_summary.accepted)
+             .arg(m_summary.duplicates).arg(m_summary.rejected));
+    emit finished(m_summary);
+}
@@ -0,0 +1,95 @@
+#ifndef BULKIMPORTER_H
+#define BULKIMPORTER_H
+
+#include <QAtomicInt>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSemaphore>
+#include <QSet>
+#include <QStringList>
+#include "downloadmanager.h"
+
+class QThread;
+
+// 从列表文件批量导入下载任务。列表每行一个远程文件：
+//   地址[\t保存目录[\t优先级]]
+// 空行和以 # 开头的行跳过；保存目录为空时使用默认保存路径，优先级为 -128~127 的整数。
+//
+// 文件在后台线程中逐批读取，每批的校验在线程池中并行进行，按地址去重（包括已在队列中的任务），
+// 合格的任务交回主线程一次性加入。同时只有两批在途，读取和校验的缓冲不随列表增长；
+// 去重集合保存每个已接受地址的规范化字符串，这部分内存与接受的任务数成正比。
+class BulkImporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Summary {
+        qint64 lines;
+        int accepted;
+        int duplicates;
+        int rejected;
+        QStringList rejectedSamples;    // 前若干条被拒绝的行及原因
+        bool cancelled;
+        QString error;
+    };
+
+    explicit BulkImporter(DownloadManager *manager, QObject *parent = nullptr);
+    ~BulkImporter();
+
+    // 保存目录列为空时使用的目录，默认为下载管理器的默认保存路径
+    void setDefaultSavePath(const QString &path);
+    // 导入后是否立即开始下载；默认只加入等待队列
+    void setStartTasks(bool start);
+    // 被拒绝的行全部写入该文件，每行为 "行号\t原因\t原文"
+    void setRejectFile(const QString &path);
+
+    bool start(const QString &listPath);
+    void cancel();
+    bool isRunning() const { return m_thread != nullptr; }
+
+signals:
+    void progress(qint64 bytesRead, qint64 bytesTotal, int accepted, int rejected);
+    void finished(const BulkImporter::Summary &summary);
+
+private slots:
+    void takeBatches();
+
+private:
+    struct Batch {
+        QList<DownloadManager::TaskRequest> requests;
+        qint64 bytesRead;
+        qint64 lines;
+        int duplicates;
+        int rejected;
+        QStringList rejectedSamples;
+    };
+
+    void readList();
+    void finish();
+
+    DownloadManager *m_manager;
+    QString m_defaultSavePath;
+    bool m_startTasks;
+    QString m_rejectPath;
+
+    QFile m_list;
+    qint64 m_listSize;
+    QThread *m_thread;
+    QSet<QString> m_seen;               // 只在读取线程中访问
+    QAtomicInt m_cancelled;
+
+    // 读取线程交给主线程的批次
+    QMutex m_mutex;
+    QList<Batch> m_batches;
+    bool m_readFinished;
+    QString m_readError;
+    QSemaphore m_freeSlots;
+
+    Summary m_summary;
+};
+
+Q_DECLARE_METATYPE(BulkImporter::Summary)
+
+#endif // BULKIMPORTER_H
@@ -0,0 +1,208 @@
+#include "concurrencycontroller.h"
+#include "logger.h"
+#include <QDateTime>
+#include <QTimer>
+
+namespace {
+const int kSampleIntervalMs = 5000;
+// 吞吐至少提高这么多才算加名额有效
+const double kImprovement = 0.10;
+// 持平多少个周期后试探性地加一
+const int kProbeSamples = 6;
+const int kInitialLimit = 2;
+
+QString formatRate(qint64 bytesPerSecond)
+{
+    return QString("%1 MB/s").arg(static_cast<double>(bytesPerSecond) / (1024 * 1024), 0, 'f', 1);
+}
+}
+
+ConcurrencyController::ConcurrencyController(QObject *parent)
+    : QObject(parent)
+    , m_minLimit(1)
+    , m_maxLimit(8)
+    , m_totalLimit(0)
+    , m_sampleTimer(new QTimer(this))
+    , m_lastSample(0)
+    , m_bytesTransferred(0)
+{
+    m_sampleTimer->setInterval(kSampleIntervalMs);
+    connect(m_sampleTimer, &QTimer::timeout, this, &ConcurrencyController::sample);
+}
+
+void ConcurrencyController::setLimits(int minLimit, int maxLimit)
+{
+    m_minLimit = qMax(1, minLimit);
+    m_maxLimit = qMax(m_minLimit, maxLimit);
+    for (auto it = m_servers.begin(); it != m_servers.end(); ++it) {
+        int limit = qBound(m_minLimit, it->limit, m_maxLimit);
+        if (limit != it->limit)
+            setLimit(it.key(), it.value(), limit, tr("并发范围调整为 %1-%2").arg(m_minLimit).arg(m_maxLimit));
+    }
+    emitLimitChanges();
+}
+
+QString ConcurrencyController::serverOf(const QString &url)
+{
+    if (!url.startsWith("\\\\") && !url.startsWith("//"))
+        return QString();
+    int end = 2;
+    while (end < url.size() && url.at(end) != '/' && url.at(end) != '\\')
+        ++end;
+    return url.mid(2, end - 2).toLower();
+}
+
+ConcurrencyController::Server &ConcurrencyController::server(const QString &name)
+{
+    auto it = m_servers.find(name);
+    if (it == m_servers.end()) {
+        Server state;
+        state.limit = qBound(m_minLimit, kInitialLimit, m_maxLimit);
+        state.active = 0;
+        state.bytes = 0;
+        state.totalBytes = 0;
+        state.failures = 0;
+        state.throughput = 0;
+        state.previousThroughput = 0;
+        state.increased = false;
+        state.steadySamples = 0;
+        state.reason = tr("初始值");
+        it = m_servers.insert(name, state);
+    }
+    return it.value();
+}
+
+bool ConcurrencyController::hasSlot(const QString &server) const
+{
+    if (m_totalLimit > 0 && m_transfers.size() >= m_totalLimit)
+        return false;
+    auto it = m_servers.constFind(server);
+    if (it == m_servers.constEnd())
+        return true;
+    return it->active < it->limit;
+}
+
+void ConcurrencyController::acquire(TaskHandle handle, const QString &name, qint64 bytes)
+{
+    if (m_transfers.contains(handle))
+        return;
+
+    ++server(name).active;
+    // 建立连接需要时间，第一个周期不算卡顿
+    m_transfers.insert(handle, Transfer{name, bytes, true});
+    if (!m_sampleTimer->isActive()) {
+        m_lastSample = QDateTime::currentMSecsSinceEpoch();
+        m_sampleTimer->start();
+    }
+}
+
+void ConcurrencyController::release(TaskHandle handle, bool failed)
+{
+    auto it = m_transfers.find(handle);
+    if (it == m_transfers.end())
+        return;
+
+    Server &state = server(it->server);
+    --state.active;
+    if (failed)
+        ++state.failures;
+    m_transfers.erase(it);
+}
+
+void ConcurrencyController::progress(TaskHandle handle, qint64 bytes)
+{
+    auto it = m_transfers.find(handle);
+    if (it == m_transfers.end())
+        return;
+
+    qint64 delta = bytes - it->bytes;
+    it->bytes = bytes;
+    if (delta > 0) {
+        Server &state = server(it->server);
+        state.bytes += delta;
+        state.totalBytes += delta;
+        m_bytesTransferred += delta;
+        it->moved = true;
+    }
+}
+
+QList<ConcurrencyController::ServerState> ConcurrencyController::servers() const
+{
+    QList<ServerState> states;
+    for (auto it = m_servers.constBegin(); it != m_servers.constEnd(); ++it)
+        states.append(ServerState{it.key(), it->limit, it->active, it->throughput, it->totalBytes, it->reason});
+    return states;
+}
+
+void ConcurrencyController::setLimit(const QString &name, Server &state, int limit, const QString &reason)
+{
+    limit = qBound(m_minLimit, limit, m_maxLimit);
+    state.increased = limit > state.limit;
+    state.steadySamples = 0;
+    if (limit == state.limit)
+        return;
+
+    LOG_INFO(QString("并发上限调整 - 服务器: %1, %2 -> %3, 原因: %4")
+             .arg(name.isEmpty() ? QStringLiteral("本地") : name)
+             .arg(state.limit).arg(limit).arg(reason));
+    state.limit = limit;
+    state.reason = reason;
+    m_limitChanges.append(LimitChange{name, limit, reason});
+}
+
+void ConcurrencyController::emitLimitChanges()
+{
+    const QList<LimitChange> changes = m_limitChanges;
+    m_limitChanges.clear();
+    for (const LimitChange &change : changes)
+        emit limitChanged(change.server, change.limit, change.reason);
+}
+
+void ConcurrencyController::sample()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 elapsed = now - m_lastSample;
+    m_lastSample = now;
+    if (m_transfers.isEmpty())
+        m_sampleTimer->stop();
+    if (elapsed <= 0)
+        return;
+
+    // 整个周期没有进度的传输视为卡顿
+    QHash<QString, int> stalls;
+    for (auto it = m_transfers.begin(); it != m_transfers.end(); ++it) {
+        if (!it->moved)
+            ++stalls[it->server];
+        it->moved = false;
+    }
+
+    for (auto it = m_servers.begin(); it != m_servers.end(); ++it) {
+        Server &state = it.value();
+        if (state.active == 0 && state.bytes == 0 && state.failures == 0)
+            continue;
+
+        state.throughput = state.bytes * 1000 / elapsed;
+        int stalled = stalls.value(it.key());
+        if (state.failures > 0) {
+            setLimit(it.key(), state, state.limit / 2, tr("%1 个任务失败").arg(state.failures));
+        } else if (stalled > 0) {
+            setLimit(it.key(), state, state.limit / 2, tr("%1 个任务整个周期没有进度").arg(stalled));
+        } else if (state.active >= state.limit) {
+            // 只有名额用满时吞吐才说明上限是否合适
+            if (state.throughput > state.previousThroughput * (1.0 + kImprovement)) {
+                setLimit(it.key(), state, state.limit + 1,
+                         tr("吞吐提高到 %1").arg(formatRate(state.throughput)));
+            } else if (state.increased) {
+                setLimit(it.key(), state, state.limit * 3 / 4,
+                         tr("增加名额后吞吐没有提高（%1）").arg(formatRate(state.throughput)));
+            } else if (++state.steadySamples >= kProbeSamples) {
+                setLimit(it.key(), state, state.limit + 1, tr("吞吐持平，试探增加名额"));
+            }
+        }
+
+        state.previousThroughput = state.throughput;
+        state.bytes = 0;
+        state.failures = 0;
+    }
+    emitLimitChanges();
+}
@@ -0,0 +1,103 @@
+#ifndef CONCURRENCYCONTROLLER_H
+#define CONCURRENCYCONTROLLER_H
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include "taskrecordstore.h"
+
+class QTimer;
+
+// 按服务器自动调整同时传输的任务数（加性增、乘性减）。
+// 每个采样周期统计该服务器上全部传输的合计吞吐：名额用满且吞吐比上一周期明显提高时
+// 上限加一；加了名额吞吐却不再提高，或出现失败、卡顿（整个周期没有进度）时按比例降低。
+// 吞吐持平一段时间后再试探性地加一，适应链路变化。上限始终在配置的范围内。
+class ConcurrencyController : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct ServerState {
+        QString server;
+        int limit;
+        int active;
+        qint64 throughput;      // 最近一个采样周期的合计吞吐，字节/秒
+        qint64 bytesTransferred;    // 累计收到的字节
+        QString reason;         // 最近一次调整的原因
+    };
+
+    explicit ConcurrencyController(QObject *parent = nullptr);
+
+    // 上限的范围，新服务器从 min(2, maxLimit) 开始
+    void setLimits(int minLimit, int maxLimit);
+    int minLimit() const { return m_minLimit; }
+    int maxLimit() const { return m_maxLimit; }
+    // 全部服务器合计同时传输的任务数上限，0 表示不限；降低时正在进行的传输不受影响
+    void setTotalLimit(int limit) { m_totalLimit = qMax(0, limit); }
+    int totalLimit() const { return m_totalLimit; }
+
+    // 地址所在的服务器，本地路径返回空字符串
+    static QString serverOf(const QString &url);
+
+    bool hasSlot(const QString &server) const;
+    // 任务开始传输时占用名额，bytes 为已下载的字节数
+    void acquire(TaskHandle handle, const QString &server, qint64 bytes);
+    // 任务结束或暂停时归还名额；failed 为 true 时计入该服务器的失败次数
+    void release(TaskHandle handle, bool failed = false);
+    // 任务的累计已下载字节
+    void progress(TaskHandle handle, qint64 bytes);
+    // 全部传输累计收到的字节，用于估计整个队列的吞吐
+    qint64 bytesTransferred() const { return m_bytesTransferred; }
+
+    QList<ServerState> servers() const;
+
+signals:
+    void limitChanged(const QString &server, int limit, const QString &reason);
+
+private slots:
+    void sample();
+
+private:
+    struct Server {
+        int limit;
+        int active;
+        qint64 bytes;           // 本周期的字节数
+        qint64 totalBytes;
+        int failures;           // 本周期的失败次数
+        qint64 throughput;
+        qint64 previousThroughput;
+        bool increased;         // 上一次调整是加一
+        int steadySamples;      // 连续未调整的周期数
+        QString reason;
+    };
+
+    struct Transfer {
+        QString server;
+        qint64 bytes;
+        bool moved;             // 本周期有进度
+    };
+
+    struct LimitChange {
+        QString server;
+        int limit;
+        QString reason;
+    };
+
+    Server &server(const QString &name);
+    // 只修改并记下变化；遍历 m_servers 结束后再由 emitLimitChanges 发出信号，
+    // 接收方开始新任务时可能插入新服务器，不能在遍历中途通知
+    void setLimit(const QString &name, Server &state, int limit, const QString &reason);
+    void emitLimitChanges();
+
+    int m_minLimit;
+    int m_maxLimit;
+    int m_totalLimit;
+    QTimer *m_sampleTimer;
+    qint64 m_lastSample;
+    qint64 m_bytesTransferred;
+    QHash<QString, Server> m_servers;
+    QHash<TaskHandle, Transfer> m_transfers;
+    QList<LimitChange> m_limitChanges;
+};
+
+#endif // CONCURRENCYCONTROLLER_H
@@ -0,0 +1,336 @@
+#include "controlserver.h"
+#include "downloadmanager.h"
+#include "logger.h"
+#include "pathutils.h"
+#include "scanfilter.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMetaEnum>
+
+namespace {
+
+QString ok(const QStringList &fields = QStringList())
+{
+    return fields.isEmpty() ? QStringLiteral("ok") : QStringLiteral("ok\t") + fields.join('\t');
+}
+
+QString error(const QString &message)
+{
+    return QStringLiteral("error\t") + message;
+}
+
+QString statusName(int status)
+{
+    const char *key = QMetaEnum::fromType<DownloadTask::Status>().valueToKey(status);
+    return key ? QString::fromLatin1(key).toLower() : QString::number(status);
+}
+
+// 目录任务默认保存到默认保存路径下与远程目录同名的目录
+QString directoryName(QString url)
+{
+    while (url.endsWith('/') || url.endsWith('\\'))
+        url.chop(1);
+    return QFileInfo(toUncPath(url)).fileName();
+}
+
+} // namespace
+
+ControlServer::ControlServer(DownloadManager *manager, QObject *parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_server(new QLocalServer(this))
+    , m_otherInstance(false)
+{
+    connect(m_server, &QLocalServer::newConnection, this, &ControlServer::onNewConnection);
+}
+
+ControlServer::~ControlServer()
+{
+    m_server->close();
+}
+
+void ControlServer::setManager(DownloadManager *manager)
+{
+    m_manager = manager;
+    onNewConnection();
+}
+
+bool ControlServer::listen(const QString &name)
+{
+    m_otherInstance = false;
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    if (m_server->listen(name)) {
+        LOG_INFO(QString("控制接口已启动 - %1").arg(m_server->fullServerName()));
+        return true;
+    }
+
+    // 地址被占用而又连不上，是上次异常退出遗留的套接字文件
+    if (m_server->serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if (probe.waitForConnected(1000)) {
+            m_otherInstance = true;
+            LOG_WARNING(QString("控制接口已被其他实例占用 - %1").arg(name));
+            return false;
+        }
+        QLocalServer::removeServer(name);
+        if (m_server->listen(name)) {
+            LOG_INFO(QString("控制接口已启动 - %1").arg(m_server->fullServerName()));
+            return true;
+        }
+    }
+
+    LOG_WARNING(QString("控制接口启动失败 - %1: %2").arg(name).arg(m_server->errorString()));
+    return false;
+}
+
+QString ControlServer::errorString() const
+{
+    return m_server->errorString();
+}
+
+QString ControlServer::defaultName()
+{
+    QString user = qEnvironmentVariable("USER");
+    if (user.isEmpty())
+        user = qEnvironmentVariable("USERNAME");
+    return user.isEmpty() ? QStringLiteral("DownloadAssistant")
+                          : QStringLiteral("DownloadAssistant-") + user;
+}
+
+QStringList ControlServer::requestsFromArguments(const QStringList &arguments)
+{
+    QStringList requests;
+    for (const QString &argument : arguments) {
+        QString url = argument.trimmed();
+        if (url.isEmpty())
+            continue;
+        bool isDir = QFileInfo(toUncPath(url)).isDir();
+        requests.append((isDir ? QStringLiteral("adddir\t") : QStringLiteral("add\t")) + url);
+    }
+    if (requests.isEmpty())
+        requests.append(QStringLiteral("activate"));
+    return requests;
+}
+
+bool ControlServer::send(const QStringList &requests, QStringList *responses,
+                         const QString &name, int timeoutMs)
+{
+    QLocalSocket socket;
+    socket.connectToServer(name);
+    if (!socket.waitForConnected(timeoutMs))
+        return false;
+
+    socket.write((requests.join('\n') + '\n').toUtf8());
+    while (socket.bytesToWrite() > 0) {
+        if (!socket.waitForBytesWritten(timeoutMs))
+            return false;
+    }
+
+    int answered = 0;
+    while (answered < requests.size()) {
+        if (!socket.canReadLine() && !socket.waitForReadyRead(timeoutMs))
+            return false;
+        while (socket.canReadLine()) {
+            QString line = QString::fromUtf8(socket.readLine()).trimmed();
+            if (responses)
+                responses->append(line);
+            ++answered;
+        }
+    }
+    socket.disconnectFromServer();
+    return true;
+}
+
+QStringList ControlServer::execute(const QStringList &requests)
+{
+    QStringList responses;
+    responses.reserve(requests.size());
+
+    // 连续的 add/queue 请求先攒起来，保存目录或是否开始变化时再一次性加入
+    QStringList batch;
+    QString batchSavePath;
+    bool batchStart = false;
+
+    for (const QString &request : requests) {
+        const QStringList fields = request.split('\t');
+        const QString &verb = fields.first();
+        if (verb == "add" || verb == "queue") {
+            QString url = fields.value(1).trimmed();
+            QString savePath = fields.value(2).trimmed();
+            bool start = verb == "add";
+            if (!batch.isEmpty() && (savePath != batchSavePath || start != batchStart)) {
+                addBatch(batch, batchSavePath, batchStart, &responses);
+                batch.clear();
+            }
+            if (url.isEmpty()) {
+                addBatch(batch, batchSavePath, batchStart, &responses);
+                batch.clear();
+                responses.append(error(tr("缺少地址")));
+                continue;
+            }
+            batch.append(url);
+            batchSavePath = savePath;
+            batchStart = start;
+            continue;
+        }
+
+        addBatch(batch, batchSavePath, batchStart, &responses);
+        batch.clear();
+        responses.append(executeOne(fields));
+    }
+    addBatch(batch, batchSavePath, batchStart, &responses);
+    return responses;
+}
+
+void ControlServer::addBatch(const QStringList &urls, const QString &savePath, bool start,
+                             QStringList *responses)
+{
+    if (urls.isEmpty())
+        return;
+
+    const QStringList taskIds = m_manager->addTasks(urls, savePath);
+    for (const QString &taskId : taskIds) {
+        if (start)
+            m_manager->startTask(taskId);
+        responses->append(ok({taskId}));
+    }
+}
+
+QString ControlServer::executeOne(const QStringList &fields)
+{
+    const QString &verb = fields.first();
+    QString argument = fields.value(1).trimmed();
+
+    if (verb == "adddir") {
+        if (argument.isEmpty())
+            return error(tr("缺少地址"));
+        // 扫描线程不报告过滤规则的错误，无效的规则会变成不过滤，先在这里检查
+        QString filter = fields.value(3);
+        QString filterError;
+        ScanFilter::fromString(filter, &filterError);
+        if (!filterError.isEmpty())
+            return error(tr("过滤规则无效：%1").arg(filterError));
+        QString localPath = fields.value(2).trimmed();
+        if (localPath.isEmpty())
+            localPath = QDir(m_manager->getDefaultSavePath()).filePath(directoryName(argument));
+        QString taskId = m_manager->addDirectoryTask(argument, localPath, filter);
+        m_manager->startTask(taskId);
+        return ok({taskId});
+    }
+
+    if (verb == "status") {
+        if (argument.isEmpty()) {
+            return ok({QString::number(m_manager->taskCount()),
+                       QString::number(m_manager->taskCount(DownloadTask::Downloading)),
+                       QString::number(m_manager->taskCount(DownloadTask::Pending)),
+                       QString::number(m_manager->taskCount(DownloadTask::Paused)),
+                       QString::number(m_manager->historyCount(DownloadManager::CompletedHistory)),
+                       QString::number(m_manager->historyCount(DownloadManager::FailedHistory))});
+        }
+        const TaskRecord *record = m_manager->taskRecord(argument);
+        if (!record)
+            return error(tr("任务不在队列中"));
+        return ok({statusName(record->status),
+                   QString::number(record->downloadedSize),
+                   QString::number(record->totalSize)});
+    }
+
+    if (verb == "limits") {
+        QStringList fields;
+        const QList<ConcurrencyController::ServerState> servers = m_manager->concurrencyState();
+        for (const ConcurrencyController::ServerState &server : servers) {
+            fields.append(QString("%1=%2/%3").arg(server.server.isEmpty() ? QStringLiteral("local") : server.server)
+                          .arg(server.active).arg(server.limit));
+        }
+        return ok(fields);
+    }
+
+    if (verb == "profiles") {
+        QStringList fields = {m_manager->activeProfileName()};
+        const QList<ScheduleProfile> profiles = m_manager->scheduleProfiles();
+        for (const ScheduleProfile &profile : profiles)
+            fields.append(profile.toString());
+        return ok(fields);
+    }
+    if (verb == "profile-add") {
+        ScheduleProfile profile;
+        QString message;
+        if (!ScheduleProfile::fromString(argument, &profile, &message))
+            return error(message);
+        QList<ScheduleProfile> profiles = m_manager->scheduleProfiles();
+        profiles.append(profile);
+        m_manager->setScheduleProfiles(profiles);
+        return ok({profile.name});
+    }
+    if (verb == "profile-clear") {
+        m_manager->setScheduleProfiles(QList<ScheduleProfile>());
+        return ok();
+    }
+
+    if (verb == "pause" || verb == "resume" || verb == "cancel") {
+        if (!m_manager->taskRecord(argument))
+            return error(tr("任务不在队列中"));
+        if (verb == "pause")
+            m_manager->pauseTask(argument);
+        else if (verb == "resume")
+            m_manager->resumeTask(argument);
+        else
+            m_manager->cancelTask(argument);
+        return ok();
+    }
+
+    if (verb == "pause-all") {
+        m_manager->pauseAllTasks();
+        return ok();
+    }
+    if (verb == "resume-all") {
+        m_manager->startAllTasks();
+        return ok();
+    }
+    if (verb == "cancel-all") {
+        m_manager->cancelAllTasks();
+        return ok();
+    }
+
+    if (verb == "activate") {
+        emit activationRequested();
+        return ok();
+    }
+
+    return error(tr("未知的请求: %1").arg(verb));
+}
+
+void ControlServer::onNewConnection()
+{
+    if (!m_manager)
+        return;
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::readyRead, this, &ControlServer::onReadyRead);
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void ControlServer::onReadyRead()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    if (!socket)
+        return;
+
+    // 一次处理已到达的全部完整行，不完整的行留到下次
+    QStringList requests;
+    while (socket->canReadLine()) {
+        QString line = QString::fromUtf8(socket->readLine());
+        while (line.endsWith('\n') || line.endsWith('\r'))
+            line.chop(1);
+        if (!line.isEmpty())
+            requests.append(line);
+    }
+    if (requests.isEmpty())
+        return;
+
+    const QStringList responses = execute(requests);
+    socket->write((responses.join('\n') + '\n').toUtf8());
+}
@@ -0,0 +1,77 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <QObject>
+#include <QStringList>
+
+class QLocalServer;
+class QLocalSocket;
+class DownloadManager;
+
+// 本机控制接口：运行中的实例在本地套接字（Windows 上为命名管道）上接受其他进程的请求，
+// 构建脚本等可以直接把任务交给正在运行的队列，第二次启动程序时也通过它转交参数。
+//
+// 协议为 UTF-8 文本，每行一个请求，字段以制表符分隔；每个请求按顺序对应一行应答，
+// 成功为 "ok[\t字段...]"，失败为 "error\t原因"。客户端可以连续发送多行而不等待应答。
+//   add <地址> [保存目录]              添加文件任务并开始下载，应答任务 ID
+//   queue <地址> [保存目录]            只加入队列，等待中的任务在其他任务结束后依次开始
+//   adddir <地址> [本地目录] [过滤规则] 添加目录任务并开始下载，应答任务 ID
+//   status                             应答 总数 下载中 等待 暂停 已完成历史 失败历史
+//   status <任务ID>                    应答 状态 已下载字节 总字节
+//   limits                             应答每个服务器的 服务器=传输中/并发上限
+//   profiles                           应答 当前时段名称 全部时段...
+//   profile-add <时段>                 追加时段，格式见 ScheduleProfile::fromString
+//   profile-clear                      删除全部时段
+//   pause|resume|cancel <任务ID>
+//   pause-all|resume-all|cancel-all
+//   activate                           请求显示主窗口
+// 同一批数据中连续的 add/queue 请求合并为一次 addTasks，只写一次数据库。
+class ControlServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // manager 可以为空，在打开任务数据库之前先占用服务名；
+    // 设置 manager 之前到达的连接留在队列中，setManager 后再处理
+    explicit ControlServer(DownloadManager *manager, QObject *parent = nullptr);
+    ~ControlServer();
+
+    void setManager(DownloadManager *manager);
+
+    // 开始监听，只允许当前用户连接；上次异常退出遗留的套接字会被清除，
+    // 已有其他实例在监听时返回 false，otherInstanceRunning() 为 true
+    bool listen(const QString &name = defaultName());
+    QString errorString() const;
+    bool otherInstanceRunning() const { return m_otherInstance; }
+
+    // 按顺序执行请求，返回对应的应答
+    QStringList execute(const QStringList &requests);
+
+    // 当前用户的默认服务名
+    static QString defaultName();
+
+    // 把命令行参数转换为请求：每个参数是一个文件或目录地址，没有参数时为 activate
+    static QStringList requestsFromArguments(const QStringList &arguments);
+
+    // 把请求发给正在监听的实例并等待全部应答；没有实例在监听时返回 false
+    static bool send(const QStringList &requests, QStringList *responses = nullptr,
+                     const QString &name = defaultName(), int timeoutMs = 5000);
+
+signals:
+    void activationRequested();
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+
+private:
+    QString executeOne(const QStringList &fields);
+    void addBatch(const QStringList &urls, const QString &savePath, bool start,
+                  QStringList *responses);
+
+    DownloadManager *m_manager;
+    QLocalServer *m_server;
+    bool m_otherInstance;
+};
+
+#endif // CONTROLSERVER_H
@@ -0,0 +1,323 @@
+#include "directoryjob.h"
+#include <QMutexLocker>
+
+DirectoryJob::DirectoryJob()
+    : m_savedCount(0)
+    , m_prescan(false)
+    , m_deleteRemoved(false)
+    , m_scanFinished(false)
+    , m_scanCancelled(false)
+    , m_completedCount(0)
+    , m_failedCount(0)
+    , m_skippedCount(0)
+    , m_deletedCount(0)
+    , m_totalBytes(0)
+    , m_completedBytes(0)
+    , m_failedBytes(0)
+{
+}
+
+QString DirectoryJob::filterText() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_filterText;
+}
+
+void DirectoryJob::setFilterText(const QString &text)
+{
+    QMutexLocker locker(&m_mutex);
+    m_filterText = text;
+}
+
+bool DirectoryJob::isPrescan() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_prescan;
+}
+
+void DirectoryJob::setPrescan(bool prescan)
+{
+    QMutexLocker locker(&m_mutex);
+    m_prescan = prescan;
+}
+
+bool DirectoryJob::isMirror() const
+{
+    QMutexLocker locker(&m_mutex);
+    return !m_syncId.isEmpty();
+}
+
+QString DirectoryJob::syncId() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_syncId;
+}
+
+void DirectoryJob::setSyncId(const QString &syncId)
+{
+    QMutexLocker locker(&m_mutex);
+    m_syncId = syncId;
+}
+
+bool DirectoryJob::deleteRemoved() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_deleteRemoved;
+}
+
+void DirectoryJob::setDeleteRemoved(bool remove)
+{
+    QMutexLocker locker(&m_mutex);
+    m_deleteRemoved = remove;
+}
+
+void DirectoryJob::appendEntry(const QString &relativePath, qint64 size, qint64 modified)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_paths.contains(relativePath))
+        return;
+
+    Entry entry;
+    entry.relativePath = relativePath;
+    entry.size = size;
+    entry.modified = modified;
+    entry.status = EntryPending;
+    m_entries.append(entry);
+    m_paths.insert(relativePath);
+    m_totalBytes += size;
+    m_entryAdded.wakeAll();
+}
+
+void DirectoryJob::addSkipped(int count)
+{
+    QMutexLocker locker(&m_mutex);
+    m_skippedCount += count;
+}
+
+void DirectoryJob::addDeleted(int count)
+{
+    QMutexLocker locker(&m_mutex);
+    m_deletedCount += count;
+}
+
+void DirectoryJob::setScanFinished(bool finished)
+{
+    QMutexLocker locker(&m_mutex);
+    m_scanFinished = finished;
+    m_entryAdded.wakeAll();
+}
+
+bool DirectoryJob::isScanFinished() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_scanFinished;
+}
+
+void DirectoryJob::requestCancelScan()
+{
+    QMutexLocker locker(&m_mutex);
+    m_scanCancelled = true;
+}
+
+bool DirectoryJob::isScanCancelled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_scanCancelled;
+}
+
+bool DirectoryJob::waitForEntry(int index, Entry *entry, unsigned long timeoutMs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (index >= m_entries.size() && !m_scanFinished)
+        m_entryAdded.wait(&m_mutex, timeoutMs);
+    if (index >= m_entries.size())
+        return false;
+    *entry = m_entries.at(index);
+    return true;
+}
+
+void DirectoryJob::markEntry(int index, EntryStatus status, const QString &error)
+{
+    QMutexLocker locker(&m_mutex);
+    if (index < 0 || index >= m_entries.size())
+        return;
+
+    Entry &entry = m_entries[index];
+    if (entry.status == status)
+        return;
+    if (entry.status == EntryCompleted) {
+        --m_completedCount;
+        m_completedBytes -= entry.size;
+    } else if (entry.status == EntryFailed) {
+        --m_failedCount;
+        m_failedBytes -= entry.size;
+    }
+
+    entry.status = status;
+    if (index < m_savedCount)
+        m_changed.insert(index);
+    if (status == EntryCompleted) {
+        ++m_completedCount;
+        m_completedBytes += entry.size;
+        m_errors.remove(index);
+    } else if (status == EntryFailed) {
+        ++m_failedCount;
+        m_failedBytes += entry.size;
+        m_errors.insert(index, error);
+    } else {
+        m_errors.remove(index);
+    }
+}
+
+int DirectoryJob::fileCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.size();
+}
+
+int DirectoryJob::completedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_completedCount;
+}
+
+int DirectoryJob::failedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_failedCount;
+}
+
+int DirectoryJob::skippedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_skippedCount;
+}
+
+int DirectoryJob::deletedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_deletedCount;
+}
+
+qint64 DirectoryJob::totalBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_totalBytes;
+}
+
+qint64 DirectoryJob::completedBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_completedBytes;
+}
+
+qint64 DirectoryJob::failedBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_failedBytes;
+}
+
+QList<DirectoryJob::Failure> DirectoryJob::failures() const
+{
+    QMutexLocker locker(&m_mutex);
+    QList<Failure> result;
+    for (auto it = m_errors.constBegin(); it != m_errors.constEnd(); ++it) {
+        Failure failure;
+        failure.relativePath = m_entries.at(it.key()).relativePath;
+        failure.error = it.value();
+        result.append(failure);
+    }
+    return result;
+}
+
+QJsonObject DirectoryJob::toJson() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QJsonObject json;
+    json["filter"] = m_filterText;
+    json["prescan"] = m_prescan;
+    if (!m_syncId.isEmpty()) {
+        json["syncId"] = m_syncId;
+        json["deleteRemoved"] = m_deleteRemoved;
+        json["deleted"] = m_deletedCount;
+    }
+    json["scanFinished"] = m_scanFinished;
+    json["skipped"] = m_skippedCount;
+    return json;
+}
+
+QJsonArray DirectoryJob::takeChangedEntries()
+{
+    QMutexLocker locker(&m_mutex);
+
+    // 每个条目保存为数组，避免重复的键名；暂停、失败等状态变化只写变化的条目
+    QJsonArray changes;
+    auto append = [this, &changes](int index) {
+        const Entry &entry = m_entries.at(index);
+        QJsonArray record;
+        record.append(index);
+        record.append(entry.relativePath);
+        record.append(entry.size);
+        record.append(entry.modified);
+        record.append(static_cast<int>(entry.status));
+        record.append(m_errors.value(index));
+        changes.append(record);
+    };
+    for (auto it = m_changed.constBegin(); it != m_changed.constEnd(); ++it)
+        append(*it);
+    for (int index = m_savedCount; index < m_entries.size(); ++index)
+        append(index);
+
+    m_changed.clear();
+    m_savedCount = m_entries.size();
+    return changes;
+}
+
+void DirectoryJob::markAllChanged()
+{
+    QMutexLocker locker(&m_mutex);
+    m_changed.clear();
+    m_savedCount = 0;
+}
+
+QSharedPointer<DirectoryJob> DirectoryJob::fromJson(const QJsonObject &json)
+{
+    QSharedPointer<DirectoryJob> job(new DirectoryJob);
+    job->m_filterText = json["filter"].toString();
+    job->m_prescan = json["prescan"].toBool();
+    job->m_syncId = json["syncId"].toString();
+    job->m_deleteRemoved = json["deleteRemoved"].toBool();
+    job->m_deletedCount = json["deleted"].toInt();
+    job->m_scanFinished = json["scanFinished"].toBool();
+    job->m_skippedCount = json["skipped"].toInt();
+
+    const QJsonArray entries = json["entries"].toArray();
+    job->m_entries.reserve(entries.size());
+    for (const QJsonValue &value : entries) {
+        QJsonArray record = value.toArray();
+        Entry entry;
+        entry.relativePath = record.at(0).toString();
+        entry.size = record.at(1).toVariant().toLongLong();
+        entry.modified = record.at(2).toVariant().toLongLong();
+        entry.status = static_cast<quint8>(record.at(3).toInt());
+        job->m_entries.append(entry);
+        job->m_paths.insert(entry.relativePath);
+        job->m_totalBytes += entry.size;
+        if (entry.status == EntryCompleted) {
+            ++job->m_completedCount;
+            job->m_completedBytes += entry.size;
+        } else if (entry.status == EntryFailed) {
+            ++job->m_failedCount;
+            job->m_failedBytes += entry.size;
+        }
+    }
+
+    const QJsonArray errors = json["errors"].toArray();
+    for (const QJsonValue &value : errors) {
+        QJsonArray record = value.toArray();
+        job->m_errors.insert(record.at(0).toInt(), record.at(1).toString());
+    }
+    job->m_savedCount = job->m_entries.size();
+    return job;
+}
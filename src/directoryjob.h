@@ -0,0 +1,113 @@
+#ifndef DIRECTORYJOB_H
+#define DIRECTORYJOB_H
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include <QWaitCondition>
+
+// 目录下载任务的子条目集合。
+// 子文件只以紧凑记录保存，不再各自创建 DownloadTask；
+// 扫描线程追加条目的同时，下载线程可以按顺序取出处理。
+class DirectoryJob
+{
+public:
+    enum EntryStatus : quint8 {
+        EntryPending = 0,
+        EntryCompleted = 1,
+        EntryFailed = 2
+    };
+
+    struct Entry {
+        QString relativePath;   // 相对目录根的路径，以 '/' 分隔
+        qint64 size;
+        qint64 modified;        // 远程修改时间，毫秒时间戳
+        quint8 status;
+    };
+
+    struct Failure {
+        QString relativePath;
+        QString error;
+    };
+
+    DirectoryJob();
+
+    QString filterText() const;
+    void setFilterText(const QString &text);
+
+    // 预扫描：目录全部扫描完、总大小确定后才开始传输
+    bool isPrescan() const;
+    void setPrescan(bool prescan);
+
+    // 镜像同步：本地目录与远程保持一致，可选删除远程已移除的文件
+    bool isMirror() const;
+    QString syncId() const;
+    void setSyncId(const QString &syncId);
+    bool deleteRemoved() const;
+    void setDeleteRemoved(bool remove);
+
+    // 扫描线程使用
+    void appendEntry(const QString &relativePath, qint64 size, qint64 modified);
+    void addSkipped(int count);
+    void addDeleted(int count);
+    void setScanFinished(bool finished);
+    bool isScanFinished() const;
+    void requestCancelScan();
+    bool isScanCancelled() const;
+
+    // 下载线程使用：条目尚未扫描到时最多等待 timeoutMs 毫秒
+    bool waitForEntry(int index, Entry *entry, unsigned long timeoutMs);
+    void markEntry(int index, EntryStatus status, const QString &error = QString());
+
+    // 汇总信息
+    int fileCount() const;
+    int completedCount() const;
+    int failedCount() const;
+    int skippedCount() const;
+    int deletedCount() const;
+    qint64 totalBytes() const;
+    // 已下载完成的子文件字节，作为目录任务的下载进度
+    qint64 completedBytes() const;
+    // 下载失败的子文件字节，没有实际传输，不计入进度
+    qint64 failedBytes() const;
+    QList<Failure> failures() const;
+
+    // 只包含任务级的字段，条目由 takeChangedEntries 增量保存
+    QJsonObject toJson() const;
+    // 上次调用以来新增或状态变化的条目，每个为 [序号, 路径, 大小, 修改时间, 状态, 错误信息]
+    QJsonArray takeChangedEntries();
+    // 全部条目都需要重新保存（例如任务换了 ID）
+    void markAllChanged();
+    // json 中的 entries 为 [路径, 大小, 修改时间, 状态]，errors 为 [序号, 错误信息]，视为已保存
+    static QSharedPointer<DirectoryJob> fromJson(const QJsonObject &json);
+
+private:
+    mutable QMutex m_mutex;
+    QWaitCondition m_entryAdded;
+    QVector<Entry> m_entries;
+    QSet<QString> m_paths;          // 重新扫描时去重
+    QHash<int, QString> m_errors;   // 只为失败的条目保存错误信息
+    int m_savedCount;               // 此前的条目已保存过
+    QSet<int> m_changed;            // 已保存过、之后状态又变化的条目
+    QString m_filterText;
+    bool m_prescan;
+    QString m_syncId;
+    bool m_deleteRemoved;
+    bool m_scanFinished;
+    bool m_scanCancelled;
+    int m_completedCount;
+    int m_failedCount;
+    int m_skippedCount;
+    int m_deletedCount;
+    qint64 m_totalBytes;
+    qint64 m_completedBytes;
+    qint64 m_failedBytes;
+};
+
+#endif // DIRECTORYJOB_H
@@ -1,50 +1,212 @@
 #include "directoryworker.h"
-#include "downloadmanager.h"
+#include "directoryjob.h"
+#include "syncmanifest.h"
+#include <QDateTime>
 #include <QDir>
+#include <QDirIterator>
+#include <QFile>
 #include <QFileInfo>
 #include <QUrl>
 #include "logger.h"
 #include "pathutils.h"
 
 DirectoryWorker::DirectoryWorker(const QString &dirUrl, const QString &localPath,
-                                 DownloadManager *manager, QObject *parent)
-    : QThread(parent), m_dirUrl(dirUrl), m_localPath(localPath), m_manager(manager)
+                                 const QSharedPointer<DirectoryJob> &job, QObject *parent)
+    : QThread(parent), m_dirUrl(dirUrl), m_localPath(localPath), m_job(job),
+      m_manifest(nullptr), m_trustDirectoryMtime(false), m_queuedCount(0), m_skippedCount(0),
+      m_filteredCount(0), m_listErrors(0), m_lastProgressMs(0)
 {
+    m_pool.setMaxThreadCount(4);
+}
+
+void DirectoryWorker::setParallelism(int threads)
+{
+    m_pool.setMaxThreadCount(qMax(1, threads));
 }
 
 void DirectoryWorker::run()
 {
-    scanDirectory(m_dirUrl, m_localPath);
+    m_filter = ScanFilter::fromString(m_job->filterText());
+
+    // 与上一次同步的清单比对，只排队新增或变化的文件
+    SyncManifest manifest(m_dirUrl, m_localPath, m_filter.text());
+    manifest.load();
+    m_manifest = &manifest;
+
+    // 每个子目录作为独立的列目录任务放入线程池，子任务会继续提交更深层的目录
+    QString rootUrl = m_dirUrl;
+    QString rootLocal = m_localPath;
+    m_pool.start([this, rootUrl, rootLocal]() { scanDirectory(rootUrl, rootLocal, QString()); });
+    m_pool.waitForDone();
+
+    // 扫描被取消时清单不完整，不覆盖上一次的记录
+    if (!m_job->isScanCancelled()) {
+        manifest.save();
+        if (m_job->isMirror() && m_job->deleteRemoved())
+            removeDeletedFiles(manifest.currentPaths());
+    }
+    m_manifest = nullptr;
+
+    m_job->addSkipped(m_skippedCount.loadRelaxed());
+    m_job->setScanFinished(true);
+    reportProgress(true);
+
+    LOG_INFO(QString("目录扫描完成 - %1, 排队: %2, 未变化跳过: %3, 过滤: %4")
+             .arg(m_dirUrl).arg(m_queuedCount.loadRelaxed())
+             .arg(m_skippedCount.loadRelaxed()).arg(m_filteredCount.loadRelaxed()));
     emit finished();
 }
 
-void DirectoryWorker::scanDirectory(const QString &dirUrl, const QString &localPath)
+void DirectoryWorker::reportProgress(bool force)
 {
-    if (!m_manager)
+    // 多个扫描线程共享同一个节流时间戳，最多每 500 毫秒发布一次
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 last = m_lastProgressMs.loadRelaxed();
+    if (!force && (now - last < 500 || !m_lastProgressMs.testAndSetRelaxed(last, now)))
+        return;
+    emit scanProgress(m_job->fileCount(), m_job->totalBytes());
+}
+
+void DirectoryWorker::scanDirectory(const QString &dirUrl, const QString &localPath,
+                                    const QString &relativePath)
+{
+    if (m_job->isScanCancelled())
         return;
 
     QString uncPath = toUncPath(dirUrl);
-    QDir dir(uncPath);
-    if (!dir.exists())
+    QFileInfo dirInfo(uncPath);
+    if (!dirInfo.isDir() || !dirInfo.isReadable()) {
+        // 列目录失败时本次结果不完整，镜像同步不能据此删除本地文件
+        m_listErrors.fetchAndAddRelaxed(1);
+        LOG_WARNING(QString("无法列出目录: %1").arg(uncPath));
         return;
+    }
 
     QDir().mkpath(localPath);
 
-    QFileInfoList list = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot);
-    for (const QFileInfo &info : list) {
+    // 逐条遍历目录，类型、大小和修改时间都取自同一次列目录的结果，
+    // 不再对每个条目单独发起元数据请求
+    QDirIterator it(uncPath, QDir::AllEntries | QDir::NoDotAndDotDot);
+    while (it.hasNext() && !m_job->isScanCancelled()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
         QString name = info.fileName();
         QString childUrl = dirUrl;
         if (!childUrl.endsWith('/'))
             childUrl += '/';
         childUrl += name;
+        QString childRelative = relativePath.isEmpty() ? name : relativePath + '/' + name;
 
-        if (info.isDir()) {
+        QDateTime modified = info.lastModified();
+        bool isDir = info.isDir();
+
+        // 过滤规则在遍历时直接应用，被排除的目录不会再被列出
+        if (isDir ? !m_filter.acceptsDirectory(childRelative, name)
+                  : !m_filter.acceptsFile(childRelative, name, info.size(), modified)) {
+            m_filteredCount.fetchAndAddRelaxed(1);
+            continue;
+        }
+
+        SyncManifest::Entry entry;
+        entry.path = childRelative;
+        entry.size = isDir ? 0 : info.size();
+        entry.modified = modified.isValid() ? modified.toMSecsSinceEpoch() : 0;
+        entry.flags = 0;
+        const SyncManifest::Entry *previous = m_manifest->previous(childRelative);
+
+        if (isDir) {
             QString subLocal = QDir(localPath).filePath(name);
-            scanDirectory(childUrl, subLocal);
+            entry.flags = SyncManifest::IsDir;
+            m_manifest->record(entry);
+
+            // 目录修改时间未变且上次已全部同步时，不再列出该目录
+            if (m_trustDirectoryMtime && previous && (previous->flags & SyncManifest::IsDir)
+                && entry.modified != 0 && previous->modified == entry.modified
+                && m_manifest->isSubtreeSynced(childRelative) && QFileInfo(subLocal).isDir()) {
+                m_manifest->carryOverSubtree(childRelative);
+                continue;
+            }
+            m_pool.start([this, childUrl, subLocal, childRelative]() {
+                scanDirectory(childUrl, subLocal, childRelative);
+            });
         } else {
-            QString taskId = m_manager->addTask(childUrl, localPath);
-            m_manager->startTask(taskId);
+            bool skip = false;
+            if (m_job->isMirror()) {
+                // 镜像同步直接与本地文件比较，下载完成的文件修改时间与远程一致
+                QFileInfo localInfo(QDir(localPath).filePath(name));
+                skip = localInfo.exists() && localInfo.size() == entry.size
+                       && (entry.modified == 0
+                           || qAbs(localInfo.lastModified().toMSecsSinceEpoch() - entry.modified) < 2000);
+            } else if (previous && !(previous->flags & SyncManifest::IsDir)
+                       && previous->size == entry.size
+                       && (entry.modified == 0 || previous->modified == entry.modified)) {
+                // 远程大小和修改时间与清单一致，且本地文件完整存在时跳过
+                QFileInfo localInfo(QDir(localPath).filePath(name));
+                skip = localInfo.exists() && localInfo.size() == entry.size;
+            }
+            if (skip) {
+                entry.flags = SyncManifest::Synced;
+                m_manifest->record(entry);
+                m_skippedCount.fetchAndAddRelaxed(1);
+                continue;
+            }
+
+            // 远程文件已变化：上一版本下载到一半的临时文件不会再被续传，直接删除
+            if (previous && !(previous->flags & SyncManifest::IsDir)
+                && (previous->size != entry.size || previous->modified != entry.modified)) {
+                QFile::remove(partialDownloadPath(QDir(localPath).filePath(name),
+                                                  previous->size, previous->modified));
+            }
+
+            m_manifest->record(entry);
+            m_job->appendEntry(childRelative, entry.size, entry.modified);
+            m_queuedCount.fetchAndAddRelaxed(1);
+            reportProgress(false);
         }
     }
 }
 
+void DirectoryWorker::removeDeletedFiles(const QSet<QString> &remotePaths)
+{
+    // 远程列目录出错或为空时不删除任何本地文件，避免共享暂时不可用时清空镜像
+    if (m_listErrors.loadRelaxed() > 0 || remotePaths.isEmpty()) {
+        LOG_WARNING(QString("远程目录列出不完整，跳过删除本地文件 - %1").arg(m_dirUrl));
+        return;
+    }
+
+    int deleted = 0;
+    pruneLocalDirectory(m_localPath, QString(), remotePaths, &deleted);
+    m_job->addDeleted(deleted);
+    LOG_INFO(QString("镜像同步删除本地文件 %1 个 - %2").arg(deleted).arg(m_localPath));
+}
+
+void DirectoryWorker::pruneLocalDirectory(const QString &localPath, const QString &relativePath,
+                                          const QSet<QString> &remotePaths, int *deleted)
+{
+    QDirIterator it(localPath, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        QString name = info.fileName();
+        QString childRelative = relativePath.isEmpty() ? name : relativePath + '/' + name;
+
+        // 过滤规则之外的内容不属于镜像范围，保持不动
+        if (info.isDir()) {
+            if (!m_filter.acceptsDirectory(childRelative, name))
+                continue;
+            pruneLocalDirectory(info.filePath(), childRelative, remotePaths, deleted);
+            if (!remotePaths.contains(childRelative))
+                QDir().rmdir(info.filePath());  // 只删除已经清空的目录
+            continue;
+        }
+
+        if (remotePaths.contains(childRelative) || name.endsWith(".dapart"))
+            continue;
+        if (!m_filter.acceptsFile(childRelative, name, info.size(), info.lastModified()))
+            continue;
+        if (QFile::remove(info.filePath())) {
+            ++(*deleted);
+            LOG_INFO(QString("删除远程已移除的文件: %1").arg(info.filePath()));
+        }
+    }
+}
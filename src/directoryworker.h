@@ -2,29 +2,55 @@
 #define DIRECTORYWORKER_H
 
 #include <QThread>
+#include <QThreadPool>
 #include <QString>
+#include <QSharedPointer>
+#include <QSet>
+#include <QAtomicInteger>
+#include "scanfilter.h"
 
-class DownloadManager;
+class DirectoryJob;
+class SyncManifest;
 
 class DirectoryWorker : public QThread
 {
     Q_OBJECT
 public:
     DirectoryWorker(const QString &dirUrl, const QString &localPath,
-                    DownloadManager *manager, QObject *parent = nullptr);
+                    const QSharedPointer<DirectoryJob> &job, QObject *parent = nullptr);
+
+    void setTrustDirectoryMtime(bool trust) { m_trustDirectoryMtime = trust; }
+    // 同时列出的子目录数量，高延迟共享上并发列目录可以明显缩短扫描时间
+    void setParallelism(int threads);
 
 signals:
     void finished();
+    // 扫描过程中定期发布已发现的文件数和总字节数
+    void scanProgress(int fileCount, qint64 totalBytes);
 
 protected:
     void run() override;
 
 private:
-    void scanDirectory(const QString &dirUrl, const QString &localPath);
+    void scanDirectory(const QString &dirUrl, const QString &localPath,
+                       const QString &relativePath);
+    void reportProgress(bool force);
+    void removeDeletedFiles(const QSet<QString> &remotePaths);
+    void pruneLocalDirectory(const QString &localPath, const QString &relativePath,
+                             const QSet<QString> &remotePaths, int *deleted);
 
     QString m_dirUrl;
     QString m_localPath;
-    DownloadManager *m_manager;
+    QSharedPointer<DirectoryJob> m_job;
+    ScanFilter m_filter;
+    SyncManifest *m_manifest;
+    QThreadPool m_pool;
+    bool m_trustDirectoryMtime;
+    QAtomicInt m_queuedCount;
+    QAtomicInt m_skippedCount;
+    QAtomicInt m_filteredCount;
+    QAtomicInt m_listErrors;
+    QAtomicInteger<qint64> m_lastProgressMs;
 };
 
 #endif // DIRECTORYWORKER_H
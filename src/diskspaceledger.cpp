@@ -0,0 +1,93 @@
+#include "diskspaceledger.h"
+#include <QDir>
+#include <QFileInfo>
+#include <limits>
+
+namespace {
+// 默认余量，避免把系统盘写满
+const qint64 kDefaultMargin = 256LL * 1024 * 1024;
+}
+
+DiskSpaceLedger::DiskSpaceLedger()
+    : m_margin(kDefaultMargin)
+{
+}
+
+QString DiskSpaceLedger::volumeOf(const QString &directory)
+{
+    auto it = m_volumeOfDirectory.constFind(directory);
+    if (it != m_volumeOfDirectory.constEnd())
+        return it.value();
+
+    // 保存目录在开始下载时才创建，向上找到已存在的目录
+    QString existing = QDir::cleanPath(QFileInfo(directory).absoluteFilePath());
+    while (!QFileInfo::exists(existing)) {
+        QString parent = QFileInfo(existing).path();
+        if (parent == existing)
+            break;
+        existing = parent;
+    }
+
+    QStorageInfo storage(existing);
+    QString volume = storage.isValid() ? storage.rootPath() : QString();
+    m_volumeOfDirectory.insert(directory, volume);
+    return volume;
+}
+
+qint64 DiskSpaceLedger::available(const QString &directory)
+{
+    // 无法确定所在的卷时不做限制，交给写入时的错误处理
+    QString volume = volumeOf(directory);
+    if (volume.isEmpty())
+        return std::numeric_limits<qint64>::max();
+
+    // 可用空间每次重新读取，其他程序写入或删除的文件也能反映出来
+    QStorageInfo storage(volume);
+    if (!storage.isValid() || !storage.isReady())
+        return std::numeric_limits<qint64>::max();
+    return storage.bytesAvailable() - m_reservedByVolume.value(volume) - m_margin;
+}
+
+bool DiskSpaceLedger::reserve(TaskHandle handle, const QString &directory, qint64 bytes)
+{
+    release(handle);
+    bytes = qMax<qint64>(0, bytes);
+
+    if (bytes > 0 && available(directory) < bytes)
+        return false;
+
+    QString volume = volumeOf(directory);
+    m_reservations.insert(handle, Reservation{volume, bytes});
+    m_reservedByVolume[volume] += bytes;
+    return true;
+}
+
+void DiskSpaceLedger::update(TaskHandle handle, qint64 remaining)
+{
+    auto it = m_reservations.find(handle);
+    if (it == m_reservations.end())
+        return;
+
+    remaining = qMax<qint64>(0, remaining);
+    m_reservedByVolume[it->volume] += remaining - it->bytes;
+    it->bytes = remaining;
+}
+
+void DiskSpaceLedger::release(TaskHandle handle)
+{
+    auto it = m_reservations.find(handle);
+    if (it == m_reservations.end())
+        return;
+
+    qint64 &reserved = m_reservedByVolume[it->volume];
+    reserved -= it->bytes;
+    if (reserved <= 0)
+        m_reservedByVolume.remove(it->volume);
+    m_reservations.erase(it);
+}
+
+void DiskSpaceLedger::clear()
+{
+    m_reservations.clear();
+    m_reservedByVolume.clear();
+}
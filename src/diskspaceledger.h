@@ -0,0 +1,48 @@
+#ifndef DISKSPACELEDGER_H
+#define DISKSPACELEDGER_H
+
+#include <QHash>
+#include <QStorageInfo>
+#include <QString>
+#include "taskrecordstore.h"
+
+// 目标磁盘的预留账本：任务开始前按剩余字节在其保存目录所在的卷上预留空间，
+// 卷的可用空间减去已有预留不足时不允许开始。已落盘的字节同时从预留和可用空间中扣除，
+// 因此传输中随进度更新剩余字节即可，两者之差保持不变。
+//
+// 保存目录到卷的对应关系按目录缓存，读取挂载表只在第一次遇到该目录时进行。
+class DiskSpaceLedger
+{
+public:
+    DiskSpaceLedger();
+
+    // 每个卷上留给系统和其他程序的余量
+    void setMargin(qint64 bytes) { m_margin = bytes; }
+    qint64 margin() const { return m_margin; }
+
+    // 为任务预留 bytes 字节，已有预留时先释放；空间不足时不预留并返回 false
+    bool reserve(TaskHandle handle, const QString &directory, qint64 bytes);
+    // 更新任务仍需写入的字节数
+    void update(TaskHandle handle, qint64 remaining);
+    void release(TaskHandle handle);
+    void clear();
+    bool isReserved(TaskHandle handle) const { return m_reservations.contains(handle); }
+
+    // 保存目录所在卷扣除预留和余量后还能接纳的字节数，无法确定所在的卷时不限制
+    qint64 available(const QString &directory);
+    // 保存目录所在卷的根路径，目录尚不存在时取最近的已存在上级目录
+    QString volumeOf(const QString &directory);
+
+private:
+    struct Reservation {
+        QString volume;
+        qint64 bytes;
+    };
+
+    qint64 m_margin;
+    QHash<QString, QString> m_volumeOfDirectory;
+    QHash<QString, qint64> m_reservedByVolume;
+    QHash<TaskHandle, Reservation> m_reservations;
+};
+
+#endif // DISKSPACELEDGER_H
@@ -0,0 +1,31 @@
+#ifndef DOWNLOADER_H
+#define DOWNLOADER_H
+
+#include <QObject>
+#include "downloadtask.h"
+
+// 传输后端接口：DownloadManager 只通过它启动、暂停、继续和取消任务，
+// 结果以信号返回。默认实现为 SmbDownloader，基准测试可换成不做 I/O 的实现。
+class Downloader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Downloader(QObject *parent = nullptr) : QObject(parent) {}
+
+    virtual bool startDownload(DownloadTask *task) = 0;
+    virtual void pauseDownload(DownloadTask *task) = 0;
+    virtual void resumeDownload(DownloadTask *task) = 0;
+    virtual void cancelDownload(DownloadTask *task) = 0;
+
+signals:
+    void downloadStarted(DownloadTask *task);
+    void downloadPaused(DownloadTask *task);
+    void downloadResumed(DownloadTask *task);
+    void downloadCancelled(DownloadTask *task);
+    void downloadCompleted(DownloadTask *task);
+    void downloadFailed(DownloadTask *task, const QString &error);
+    void downloadProgress(DownloadTask *task, qint64 bytesReceived, qint64 bytesTotal);
+};
+
+#endif // DOWNLOADER_H
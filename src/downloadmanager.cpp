@@ -1,6 +1,10 @@
 #include "downloadmanager.h"
+#include "bandwidthlimiter.h"
 #include "downloadtask.h"
 #include "smbdownloader.h"
+#include "directoryjob.h"
+#include "directoryworker.h"
+#include "pathutils.h"
 #include <QStandardPaths>
 #include <QDir>
 #include <QDebug>
@@ -13,13 +17,33 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QDateTime>
+#include <QFileInfo>
+
+namespace {
+// 进度快照的发布间隔，与传输速率和任务数量无关
+const int kProgressIntervalMs = 250;
+}
 
 DownloadManager::DownloadManager(QObject *parent)
+    : DownloadManager(nullptr, parent)
+{
+}
+
+DownloadManager::DownloadManager(Downloader *downloader, QObject *parent)
     : QObject(parent)
-    , m_smbDownloader(new SmbDownloader(this))
-    , m_configPath(QCoreApplication::applicationDirPath() + "/config.json")
+    , m_syncTimer(new QTimer(this))
+    , m_progressTimer(new QTimer(this))
+    , m_downloader(downloader ? downloader : new SmbDownloader(this))
+    , m_configPath(dataDirectory() + "/config.json")
+    , m_store(dataDirectory() + "/tasks.db")
+    , m_concurrency(new ConcurrencyController(this))
+    , m_activeProfile(-1)
+    , m_minPriority(-128)
     , m_activeDownloadCount(0)
     , m_lastUrl("")
+    , m_trustDirectoryMtime(false)
+    , m_prescanDirectories(false)
+    , m_historyCounts{0, 0}
 {
     LOG_INFO("DownloadManager 初始化开始");
     
@@ -35,24 +59,44 @@ DownloadManager::DownloadManager(QObject *parent)
     LOG_INFO(QString("默认保存路径: %1").arg(m_defaultSavePath));
     
     // 连接下载器信号
-    connect(m_smbDownloader, &SmbDownloader::downloadStarted,
+    m_downloader->setParent(this);
+    connect(m_downloader, &Downloader::downloadStarted,
             this, &DownloadManager::onDownloadStarted);
-    connect(m_smbDownloader, &SmbDownloader::downloadPaused,
+    connect(m_downloader, &Downloader::downloadPaused,
             this, &DownloadManager::onDownloadPaused);
-    connect(m_smbDownloader, &SmbDownloader::downloadResumed,
+    connect(m_downloader, &Downloader::downloadResumed,
             this, &DownloadManager::onDownloadResumed);
-    connect(m_smbDownloader, &SmbDownloader::downloadCancelled,
+    connect(m_downloader, &Downloader::downloadCancelled,
             this, &DownloadManager::onDownloadCancelled);
-    connect(m_smbDownloader, &SmbDownloader::downloadCompleted,
+    connect(m_downloader, &Downloader::downloadCompleted,
             this, &DownloadManager::onDownloadCompleted);
-    connect(m_smbDownloader, &SmbDownloader::downloadFailed,
+    connect(m_downloader, &Downloader::downloadFailed,
             this, &DownloadManager::onDownloadFailed);
-    connect(m_smbDownloader, &SmbDownloader::downloadProgress,
+    connect(m_downloader, &Downloader::downloadProgress,
             this, &DownloadManager::onDownloadProgress);
 
+    // 上限提高后立即用上新名额
+    connect(m_concurrency, &ConcurrencyController::limitChanged,
+            this, [this](const QString &server, int limit, const QString &reason) {
+        emit concurrencyChanged(server, limit, reason);
+        startPendingTasks();
+    });
+
     
     // 加载保存的任务
     loadTasks();
+
+    // 每分钟检查一次到期的镜像同步
+    m_syncTimer->setInterval(60 * 1000);
+    connect(m_syncTimer, &QTimer::timeout, this, &DownloadManager::checkSyncSchedule);
+    m_syncTimer->start();
+
+    // 按当前时段设置限速和并发，之后随每分钟的定时检查切换
+    applySchedule(true);
+
+    // 有任务在下载或有进度变化时运行，空闲一个周期后停止
+    m_progressTimer->setInterval(kProgressIntervalMs);
+    connect(m_progressTimer, &QTimer::timeout, this, &DownloadManager::publishProgress);
     
     LOG_INFO("DownloadManager 初始化完成");
 }
@@ -60,13 +104,38 @@ DownloadManager::DownloadManager(QObject *parent)
 DownloadManager::~DownloadManager()
 {
     LOG_INFO("DownloadManager 析构");
-    saveTasks();
-    
-    // 清理任务
-    for (DownloadTask *task : m_tasks) {
-        task->deleteLater();
+
+    // 停止仍在进行的目录扫描
+    for (auto it = m_scanners.constBegin(); it != m_scanners.constEnd(); ++it) {
+        const TaskRecord *record = taskRecord(it.key());
+        if (record && record->directoryJob)
+            record->directoryJob->requestCancelScan();
+    }
+    for (DirectoryWorker *scanner : m_scanners) {
+        scanner->disconnect(this);
+        scanner->wait();
     }
-    m_tasks.clear();
+    m_scanners.clear();
+
+    // 记录未结束任务的最新进度，已结束的任务在状态变化时已写入
+    QList<QJsonObject> unfinished;
+    const QList<TaskHandle> handles = m_records.handles();
+    for (TaskHandle handle : handles) {
+        const TaskRecord &record = m_records.record(handle);
+        if (record.status != DownloadTask::Completed &&
+            record.status != DownloadTask::Failed &&
+            record.status != DownloadTask::Cancelled)
+            unfinished.append(taskToJson(record));
+    }
+    m_store.putTasks(unfinished);
+
+    // 下载器的工作线程仍引用外观对象，先于任务记录销毁
+    delete m_downloader;
+    m_downloader = nullptr;
+    qDeleteAll(m_facades);
+    m_facades.clear();
+    m_records.clear();
+    m_diskSpace.clear();
 }
 
 QString DownloadManager::addTask(const QString &url,
@@ -74,113 +143,312 @@ QString DownloadManager::addTask(const QString &url,
 {
     LOG_INFO(QString("添加下载任务 - URL: %1").arg(url));
     
-    QString taskId = QUuid::createUuid().toString(QUuid::WithoutBraces);
-    
-    DownloadTask *task = new DownloadTask(this);
-    task->setId(taskId);
-    task->setUrl(url);
-    task->setSavePath(savePath.isEmpty() ? m_defaultSavePath : savePath);
-    task->setStatus(DownloadTask::Pending);
-    
-    m_tasks[taskId] = task;
+    QString taskId = insertTask(newRecord(url), url, savePath);
     
     LOG_INFO(QString("任务已添加 - ID: %1").arg(taskId));
     
     emit taskAdded(taskId);
-    saveTasks();
     
     return taskId;
 }
 
-void DownloadManager::removeTask(const QString &taskId)
+QString DownloadManager::addTask(const QString &url,
+                                 const QString &savePath,
+                                 qint64 remoteSize,
+                                 const QDateTime &remoteModified)
 {
-    LOG_INFO(QString("移除下载任务 - ID: %1").arg(taskId));
-    
-    if (!m_tasks.contains(taskId)) {
-        LOG_WARNING(QString("任务不存在 - ID: %1").arg(taskId));
+    LOG_INFO(QString("添加下载任务 - URL: %1, 大小: %2").arg(url).arg(remoteSize));
+
+    TaskRecord record = newRecord(url);
+    record.totalSize = remoteSize;
+    if (remoteModified.isValid())
+        record.remoteModified = remoteModified.toMSecsSinceEpoch();
+    QString taskId = insertTask(record, url, savePath);
+
+    LOG_INFO(QString("任务已添加 - ID: %1").arg(taskId));
+
+    emit taskAdded(taskId);
+
+    return taskId;
+}
+
+QStringList DownloadManager::addTasks(const QStringList &urls,
+                                      const QString &savePath)
+{
+    QList<TaskRequest> requests;
+    requests.reserve(urls.size());
+    for (const QString &url : urls)
+        requests.append({url, savePath, 0});
+    return addTasks(requests);
+}
+
+QStringList DownloadManager::addTasks(const QList<TaskRequest> &requests)
+{
+    LOG_INFO(QString("批量添加下载任务 - 数量: %1").arg(requests.size()));
+
+    QStringList taskIds;
+    QList<QJsonObject> taskObjects;
+    taskIds.reserve(requests.size());
+    taskObjects.reserve(requests.size());
+    for (const TaskRequest &request : requests) {
+        TaskRecord record = newRecord(request.url);
+        record.priority = static_cast<qint8>(qBound(-128, request.priority, 127));
+        TaskHandle handle = m_records.insert(record, request.url,
+                                             request.savePath.isEmpty() ? m_defaultSavePath : request.savePath);
+        taskObjects.append(taskToJson(m_records.record(handle)));
+        taskIds.append(record.id.toString(QUuid::WithoutBraces));
+    }
+    m_store.putTasks(taskObjects);
+
+    LOG_INFO(QString("批量任务已添加 - 数量: %1").arg(taskIds.size()));
+
+    // 大批量时逐个发 taskAdded 会让界面逐个刷新，只发一次汇总信号
+    emit tasksAdded(taskIds.size());
+
+    return taskIds;
+}
+
+QString DownloadManager::addDirectoryTask(const QString &dirUrl,
+                                          const QString &localPath,
+                                          const QString &filterText)
+{
+    LOG_INFO(QString("添加目录下载任务 - URL: %1, 保存到: %2").arg(dirUrl).arg(localPath));
+
+    QString url = dirUrl;
+    while (url.endsWith('/') || url.endsWith('\\'))
+        url.chop(1);
+
+    QSharedPointer<DirectoryJob> job(new DirectoryJob);
+    job->setFilterText(filterText);
+    job->setPrescan(m_prescanDirectories);
+
+    TaskRecord record = newRecord(url);
+    record.directoryJob = job;
+    QString taskId = insertTask(record, url, localPath);
+
+    LOG_INFO(QString("目录任务已添加 - ID: %1").arg(taskId));
+
+    emit taskAdded(taskId);
+
+    return taskId;
+}
+
+QString DownloadManager::addSyncJob(const QString &url,
+                                    const QString &localPath,
+                                    const QString &filterText,
+                                    bool deleteRemoved,
+                                    int intervalMinutes)
+{
+    // 同一远程目录同步到同一本地目录视为同一个同步配置，更新其设置
+    QString syncId;
+    for (const SyncJob &job : m_syncJobs) {
+        if (job.url == url && QDir::cleanPath(job.localPath) == QDir::cleanPath(localPath)) {
+            syncId = job.id;
+            break;
+        }
+    }
+    if (syncId.isEmpty())
+        syncId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+
+    SyncJob &job = m_syncJobs[syncId];
+    job.id = syncId;
+    job.url = url;
+    job.localPath = localPath;
+    job.filterText = filterText;
+    job.deleteRemoved = deleteRemoved;
+    job.intervalMinutes = qMax(0, intervalMinutes);
+
+    LOG_INFO(QString("镜像同步已配置 - ID: %1, %2 -> %3, 间隔: %4 分钟")
+             .arg(syncId).arg(url).arg(localPath).arg(job.intervalMinutes));
+    persistSettings();
+    return syncId;
+}
+
+void DownloadManager::removeSyncJob(const QString &syncId)
+{
+    if (m_syncJobs.remove(syncId) > 0) {
+        LOG_INFO(QString("镜像同步已移除 - ID: %1").arg(syncId));
+        persistSettings();
+    }
+}
+
+void DownloadManager::runSyncJob(const QString &syncId)
+{
+    if (!m_syncJobs.contains(syncId)) {
+        LOG_WARNING(QString("同步配置不存在 - ID: %1").arg(syncId));
         return;
     }
-    
-    DownloadTask *task = m_tasks[taskId];
-    if (task->status() == DownloadTask::Downloading) {
-        m_activeDownloadCount--;
+
+    SyncJob &job = m_syncJobs[syncId];
+    const TaskRecord *running = taskRecord(job.runningTaskId);
+    if (running && (running->status == DownloadTask::Pending ||
+                    running->status == DownloadTask::Queued ||
+                    running->status == DownloadTask::Downloading ||
+                    running->status == DownloadTask::Paused)) {
+        LOG_INFO(QString("镜像同步正在进行 - ID: %1").arg(syncId));
+        return;
     }
-    
-    // 取消下载
-    if (task->status() == DownloadTask::Completed ||
-        task->status() == DownloadTask::Failed ||
-        task->status() == DownloadTask::Cancelled) {
-        // 已完成的任务直接删除
-        m_tasks.remove(taskId);
-        task->deleteLater();
-    } else {
-        // 正在进行的任务先取消再删除
+
+    // 上一次同步的任务和展开的失败文件只保留摘要，不在历史中累积
+    if (!job.runningTaskId.isEmpty())
+        removeTask(job.runningTaskId);
+    const QStringList &failureIds = job.failureTaskIds;
+    for (const QString &failureId : failureIds) {
+        int status = m_store.removeTask(failureId);
+        if (status < 0)
+            continue;   // 已在历史中被清除
+        --m_historyCounts[historyKindOf(status)];
+        emit taskRemoved(failureId);
+    }
+    job.failureTaskIds.clear();
+
+    LOG_INFO(QString("开始镜像同步 - ID: %1").arg(syncId));
+    QString taskId = addDirectoryTask(job.url, job.localPath, job.filterText);
+    QSharedPointer<DirectoryJob> dirJob = taskRecord(taskId)->directoryJob;
+    dirJob->setSyncId(syncId);
+    dirJob->setDeleteRemoved(job.deleteRemoved);
+
+    m_syncJobs[syncId].runningTaskId = taskId;
+    m_syncJobs[syncId].lastRun = QDateTime::currentDateTime();
+    startTask(taskId);
+    if (DownloadTask *task = getTask(taskId))
+        persistTask(task);
+    persistSettings();
+}
+
+void DownloadManager::runAllSyncJobs()
+{
+    const QStringList ids = m_syncJobs.keys();
+    for (const QString &syncId : ids)
+        runSyncJob(syncId);
+}
+
+QList<DownloadManager::SyncJob> DownloadManager::syncJobs() const
+{
+    return m_syncJobs.values();
+}
+
+void DownloadManager::checkSyncSchedule()
+{
+    // 进入新时段后按新的限制补足名额
+    if (applySchedule())
+        startPendingTasks();
+
+    // 其他程序释放的磁盘空间没有通知，顺便重新检查因空间不足而排队的任务
+    admitQueuedTasks();
+
+    QDateTime now = QDateTime::currentDateTime();
+    const QStringList ids = m_syncJobs.keys();
+    for (const QString &syncId : ids) {
+        const SyncJob &job = m_syncJobs[syncId];
+        if (job.intervalMinutes <= 0)
+            continue;
+        if (!job.lastRun.isValid() || job.lastRun.addSecs(job.intervalMinutes * 60) <= now)
+            runSyncJob(syncId);
+    }
+}
+
+void DownloadManager::finishSyncRun(DownloadTask *task)
+{
+    QSharedPointer<DirectoryJob> dirJob = task->directoryJob();
+    QString syncId = dirJob->syncId();
+    if (syncId.isEmpty() || !m_syncJobs.contains(syncId))
+        return;
+
+    QString summary = tr("下载 %1 个，未变化跳过 %2 个，删除 %3 个，失败 %4 个")
+                          .arg(dirJob->completedCount())
+                          .arg(dirJob->skippedCount())
+                          .arg(dirJob->deletedCount())
+                          .arg(dirJob->failedCount());
+    if (task->status() == DownloadTask::Cancelled)
+        summary = tr("已取消：") + summary;
+
+    SyncJob &job = m_syncJobs[syncId];
+    job.lastSummary = summary;
+    persistSettings();
+
+    LOG_INFO(QString("镜像同步结束 - ID: %1, %2").arg(syncId).arg(summary));
+    emit syncFinished(syncId, summary);
+}
+
+void DownloadManager::removeTask(const QString &taskId)
+{
+    LOG_INFO(QString("移除下载任务 - ID: %1").arg(taskId));
+
+    // 正在进行的任务先取消，取消后转入历史记录，再从历史中删除
+    if (m_records.find(taskId) != InvalidTaskHandle)
         cancelTask(taskId);
-        m_tasks.remove(taskId);
-        task->deleteLater();
+
+    int status = m_store.removeTask(taskId);
+    if (status < 0) {
+        LOG_WARNING(QString("任务不存在 - ID: %1").arg(taskId));
+        return;
     }
-    
+    --m_historyCounts[historyKindOf(status)];
+
     LOG_INFO(QString("任务已移除 - ID: %1").arg(taskId));
     emit taskRemoved(taskId);
-    saveTasks();
 }
 
 void DownloadManager::removeCompletedTasks()
 {
     LOG_INFO("移除已完成的任务");
-    
-    QList<DownloadTask*> completedTasks;
-    for (DownloadTask *task : m_tasks) {
-        if (task->status() == DownloadTask::Completed ||
-            task->status() == DownloadTask::Failed ||
-            task->status() == DownloadTask::Cancelled) {
-            completedTasks.append(task);
-        }
-    }
-    
-    for (DownloadTask *task : completedTasks) {
-        m_tasks.remove(task->id());
-        task->deleteLater();
-        LOG_INFO(QString("任务已移除 - ID: %1").arg(task->id()));
-        emit taskRemoved(task->id());
-    }
-    saveTasks();
+    clearHistory(CompletedHistory);
+    clearHistory(FailedHistory);
 }
 
 void DownloadManager::startTask(const QString &taskId)
 {
     LOG_INFO(QString("开始下载任务 - ID: %1").arg(taskId));
     
-    if (!m_tasks.contains(taskId)) {
+    DownloadTask *task = getTask(taskId);
+    if (!task) {
         LOG_WARNING(QString("任务不存在 - ID: %1").arg(taskId));
         return;
     }
     
-    DownloadTask *task = m_tasks[taskId];
     if (task->status() == DownloadTask::Downloading) {
         LOG_WARNING(QString("任务已在下载中 - ID: %1").arg(taskId));
         return;
     }
+
+    // 该服务器的名额已满或当前时段不允许该优先级时留在等待中，之后按优先级开始
+    QString server = ConcurrencyController::serverOf(task->url());
+    if (!m_concurrency->hasSlot(server) || m_records.record(task->handle()).priority < m_minPriority) {
+        LOG_DEBUG(QString("并发名额已满或当前时段不允许，任务等待 - ID: %1").arg(taskId));
+        if (task->status() == DownloadTask::Paused)
+            task->setStatus(DownloadTask::Pending);
+        return;
+    }
+
+    if (!admitTask(task))
+        return;
     
     m_activeDownloadCount++;
     task->setStatus(DownloadTask::Downloading);
+    m_concurrency->acquire(task->handle(), server, task->downloadedSize());
     
     LOG_INFO(QString("任务开始下载 - ID: %1, 当前活跃下载数: %2").arg(taskId).arg(m_activeDownloadCount));
+
+    // 目录任务边扫描边下载
+    if (task->isDirectory())
+        startDirectoryScan(task);
     
-    // 根据协议类型选择下载器
-    m_smbDownloader->startDownload(task);
+    // 根据协议类型选择下载器；下载器按外观对象保存工作线程，结束前不能释放该对象
+    if (m_downloader->startDownload(task))
+        m_transferring.insert(task->handle());
 }
 
 void DownloadManager::pauseTask(const QString &taskId)
 {
     LOG_INFO(QString("暂停下载任务 - ID: %1").arg(taskId));
     
-    if (!m_tasks.contains(taskId)) {
+    DownloadTask *task = getTask(taskId);
+    if (!task) {
         LOG_WARNING(QString("任务不存在 - ID: %1").arg(taskId));
         return;
     }
     
-    DownloadTask *task = m_tasks[taskId];
     if (task->status() != DownloadTask::Downloading) {
         LOG_WARNING(QString("任务不在下载状态 - ID: %1").arg(taskId));
         return;
@@ -188,61 +456,82 @@ void DownloadManager::pauseTask(const QString &taskId)
     
     task->setStatus(DownloadTask::Paused);
     m_activeDownloadCount--;
+    m_diskSpace.release(task->handle());
+    m_concurrency->release(task->handle());
     
     LOG_INFO(QString("任务已暂停 - ID: %1, 当前活跃下载数: %2").arg(taskId).arg(m_activeDownloadCount));
     
-    m_smbDownloader->pauseDownload(task);
+    m_downloader->pauseDownload(task);
 
     processNextTask();
-    saveTasks();
+    persistTask(task);
 }
 
 void DownloadManager::resumeTask(const QString &taskId)
 {
     LOG_INFO(QString("恢复下载任务 - ID: %1").arg(taskId));
     
-    if (!m_tasks.contains(taskId)) {
+    DownloadTask *task = getTask(taskId);
+    if (!task) {
         LOG_WARNING(QString("任务不存在 - ID: %1").arg(taskId));
         return;
     }
     
-    DownloadTask *task = m_tasks[taskId];
     if (task->status() != DownloadTask::Paused) {
         LOG_WARNING(QString("任务不在暂停状态 - ID: %1").arg(taskId));
         return;
     }
+
+    QString server = ConcurrencyController::serverOf(task->url());
+    if (!m_concurrency->hasSlot(server)) {
+        LOG_INFO(QString("并发名额已满，任务转为等待 - ID: %1").arg(taskId));
+        task->setStatus(DownloadTask::Pending);
+        persistTask(task);
+        return;
+    }
+    if (!admitTask(task)) {
+        persistTask(task);
+        return;
+    }
+    m_concurrency->acquire(task->handle(), server, task->downloadedSize());
     
     m_activeDownloadCount++;
 
     LOG_INFO(QString("任务恢复下载 - ID: %1, 当前活跃下载数: %2").arg(taskId).arg(m_activeDownloadCount));
 
     // 调用下载器恢复任务，状态将在下载器中更新
-    m_smbDownloader->resumeDownload(task);
-    saveTasks();
+    m_downloader->resumeDownload(task);
+    persistTask(task);
 }
 
 void DownloadManager::cancelTask(const QString &taskId)
 {
     LOG_INFO(QString("取消下载任务 - ID: %1").arg(taskId));
     
-    if (!m_tasks.contains(taskId)) {
+    DownloadTask *task = getTask(taskId);
+    if (!task) {
         LOG_WARNING(QString("任务不存在 - ID: %1").arg(taskId));
         return;
     }
     
-    DownloadTask *task = m_tasks[taskId];
     if (task->status() == DownloadTask::Downloading) {
         m_activeDownloadCount--;
     }
 
+    stopDirectoryScan(task);
     task->setStatus(DownloadTask::Cancelled);
     task->setErrorMessage(tr("用户取消"));
     
     LOG_INFO(QString("任务已取消 - ID: %1, 当前活跃下载数: %2").arg(taskId).arg(m_activeDownloadCount));
 
-    m_smbDownloader->cancelDownload(task);
+    m_downloader->cancelDownload(task);
 
-    saveTasks();
+    // 下载器未接手的任务（等待中、暂停）不会发出取消信号，在这里转入历史
+    if (m_records.contains(task->handle())) {
+        persistTask(task);
+        emit taskCancelled(taskId);
+        retireTask(task->handle());
+    }
 
     processNextTask();
 }
@@ -251,22 +540,21 @@ void DownloadManager::startAllTasks()
 {
     LOG_INFO("开始所有任务");
     
-    for (DownloadTask *task : m_tasks) {
-        if (task->status() == DownloadTask::Pending ||
-            task->status() == DownloadTask::Paused) {
-            startTask(task->id());
-        }
-    }
+    // 暂停的任务转回等待，与等待中的任务一起按优先级在各服务器的名额内开始
+    const QList<TaskHandle> paused = m_records.withStatus(DownloadTask::Paused).values();
+    for (TaskHandle handle : paused)
+        facade(handle)->setStatus(DownloadTask::Pending);
+    startPendingTasks();
 }
 
 void DownloadManager::pauseAllTasks()
 {
     LOG_INFO("暂停所有任务");
     
-    for (DownloadTask *task : m_tasks) {
-        if (task->status() == DownloadTask::Downloading) {
-            pauseTask(task->id());
-        }
+    const QList<TaskHandle> handles = m_records.withStatus(DownloadTask::Downloading).values();
+    for (TaskHandle handle : handles) {
+        if (m_records.contains(handle))
+            pauseTask(m_records.record(handle).id.toString(QUuid::WithoutBraces));
     }
 }
 
@@ -274,56 +562,148 @@ void DownloadManager::cancelAllTasks()
 {
     LOG_INFO("取消所有任务");
     
-    for (DownloadTask *task : m_tasks) {
-        if (task->status() == DownloadTask::Downloading ||
-            task->status() == DownloadTask::Paused) {
-            cancelTask(task->id());
-        }
+    const QList<TaskHandle> handles = m_records.withStatus(DownloadTask::Downloading).values()
+                                      + m_records.withStatus(DownloadTask::Paused).values();
+    for (TaskHandle handle : handles) {
+        if (m_records.contains(handle))
+            cancelTask(m_records.record(handle).id.toString(QUuid::WithoutBraces));
     }
 }
 
-QList<DownloadTask*> DownloadManager::getAllTasks() const
+QList<DownloadTask*> DownloadManager::getAllTasks()
 {
-    return m_tasks.values();
+    QList<DownloadTask*> tasks;
+    const QList<TaskHandle> handles = m_records.handles();
+    tasks.reserve(handles.size());
+    for (TaskHandle handle : handles)
+        tasks.append(facade(handle));
+    return tasks;
 }
 
-QList<DownloadTask*> DownloadManager::getActiveTasks() const
+QList<DownloadTask*> DownloadManager::getActiveTasks()
 {
-    QList<DownloadTask*> activeTasks;
-    for (DownloadTask *task : m_tasks) {
-        if (task->status() == DownloadTask::Downloading ||
-            task->status() == DownloadTask::Paused) {
-            activeTasks.append(task);
+    QList<DownloadTask*> tasks;
+    for (TaskHandle handle : m_records.withStatus(DownloadTask::Downloading))
+        tasks.append(facade(handle));
+    for (TaskHandle handle : m_records.withStatus(DownloadTask::Paused))
+        tasks.append(facade(handle));
+    return tasks;
+}
+
+QList<DownloadTask*> DownloadManager::getVisibleTasks(int pendingLimit)
+{
+    QList<DownloadTask*> tasks = getActiveTasks();
+
+    QSet<TaskHandle> visible;
+    const DownloadTask::Status waiting[] = {DownloadTask::Pending, DownloadTask::Queued};
+    for (DownloadTask::Status status : waiting) {
+        for (TaskHandle handle : m_records.withStatus(status)) {
+            if (visible.size() >= pendingLimit)
+                break;
+            visible.insert(handle);
+            tasks.append(facade(handle));
         }
     }
-    return activeTasks;
+
+    // 不再显示的等待任务只保留记录，下次启动或显示时再创建外观对象。
+    // 暂停后转回等待的任务，下载器仍持有外观对象和暂停的工作线程，保留不释放
+    const QList<TaskHandle> idle = m_facades.keys();
+    for (TaskHandle handle : idle) {
+        quint8 status = m_records.record(handle).status;
+        if ((status == DownloadTask::Pending || status == DownloadTask::Queued) &&
+            !visible.contains(handle) && !m_transferring.contains(handle))
+            releaseFacade(handle);
+    }
+    return tasks;
 }
 
-QList<DownloadTask*> DownloadManager::getCompletedTasks() const
+QList<DownloadManager::TaskProgress> DownloadManager::activeTransfers() const
 {
-    QList<DownloadTask*> completedTasks;
-    for (DownloadTask *task : m_tasks) {
-        if (task->status() == DownloadTask::Completed) {
-            completedTasks.append(task);
-        }
+    QList<TaskProgress> transfers;
+    for (TaskHandle handle : m_records.withStatus(DownloadTask::Downloading)) {
+        const TaskRecord &record = m_records.record(handle);
+        DownloadTask *task = m_facades.value(handle);
+        TaskProgress progress;
+        progress.taskId = record.id.toString(QUuid::WithoutBraces);
+        progress.bytesReceived = record.downloadedSize;
+        progress.bytesTotal = record.totalSize;
+        progress.speed = task ? task->speed() : 0;
+        transfers.append(progress);
     }
-    return completedTasks;
+    return transfers;
 }
 
-QList<DownloadTask*> DownloadManager::getFailedTasks() const
+const TaskRecord *DownloadManager::taskRecord(const QString &taskId) const
 {
-    QList<DownloadTask*> failedTasks;
-    for (DownloadTask *task : m_tasks) {
-        if (task->status() == DownloadTask::Failed || task->status() == DownloadTask::Cancelled) {
-            failedTasks.append(task);
-        }
+    TaskHandle handle = m_records.find(taskId);
+    return handle == InvalidTaskHandle ? nullptr : &m_records.record(handle);
+}
+
+QStringList DownloadManager::taskUrls() const
+{
+    QStringList urls;
+    const QList<TaskHandle> handles = m_records.handles();
+    urls.reserve(handles.size());
+    for (TaskHandle handle : handles)
+        urls.append(m_records.url(m_records.record(handle)));
+    return urls;
+}
+
+int DownloadManager::taskCount() const
+{
+    return m_records.count();
+}
+
+int DownloadManager::taskCount(DownloadTask::Status status) const
+{
+    return m_records.count(status);
+}
+
+const QSet<TaskHandle> &DownloadManager::tasksWithStatus(DownloadTask::Status status) const
+{
+    return m_records.withStatus(status);
+}
+
+QList<DownloadManager::HistoryRecord> DownloadManager::queryHistory(HistoryKind kind,
+                                                                   const QString &filter,
+                                                                   int offset, int limit) const
+{
+    QList<HistoryRecord> records;
+    const QList<QJsonObject> tasks = m_store.finishedTasks(historyStatuses(kind), filter, offset, limit);
+    records.reserve(tasks.size());
+    for (const QJsonObject &taskObject : tasks) {
+        HistoryRecord record;
+        record.id = taskObject["id"].toString();
+        record.url = taskObject["url"].toString();
+        record.fileName = taskObject["fileName"].toString();
+        record.savePath = taskObject["savePath"].toString();
+        record.status = static_cast<DownloadTask::Status>(taskObject["status"].toInt());
+        record.size = taskObject["downloadedSize"].toVariant().toLongLong();
+        record.endTime = QDateTime::fromString(taskObject["endTime"].toString(), Qt::ISODate);
+        record.errorMessage = taskObject["errorMessage"].toString();
+        records.append(record);
     }
-    return failedTasks;
+    return records;
+}
+
+int DownloadManager::historyCount(HistoryKind kind, const QString &filter) const
+{
+    if (filter.trimmed().isEmpty())
+        return m_historyCounts[kind];
+    return m_store.finishedCount(historyStatuses(kind), filter);
+}
+
+void DownloadManager::clearHistory(HistoryKind kind)
+{
+    int removed = m_store.removeTasks(historyStatuses(kind));
+    m_historyCounts[kind] = 0;
+    LOG_INFO(QString("已删除 %1 条历史记录").arg(removed));
 }
 
-DownloadTask* DownloadManager::getTask(const QString &taskId) const
+DownloadTask* DownloadManager::getTask(const QString &taskId)
 {
-    return m_tasks.value(taskId, nullptr);
+    TaskHandle handle = m_records.find(taskId);
+    return handle == InvalidTaskHandle ? nullptr : facade(handle);
 }
 
 QString DownloadManager::getDefaultSavePath() const
@@ -334,7 +714,7 @@ QString DownloadManager::getDefaultSavePath() const
 void DownloadManager::setDefaultSavePath(const QString &path)
 {
     m_defaultSavePath = path;
-    saveTasks();
+    persistSettings();
 }
 
 QString DownloadManager::getLastUrl() const
@@ -345,114 +725,362 @@ QString DownloadManager::getLastUrl() const
 void DownloadManager::setLastUrl(const QString &url)
 {
     m_lastUrl = url;
-    saveTasks();
+    persistSettings();
+}
+
+bool DownloadManager::trustDirectoryMtime() const
+{
+    return m_trustDirectoryMtime;
+}
+
+void DownloadManager::setTrustDirectoryMtime(bool trust)
+{
+    m_trustDirectoryMtime = trust;
+    persistSettings();
+}
+
+bool DownloadManager::prescanDirectories() const
+{
+    return m_prescanDirectories;
+}
+
+void DownloadManager::setPrescanDirectories(bool prescan)
+{
+    m_prescanDirectories = prescan;
+    persistSettings();
+}
+
+int DownloadManager::minConcurrency() const
+{
+    return m_concurrency->minLimit();
+}
+
+int DownloadManager::maxConcurrency() const
+{
+    return m_concurrency->maxLimit();
+}
+
+void DownloadManager::setConcurrencyLimits(int minLimit, int maxLimit)
+{
+    m_concurrency->setLimits(minLimit, maxLimit);
+    persistSettings();
+    startPendingTasks();
+}
+
+QList<ConcurrencyController::ServerState> DownloadManager::concurrencyState() const
+{
+    return m_concurrency->servers();
+}
+
+QList<ScheduleProfile> DownloadManager::scheduleProfiles() const
+{
+    return m_profiles;
+}
+
+void DownloadManager::setScheduleProfiles(const QList<ScheduleProfile> &profiles)
+{
+    m_profiles = profiles;
+    persistSettings();
+    applySchedule(true);
+    startPendingTasks();
+}
+
+QString DownloadManager::activeProfileName() const
+{
+    return m_activeProfile >= 0 ? m_profiles.at(m_activeProfile).name : QString();
+}
+
+bool DownloadManager::applySchedule(bool force)
+{
+    int index = ScheduleProfile::activeIndex(m_profiles, QDateTime::currentDateTime());
+    if (index == m_activeProfile && !force)
+        return false;
+    m_activeProfile = index;
+
+    // 只改变限制，不打断传输：限速立即作用于正在读取的数据，
+    // 降低并发或提高优先级门槛只影响之后开始的任务
+    ScheduleProfile profile = index >= 0 ? m_profiles.at(index) : ScheduleProfile();
+    setBandwidthLimit(profile.bandwidth);
+    m_concurrency->setTotalLimit(profile.concurrency);
+    m_minPriority = profile.minPriority;
+
+    if (index >= 0) {
+        LOG_INFO(QString("进入时段 %1 - 限速: %2 字节/秒, 并发: %3, 最低优先级: %4")
+                 .arg(profile.name).arg(profile.bandwidth).arg(profile.concurrency).arg(profile.minPriority));
+    } else if (!m_profiles.isEmpty()) {
+        LOG_INFO("不在任何时段内，取消限速和并发限制");
+    }
+    emit scheduleProfileChanged(activeProfileName());
+    return true;
 }
 
 void DownloadManager::saveTasks()
 {
     LOG_INFO("保存任务列表");
-    
-    QJsonObject json;
-    QJsonArray tasksArray;
-    
-    for (DownloadTask *task : m_tasks) {
-        QJsonObject taskObject;
-        taskObject["id"] = task->id();
-        taskObject["url"] = task->url();
-        taskObject["savePath"] = task->savePath();
-        taskObject["fileName"] = task->fileName();
-        taskObject["status"] = static_cast<int>(task->status());
-        taskObject["downloadedSize"] = task->downloadedSize();
-        taskObject["totalSize"] = task->totalSize();
-        taskObject["supportsResume"] = task->supportsResume();
-        taskObject["errorMessage"] = task->errorMessage();
-        taskObject["endTime"] = task->endTime().toString(Qt::ISODate);
-        tasksArray.append(taskObject);
-    }
-    
-    json["tasks"] = tasksArray;
-    json["defaultSavePath"] = m_defaultSavePath;
-    json["lastUrl"] = m_lastUrl;
-    
-    QFile file(m_configPath);
-    if (file.open(QIODevice::WriteOnly)) {
-        QTextStream stream(&file);
-        stream << QJsonDocument(json).toJson();
-        file.close();
-    }
-    
-    LOG_INFO(QString("已保存 %1 个任务").arg(m_tasks.size()));
+
+    QList<QJsonObject> tasks;
+    const QList<TaskHandle> handles = m_records.handles();
+    tasks.reserve(handles.size());
+    for (TaskHandle handle : handles)
+        tasks.append(taskToJson(m_records.record(handle)));
+    m_store.putTasks(tasks);
+    m_store.putSettings(settingsToJson());
+
+    LOG_INFO(QString("已保存 %1 个任务").arg(tasks.size()));
 }
 
 void DownloadManager::loadTasks()
 {
     LOG_INFO("加载任务列表");
 
-    // 清空旧任务对象，防止重复加载
-    for (auto task : m_tasks) {
-        task->deleteLater();
-    }
-    m_tasks.clear();
+    // 清空旧任务，防止重复加载
+    const QList<TaskHandle> facades = m_facades.keys();
+    for (TaskHandle handle : facades)
+        releaseFacade(handle);
+    m_transferring.clear();
+    m_records.clear();
+    m_diskSpace.clear();
+
+    // 首次启动时把旧版 config.json 导入数据库
+    if (!m_store.open())
+        return;
+    m_store.importLegacy(m_configPath);
 
-    QFile file(m_configPath);
-    if (file.open(QIODevice::ReadOnly)) {
-        QTextStream stream(&file);
-        QString jsonString = stream.readAll();
-        file.close();
-        QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonString.toUtf8());
-        QJsonObject json = jsonDoc.object();
-        QJsonArray tasksArray = json["tasks"].toArray();
+    QJsonObject json = m_store.settings();
+    if (json.contains("defaultSavePath"))
         m_defaultSavePath = json["defaultSavePath"].toString();
-        m_lastUrl = json["lastUrl"].toString();
-        for (const QJsonValue &value : tasksArray) {
-            QJsonObject taskObject = value.toObject();
-            QString id = taskObject["id"].toString();
-            QString url = taskObject["url"].toString();
-            QString savePath = taskObject["savePath"].toString();
-            QString fileName = taskObject["fileName"].toString();
-            DownloadTask::Status status = static_cast<DownloadTask::Status>(taskObject["status"].toInt());
-            qint64 downloadedSize = taskObject["downloadedSize"].toVariant().toLongLong();
-            qint64 totalSize = taskObject["totalSize"].toVariant().toLongLong();
-            bool supportsResume = taskObject["supportsResume"].toBool();
-            QString errorMessage = taskObject["errorMessage"].toString();
-            QDateTime endTime = QDateTime::fromString(taskObject["endTime"].toString(), Qt::ISODate);
-            // 创建任务对象
-            DownloadTask *task = new DownloadTask(this);
-            task->setId(id);
-            task->setUrl(url);
-            task->setSavePath(savePath);
-            task->setFileName(fileName);
-            // 状态修正：如果是 Downloading 或 Queued，重启后恢复为 Pending
-            if (status == DownloadTask::Downloading || status == DownloadTask::Queued) {
-                status = DownloadTask::Pending;
-            }
-            task->setStatus(status);
-            task->setDownloadedSize(downloadedSize);
-            task->setTotalSize(totalSize);
-            task->setSupportsResume(supportsResume);
-            if (endTime.isValid())
-                task->setEndTime(endTime);
-            if (!errorMessage.isEmpty())
-                task->setErrorMessage(errorMessage);
-            m_tasks[id] = task;
-            LOG_INFO(QString("加载任务 - ID: %1, URL: %2").arg(id).arg(url));
+    m_lastUrl = json["lastUrl"].toString();
+    m_trustDirectoryMtime = json["trustDirectoryMtime"].toBool();
+    m_prescanDirectories = json["prescanDirectories"].toBool();
+    m_concurrency->setLimits(json["minConcurrency"].toInt(1), json["maxConcurrency"].toInt(8));
+    m_profiles.clear();
+    const QJsonArray profileArray = json["scheduleProfiles"].toArray();
+    for (const QJsonValue &value : profileArray)
+        m_profiles.append(ScheduleProfile::fromJson(value.toObject()));
+    m_syncJobs.clear();
+    const QJsonArray syncArray = json["syncJobs"].toArray();
+    for (const QJsonValue &value : syncArray) {
+        QJsonObject syncObject = value.toObject();
+        SyncJob job;
+        job.id = syncObject["id"].toString();
+        job.url = syncObject["url"].toString();
+        job.localPath = syncObject["localPath"].toString();
+        job.filterText = syncObject["filter"].toString();
+        job.deleteRemoved = syncObject["deleteRemoved"].toBool();
+        job.intervalMinutes = syncObject["intervalMinutes"].toInt();
+        job.lastRun = QDateTime::fromString(syncObject["lastRun"].toString(), Qt::ISODate);
+        job.lastSummary = syncObject["lastSummary"].toString();
+        job.runningTaskId = syncObject["runningTaskId"].toString();
+        const QJsonArray failureIds = syncObject["failureTaskIds"].toArray();
+        for (const QJsonValue &failureId : failureIds)
+            job.failureTaskIds.append(failureId.toString());
+        m_syncJobs[job.id] = job;
+    }
+
+    // 只加载未结束的任务，历史记录按需从数据库分页查询
+    const QList<QJsonObject> taskObjects = m_store.activeTasks();
+    for (const QJsonObject &taskObject : taskObjects) {
+        TaskRecord record = recordFromJson(taskObject);
+        bool reassigned = record.id.isNull() || m_records.find(record.id) != InvalidTaskHandle;
+        if (reassigned) {
+            // 任务 ID 即记录的键，无法解析或重复的旧 ID 换成新的
+            QString oldId = taskObject["id"].toString();
+            record.id = QUuid::createUuid();
+            LOG_WARNING(QString("任务 ID 无效，已重新分配 - 原 ID: %1").arg(oldId));
+            m_store.removeTask(oldId);
+            if (record.directoryJob)
+                record.directoryJob->markAllChanged();
         }
-        LOG_INFO(QString("已加载 %1 个任务").arg(m_tasks.size()));
+        TaskHandle handle = m_records.insert(record, taskObject["url"].toString(),
+                                             taskObject["savePath"].toString());
+        if (reassigned)
+            m_store.putTask(taskToJson(m_records.record(handle)));
     }
+    m_historyCounts[CompletedHistory] = m_store.finishedCount(historyStatuses(CompletedHistory));
+    m_historyCounts[FailedHistory] = m_store.finishedCount(historyStatuses(FailedHistory));
+    LOG_INFO(QString("已加载 %1 个未完成任务，历史记录 %2 条完成、%3 条失败")
+             .arg(m_records.count())
+             .arg(m_historyCounts[CompletedHistory])
+             .arg(m_historyCounts[FailedHistory]));
 }
 
-void DownloadManager::onTaskStatusChanged(DownloadTask::Status status)
+QJsonObject DownloadManager::taskToJson(const TaskRecord &record) const
 {
-    updateActiveDownloadCount();
-    
-    // 如果任务完成，尝试开始下一个任务
-    if (status == DownloadTask::Completed || 
-        status == DownloadTask::Failed || 
-        status == DownloadTask::Cancelled) {
-        processNextTask();
+    return taskToJson(record, m_records.url(record), m_records.savePath(record));
+}
+
+QJsonObject DownloadManager::taskToJson(const TaskRecord &record, const QString &url,
+                                        const QString &savePath) const
+{
+    QJsonObject taskObject;
+    taskObject["id"] = record.id.toString(QUuid::WithoutBraces);
+    taskObject["url"] = url;
+    taskObject["savePath"] = savePath;
+    taskObject["fileName"] = record.fileName;
+    taskObject["status"] = static_cast<int>(record.status);
+    taskObject["downloadedSize"] = record.downloadedSize;
+    taskObject["totalSize"] = record.totalSize;
+    taskObject["supportsResume"] = record.supportsResume;
+    taskObject["errorMessage"] = record.errorMessage;
+    if (record.priority)
+        taskObject["priority"] = record.priority;
+    taskObject["endTime"] = record.endTime ? QDateTime::fromMSecsSinceEpoch(record.endTime).toString(Qt::ISODate)
+                                           : QString();
+    if (record.remoteModified)
+        taskObject["remoteModified"] = QDateTime::fromMSecsSinceEpoch(record.remoteModified).toString(Qt::ISODate);
+    if (record.directoryJob) {
+        // 子条目只附带上次保存以来的变化，由 TaskStore 写入条目表
+        taskObject["kind"] = "directory";
+        taskObject["job"] = record.directoryJob->toJson();
+        taskObject["entryChanges"] = record.directoryJob->takeChangedEntries();
+    }
+    return taskObject;
+}
+
+TaskRecord DownloadManager::recordFromJson(const QJsonObject &taskObject)
+{
+    DownloadTask::Status status = static_cast<DownloadTask::Status>(taskObject["status"].toInt());
+    QDateTime endTime = QDateTime::fromString(taskObject["endTime"].toString(), Qt::ISODate);
+    QDateTime remoteModified = QDateTime::fromString(taskObject["remoteModified"].toString(), Qt::ISODate);
+
+    TaskRecord record;
+    record.id = QUuid::fromString(taskObject["id"].toString());
+    // 地址和保存路径在插入工作集时才登记到路径字典
+    QString fileName = taskObject["fileName"].toString();
+    record.fileName = fileName.isEmpty() ? DownloadTask::fileNameFromUrl(taskObject["url"].toString()) : fileName;
+    // 状态修正：如果是 Downloading 或 Queued，重启后恢复为 Pending
+    if (status == DownloadTask::Downloading || status == DownloadTask::Queued) {
+        status = DownloadTask::Pending;
+    }
+    record.status = static_cast<quint8>(status);
+    record.priority = static_cast<qint8>(qBound(-128, taskObject["priority"].toInt(), 127));
+    record.downloadedSize = taskObject["downloadedSize"].toVariant().toLongLong();
+    record.totalSize = taskObject["totalSize"].toVariant().toLongLong();
+    record.supportsResume = taskObject["supportsResume"].toBool();
+    if (endTime.isValid())
+        record.endTime = endTime.toMSecsSinceEpoch();
+    if (remoteModified.isValid())
+        record.remoteModified = remoteModified.toMSecsSinceEpoch();
+    if (taskObject["kind"].toString() == "directory")
+        record.directoryJob = DirectoryJob::fromJson(taskObject["job"].toObject());
+    record.errorMessage = taskObject["errorMessage"].toString();
+    return record;
+}
+
+QJsonObject DownloadManager::settingsToJson() const
+{
+    QJsonArray syncArray;
+    for (const SyncJob &job : m_syncJobs) {
+        QJsonObject syncObject;
+        syncObject["id"] = job.id;
+        syncObject["url"] = job.url;
+        syncObject["localPath"] = job.localPath;
+        syncObject["filter"] = job.filterText;
+        syncObject["deleteRemoved"] = job.deleteRemoved;
+        syncObject["intervalMinutes"] = job.intervalMinutes;
+        syncObject["lastRun"] = job.lastRun.toString(Qt::ISODate);
+        syncObject["lastSummary"] = job.lastSummary;
+        syncObject["runningTaskId"] = job.runningTaskId;
+        syncObject["failureTaskIds"] = QJsonArray::fromStringList(job.failureTaskIds);
+        syncArray.append(syncObject);
+    }
+
+    QJsonObject json;
+    json["syncJobs"] = syncArray;
+    json["defaultSavePath"] = m_defaultSavePath;
+    json["lastUrl"] = m_lastUrl;
+    json["trustDirectoryMtime"] = m_trustDirectoryMtime;
+    json["prescanDirectories"] = m_prescanDirectories;
+    json["minConcurrency"] = m_concurrency->minLimit();
+    json["maxConcurrency"] = m_concurrency->maxLimit();
+    QJsonArray profileArray;
+    for (const ScheduleProfile &profile : m_profiles)
+        profileArray.append(profile.toJson());
+    json["scheduleProfiles"] = profileArray;
+    return json;
+}
+
+void DownloadManager::persistTask(DownloadTask *task)
+{
+    m_store.putTask(taskToJson(m_records.record(task->handle())));
+}
+
+void DownloadManager::persistSettings()
+{
+    m_store.putSettings(settingsToJson());
+}
+
+TaskRecord DownloadManager::newRecord(const QString &url)
+{
+    TaskRecord record;
+    record.id = QUuid::createUuid();
+    record.fileName = DownloadTask::fileNameFromUrl(url);
+    record.status = DownloadTask::Pending;
+    return record;
+}
+
+QString DownloadManager::insertTask(const TaskRecord &record, const QString &url, const QString &savePath)
+{
+    TaskHandle handle = m_records.insert(record, url, savePath.isEmpty() ? m_defaultSavePath : savePath);
+    m_store.putTask(taskToJson(m_records.record(handle)));
+    return record.id.toString(QUuid::WithoutBraces);
+}
+
+DownloadTask *DownloadManager::facade(TaskHandle handle)
+{
+    DownloadTask *&task = m_facades[handle];
+    if (!task) {
+        task = new DownloadTask(&m_records, handle, this);
+        // 速度由下载器定时更新，变化时也计入下一次快照
+        connect(task, &DownloadTask::speedChanged, this, [this, handle]() {
+            markProgressChanged(handle);
+        });
+    }
+    return task;
+}
+
+void DownloadManager::releaseFacade(TaskHandle handle)
+{
+    DownloadTask *task = m_facades.take(handle);
+    if (task)
+        task->deleteLater();
+}
+
+void DownloadManager::retireTask(TaskHandle handle)
+{
+    // 已结束的任务已写入数据库，从内存工作集中移除
+    if (!m_records.contains(handle))
+        return;
+    ++m_historyCounts[historyKindOf(m_records.record(handle).status)];
+    m_records.remove(handle);
+    m_transferring.remove(handle);
+    m_diskSpace.release(handle);
+    m_concurrency->release(handle);
+
+    // 本轮事件中界面和下载器仍可能访问外观对象，对象销毁后记录槽位才能复用
+    DownloadTask *task = m_facades.take(handle);
+    if (task) {
+        connect(task, &QObject::destroyed, this, [this, handle]() {
+            m_records.recycle(handle);
+        });
+        task->deleteLater();
+    } else {
+        m_records.recycle(handle);
     }
 }
 
+DownloadManager::HistoryKind DownloadManager::historyKindOf(int status)
+{
+    return status == DownloadTask::Completed ? CompletedHistory : FailedHistory;
+}
+
+QList<int> DownloadManager::historyStatuses(HistoryKind kind)
+{
+    if (kind == CompletedHistory)
+        return {DownloadTask::Completed};
+    return {DownloadTask::Failed, DownloadTask::Cancelled};
+}
+
 void DownloadManager::onDownloadStarted(DownloadTask *task)
 {
     LOG_INFO(QString("下载开始 - ID: %1").arg(task->id()));
@@ -477,9 +1105,12 @@ void DownloadManager::onDownloadCancelled(DownloadTask *task)
     m_activeDownloadCount--;
     task->setEndTime(QDateTime::currentDateTime());
     task->setErrorMessage(tr("用户取消"));
+    if (task->isDirectory())
+        finishSyncRun(task);
+    persistTask(task);
     emit taskCancelled(task->id());
+    retireTask(task->handle());
     processNextTask();
-    saveTasks();
 }
 
 void DownloadManager::onDownloadCompleted(DownloadTask *task)
@@ -488,52 +1119,295 @@ void DownloadManager::onDownloadCompleted(DownloadTask *task)
     m_activeDownloadCount--;
     task->setEndTime(QDateTime::currentDateTime());
     task->setStatus(DownloadTask::Completed);
+    if (task->isDirectory()) {
+        expandDirectoryFailures(task);
+        finishSyncRun(task);
+    }
+    persistTask(task);
     emit taskCompleted(task->id());
+    retireTask(task->handle());
     processNextTask();
-    saveTasks();
+
+    // 只有最后一个任务成功结束才算全部完成，取消、失败或移除清空队列时不提示
+    if (m_records.count() == 0)
+        emit allTasksCompleted();
 }
 
 void DownloadManager::onDownloadFailed(DownloadTask *task, const QString &error)
 {
     LOG_ERROR(QString("下载失败 - ID: %1, 错误: %2").arg(task->id()).arg(error));
     m_activeDownloadCount--;
+    m_concurrency->release(task->handle(), true);
     task->setEndTime(QDateTime::currentDateTime());
     task->setStatus(DownloadTask::Failed);
     task->setErrorMessage(error);
+    if (task->isDirectory())
+        finishSyncRun(task);
+    persistTask(task);
     emit taskFailed(task->id(), error);
+    retireTask(task->handle());
     processNextTask();
-    saveTasks();
 }
 
 void DownloadManager::onDownloadProgress(DownloadTask *task, qint64 bytesReceived, qint64 bytesTotal)
 {
     Q_UNUSED(bytesReceived);
     Q_UNUSED(bytesTotal);
-    emit taskProgress(task->id(), task->downloadedSize(), task->totalSize());
+    // 已落盘的字节从预留中扣除；开始时大小未知的任务在这里补上预留
+    const TaskRecord &record = m_records.record(task->handle());
+    m_diskSpace.update(task->handle(), TaskRecordStore::remainingBytes(record));
+    m_concurrency->progress(task->handle(), record.downloadedSize);
+    markProgressChanged(task->handle());
+}
+
+void DownloadManager::markProgressChanged(TaskHandle handle)
+{
+    m_progressChanged.insert(handle);
+    if (!m_progressTimer->isActive()) {
+        // 空闲期间不计入合计速率
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        m_throughput.reset(now, m_concurrency->bytesTransferred());
+        m_progressTimer->start();
+    }
+}
+
+void DownloadManager::publishProgress()
+{
+    // 下载中的任务没有进度时也要继续发布，停滞才能反映到合计速率上
+    if (m_progressChanged.isEmpty() && m_records.count(DownloadTask::Downloading) == 0) {
+        m_progressTimer->stop();
+        return;
+    }
+
+    ProgressSnapshot snapshot;
+    snapshot.tasks.reserve(m_progressChanged.size());
+    for (TaskHandle handle : m_progressChanged) {
+        if (!m_records.contains(handle))
+            continue;
+        const TaskRecord &record = m_records.record(handle);
+        DownloadTask *task = m_facades.value(handle);
+        TaskProgress progress;
+        progress.taskId = record.id.toString(QUuid::WithoutBraces);
+        progress.bytesReceived = record.downloadedSize;
+        progress.bytesTotal = record.totalSize;
+        progress.speed = task ? task->speed() : 0;
+        snapshot.tasks.append(progress);
+    }
+    m_progressChanged.clear();
+
+    snapshot.activeCount = 0;
+    snapshot.bytesReceived = 0;
+    snapshot.bytesTotal = 0;
+    for (TaskHandle handle : m_records.withStatus(DownloadTask::Downloading)) {
+        const TaskRecord &record = m_records.record(handle);
+        ++snapshot.activeCount;
+        snapshot.bytesReceived += record.downloadedSize;
+        snapshot.bytesTotal += record.totalSize;
+    }
+
+    // 合计速率和各任务的速率一样按窗口估计，不是各任务速率之和
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 transferred = m_concurrency->bytesTransferred();
+    m_throughput.addSample(now, transferred);
+    snapshot.speed = m_throughput.rate();
+    snapshot.averageSpeed = m_throughput.averageRate();
+    snapshot.stalled = snapshot.activeCount > 0 && m_throughput.isStalled();
+    snapshot.queueRemaining = m_records.totalRemainingBytes();
+    snapshot.queueRemainingExact = isQueueSizeExact();
+    snapshot.secondsRemaining = m_throughput.secondsRemaining(snapshot.queueRemaining);
+    snapshot.confidence = snapshot.queueRemainingExact ? m_throughput.confidence() : 0.0;
+
+    emit progressSnapshot(snapshot);
+}
+
+bool DownloadManager::isQueueSizeExact() const
+{
+    // 剩余字节由任务记录即时维护；大小未知或仍在扫描的目录任务使总数只是下限，
+    // 目录任务通常很少，逐个查看扫描状态
+    if (m_records.unknownSizeCount() > 0)
+        return false;
+    for (TaskHandle handle : m_records.directories()) {
+        const QSharedPointer<DirectoryJob> &job = m_records.record(handle).directoryJob;
+        if (job && !job->isScanFinished())
+            return false;
+    }
+    return true;
 }
 
 void DownloadManager::processNextTask()
 {
     LOG_DEBUG("处理下一个任务");
     
-    for (DownloadTask *task : m_tasks) {
-        if (task->status() == DownloadTask::Pending ||
-            task->status() == DownloadTask::Queued) {
-            LOG_INFO(QString("开始处理排队任务 - ID: %1").arg(task->id()));
-            startTask(task->id());
-            break;
+    // 因磁盘空间不足而排队的任务已经开始过，空间够了先恢复它们；
+    // 剩下的名额由等待中的任务按优先级从高到低填上
+    admitQueuedTasks();
+    startPendingTasks();
+
+    // 工作集中只有未结束的任务，为空即表示队列已全部处理完
+    if (m_records.count() == 0)
+        emit queueDrained();
+}
+
+void DownloadManager::startPendingTasks()
+{
+    // 每次在有名额的服务器中取优先级最高的等待任务开始，直到没有可开始的任务。
+    // 名额已满的服务器整体跳过，其他服务器上的任务不会排在它的任务后面等待
+    QSet<QString> skipped;
+    forever {
+        TaskHandle best = InvalidTaskHandle;
+        QString bestServer;
+        const QStringList servers = m_records.pendingServers();
+        for (const QString &server : servers) {
+            if (skipped.contains(server) || !m_concurrency->hasSlot(server))
+                continue;
+            TaskHandle handle = m_records.nextPending(server);
+            if (best == InvalidTaskHandle
+                    || m_records.record(handle).priority > m_records.record(best).priority) {
+                best = handle;
+                bestServer = server;
+            }
         }
+        // 当前时段不允许的优先级不开始，更低的也都不允许
+        if (best == InvalidTaskHandle || m_records.record(best).priority < m_minPriority)
+            break;
+
+        QString taskId = m_records.record(best).id.toString(QUuid::WithoutBraces);
+        LOG_INFO(QString("开始处理排队任务 - ID: %1").arg(taskId));
+        startTask(taskId);
+        // 仍在等待说明这个服务器暂时开始不了任务，本轮不再尝试
+        if (m_records.contains(best) && m_records.record(best).status == DownloadTask::Pending)
+            skipped.insert(bestServer);
+    }
+}
+
+bool DownloadManager::admitTask(DownloadTask *task)
+{
+    const TaskRecord &record = m_records.record(task->handle());
+    qint64 remaining = TaskRecordStore::remainingBytes(record);
+    if (m_diskSpace.reserve(task->handle(), task->savePath(), remaining)) {
+        if (task->status() == DownloadTask::Queued)
+            task->setErrorMessage(QString());
+        return true;
+    }
+
+    // 卷上的空间已被其他任务预留，留在排队中，有任务结束或定时检查时再尝试
+    if (task->status() != DownloadTask::Queued) {
+        LOG_WARNING(QString("磁盘空间不足，任务排队等待 - ID: %1, 需要: %2 字节, 保存位置: %3")
+                    .arg(task->id()).arg(remaining).arg(task->savePath()));
+        task->setStatus(DownloadTask::Queued);
+        task->setErrorMessage(tr("磁盘空间不足，等待其他任务完成"));
+    }
+    return false;
+}
+
+int DownloadManager::admitQueuedTasks()
+{
+    if (m_records.withStatus(DownloadTask::Queued).isEmpty())
+        return 0;
+
+    // 同一卷上的可用空间只读取一次，已满的卷不再逐个尝试
+    QHash<QString, qint64> available;
+    QStringList admitted;
+    for (TaskHandle handle : m_records.withStatus(DownloadTask::Queued)) {
+        const TaskRecord &record = m_records.record(handle);
+        QString savePath = m_records.savePath(record);
+        QString volume = m_diskSpace.volumeOf(savePath);
+        auto it = available.find(volume);
+        if (it == available.end())
+            it = available.insert(volume, m_diskSpace.available(savePath));
+        qint64 remaining = TaskRecordStore::remainingBytes(record);
+        if (it.value() < remaining)
+            continue;
+        it.value() -= remaining;
+        admitted.append(record.id.toString(QUuid::WithoutBraces));
+    }
+
+    // 开始任务会改变状态集合，遍历结束后再开始
+    for (const QString &taskId : admitted) {
+        LOG_INFO(QString("磁盘空间已足够，恢复排队任务 - ID: %1").arg(taskId));
+        startTask(taskId);
     }
+    return admitted.size();
 }
 
 void DownloadManager::updateActiveDownloadCount()
 {
-    m_activeDownloadCount = 0;
-    for (DownloadTask *task : m_tasks) {
-        if (task->status() == DownloadTask::Downloading) {
-            m_activeDownloadCount++;
+    m_activeDownloadCount = m_records.count(DownloadTask::Downloading);
+}
+
+void DownloadManager::startDirectoryScan(DownloadTask *task)
+{
+    QSharedPointer<DirectoryJob> job = task->directoryJob();
+    if (!job || job->isScanFinished() || m_scanners.contains(task->id()))
+        return;
+
+    LOG_INFO(QString("开始扫描目录 - ID: %1, URL: %2").arg(task->id()).arg(task->url()));
+
+    QString taskId = task->id();
+    DirectoryWorker *scanner = new DirectoryWorker(task->url(), task->savePath(), job, this);
+    scanner->setTrustDirectoryMtime(m_trustDirectoryMtime);
+    connect(scanner, &DirectoryWorker::scanProgress, this, [this, taskId](int fileCount, qint64 totalBytes) {
+        Q_UNUSED(fileCount);
+        // 扫描中就发布总大小，目录的剩余时间按已知总量计算
+        DownloadTask *task = getTask(taskId);
+        if (task) {
+            task->setTotalSize(totalBytes);
+            m_diskSpace.update(task->handle(),
+                               TaskRecordStore::remainingBytes(m_records.record(task->handle())));
+            markProgressChanged(task->handle());
+        }
+    });
+    connect(scanner, &DirectoryWorker::finished, this, [this, taskId]() {
+        m_scanners.remove(taskId);
+        DownloadTask *task = getTask(taskId);
+        if (task) {
+            LOG_INFO(QString("目录扫描结束 - ID: %1, 文件数: %2")
+                     .arg(taskId).arg(task->directoryJob()->fileCount()));
+            persistTask(task);
         }
+    });
+    connect(scanner, &QThread::finished, scanner, &QObject::deleteLater);
+    m_scanners[taskId] = scanner;
+    scanner->start();
+}
+
+void DownloadManager::stopDirectoryScan(DownloadTask *task)
+{
+    if (task->isDirectory())
+        task->directoryJob()->requestCancelScan();
+}
+
+void DownloadManager::expandDirectoryFailures(DownloadTask *task)
+{
+    // 目录中只有失败的文件才展开为独立任务，便于查看原因
+    const QList<DirectoryJob::Failure> failures = task->directoryJob()->failures();
+    if (failures.isEmpty())
+        return;
+
+    QString rootUrl = task->url();
+    if (!rootUrl.endsWith('/') && !rootUrl.endsWith('\\'))
+        rootUrl += '/';
+    QDir localRoot(task->savePath());
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QString syncId = task->directoryJob()->syncId();
+    SyncJob *syncJob = m_syncJobs.contains(syncId) ? &m_syncJobs[syncId] : nullptr;
+
+    for (const DirectoryJob::Failure &failure : failures) {
+        // 展开的任务只写入数据库，不进入工作集，也不登记到路径字典
+        QString childUrl = rootUrl + failure.relativePath;
+        TaskRecord child = newRecord(childUrl);
+        child.status = DownloadTask::Failed;
+        child.endTime = now;
+        child.errorMessage = failure.error;
+        m_store.putTask(taskToJson(child, childUrl,
+                                   QFileInfo(localRoot.filePath(failure.relativePath)).absolutePath()));
+        ++m_historyCounts[FailedHistory];
+        // 镜像同步记下展开的任务，下次运行前删除；由 finishSyncRun 保存
+        if (syncJob)
+            syncJob->failureTaskIds.append(child.id.toString(QUuid::WithoutBraces));
     }
+
+    LOG_WARNING(QString("目录任务有 %1 个文件下载失败 - ID: %2").arg(failures.size()).arg(task->id()));
 }
 
 void DownloadManager::loadFromJson() {
@@ -4,25 +4,115 @@
 #include <QObject>
 #include <QList>
 #include <QMap>
+#include <QHash>
+#include <QSet>
 #include <QFile>
 #include <QTextStream>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QTimer>
+#include "concurrencycontroller.h"
+#include "diskspaceledger.h"
 #include "downloadtask.h"
-#include "smbdownloader.h"
+#include "scheduleprofile.h"
+#include "taskstore.h"
+#include "throughputestimator.h"
+
+class DirectoryWorker;
+class Downloader;
 
 class DownloadManager : public QObject
 {
     Q_OBJECT
 
 public:
+    // 镜像同步配置：让本地目录与远程根目录保持一致
+    struct SyncJob {
+        QString id;
+        QString url;
+        QString localPath;
+        QString filterText;
+        bool deleteRemoved;
+        int intervalMinutes;    // 0 表示只在手动触发时运行
+        QDateTime lastRun;
+        QString lastSummary;
+        QString runningTaskId;
+        QStringList failureTaskIds;     // 上一次运行中失败文件展开的任务，下次运行前删除
+    };
+
+    // 已结束的任务不常驻内存，按需从数据库分页读取
+    enum HistoryKind {
+        CompletedHistory,   // 完成
+        FailedHistory       // 失败或取消
+    };
+
+    struct HistoryRecord {
+        QString id;
+        QString url;
+        QString fileName;
+        QString savePath;
+        DownloadTask::Status status;
+        qint64 size;
+        QDateTime endTime;
+        QString errorMessage;
+    };
+
+    // 定时发布的进度快照：只包含上一次快照以来进度或速度变化过的任务，
+    // 以及所有下载中任务的合计
+    struct TaskProgress {
+        QString taskId;
+        qint64 bytesReceived;
+        qint64 bytesTotal;
+        qint64 speed;
+    };
+
+    // 批量添加的一项；优先级高的等待任务先开始
+    struct TaskRequest {
+        QString url;
+        QString savePath;
+        int priority;
+    };
+
+    // 合计速率按全部传输收到的字节在时间窗口内估计，停滞时降为 0；
+    // 剩余时间针对全部未结束的任务，有大小未知的任务时只是下限
+    struct ProgressSnapshot {
+        QList<TaskProgress> tasks;
+        int activeCount;
+        qint64 bytesReceived;
+        qint64 bytesTotal;
+        qint64 speed;
+        qint64 averageSpeed;
+        bool stalled;
+        qint64 queueRemaining;      // 未结束任务剩余的字节
+        bool queueRemainingExact;
+        qint64 secondsRemaining;    // -1 表示无法估计
+        double confidence;          // 剩余时间的可信度，0 到 1
+    };
+
     explicit DownloadManager(QObject *parent = nullptr);
+    // 使用指定的传输后端（由管理器接管），为空时使用 SmbDownloader
+    explicit DownloadManager(Downloader *downloader, QObject *parent = nullptr);
     ~DownloadManager();
 
     // 任务管理
     QString addTask(const QString &url,
                     const QString &savePath = "");
+    // 列目录时已知远程文件大小和修改时间，直接交给任务，下载时无需再次查询
+    QString addTask(const QString &url,
+                    const QString &savePath,
+                    qint64 remoteSize,
+                    const QDateTime &remoteModified);
+    // 批量添加文件任务，全部任务在一个事务中写入数据库，只发出一次 tasksAdded；返回新任务的 ID
+    QStringList addTasks(const QStringList &urls,
+                         const QString &savePath = "");
+    QStringList addTasks(const QList<TaskRequest> &requests);
+    // 内存中全部任务的地址，批量导入时用于去重
+    QStringList taskUrls() const;
+    // 目录任务：整棵目录树只对应一个任务，子文件在后台扫描时逐步加入
+    QString addDirectoryTask(const QString &dirUrl,
+                             const QString &localPath,
+                             const QString &filterText = QString());
     void removeTask(const QString &taskId);
     void removeCompletedTasks();
     
@@ -37,12 +127,42 @@ public:
     void pauseAllTasks();
     void cancelAllTasks();
     
-    // 查询
-    DownloadTask* getTask(const QString &taskId) const;
-    QList<DownloadTask*> getAllTasks() const;
-    QList<DownloadTask*> getActiveTasks() const;
-    QList<DownloadTask*> getCompletedTasks() const;
-    QList<DownloadTask*> getFailedTasks() const;
+    // 镜像同步
+    QString addSyncJob(const QString &url,
+                       const QString &localPath,
+                       const QString &filterText,
+                       bool deleteRemoved,
+                       int intervalMinutes);
+    void removeSyncJob(const QString &syncId);
+    void runSyncJob(const QString &syncId);
+    void runAllSyncJobs();
+    QList<SyncJob> syncJobs() const;
+
+    // 查询：内存中只保留未结束的任务，数据在记录中，
+    // 以下接口按需为任务创建 DownloadTask 外观对象
+    DownloadTask* getTask(const QString &taskId);
+    QList<DownloadTask*> getAllTasks();
+    QList<DownloadTask*> getActiveTasks();
+    // 界面显示用：全部下载中和暂停的任务，加上至多 pendingLimit 个等待中的任务；
+    // 同时释放不再显示的等待任务的外观对象
+    QList<DownloadTask*> getVisibleTasks(int pendingLimit);
+
+    // 全部下载中任务的进度，不创建外观对象
+    QList<TaskProgress> activeTransfers() const;
+
+    // 只读访问任务记录，不创建外观对象；任务不存在时返回 nullptr
+    const TaskRecord *taskRecord(const QString &taskId) const;
+
+    // 按状态维护的成员集合和计数，随状态变化即时更新，查询无需遍历
+    int taskCount() const;
+    int taskCount(DownloadTask::Status status) const;
+    const QSet<TaskHandle> &tasksWithStatus(DownloadTask::Status status) const;
+
+    // 历史记录，按结束时间倒序；filter 匹配文件名、路径或错误信息
+    QList<HistoryRecord> queryHistory(HistoryKind kind, const QString &filter,
+                                      int offset, int limit) const;
+    int historyCount(HistoryKind kind, const QString &filter = QString()) const;
+    void clearHistory(HistoryKind kind);
     
     // 设置
     QString getDefaultSavePath() const;
@@ -51,8 +171,28 @@ public:
     // 最近一次输入的地址
     QString getLastUrl() const;
     void setLastUrl(const QString &url);
+
+    // 增量同步时是否信任远程目录的修改时间（服务器支持时可跳过未变化的目录）
+    bool trustDirectoryMtime() const;
+    void setTrustDirectoryMtime(bool trust);
+
+    // 目录任务是否先完成预扫描再开始传输
+    bool prescanDirectories() const;
+    void setPrescanDirectories(bool prescan);
+
+    // 每个服务器同时传输的任务数在此范围内按吞吐自动调整
+    int minConcurrency() const;
+    int maxConcurrency() const;
+    void setConcurrencyLimits(int minLimit, int maxLimit);
+    QList<ConcurrencyController::ServerState> concurrencyState() const;
+
+    // 按时段自动生效的限速、并发和优先级限制；切换时段时正在进行的传输继续，不重新开始
+    QList<ScheduleProfile> scheduleProfiles() const;
+    void setScheduleProfiles(const QList<ScheduleProfile> &profiles);
+    // 当前生效的时段名称，不在任何时段内时为空
+    QString activeProfileName() const;
     
-    // 持久化
+    // 持久化：任务保存在 tasks.db，saveTasks 一次性写入内存中的全部任务
     void saveTasks();
     void loadTasks();
 
@@ -63,6 +203,7 @@ public:
 
 signals:
     void taskAdded(const QString &taskId);
+    void tasksAdded(int count);
     void taskRemoved(const QString &taskId);
     void taskStarted(const QString &taskId);
     void taskPaused(const QString &taskId);
@@ -70,11 +211,16 @@ signals:
     void taskCancelled(const QString &taskId);
     void taskCompleted(const QString &taskId);
     void taskFailed(const QString &taskId, const QString &error);
-    void taskProgress(const QString &taskId, qint64 bytesReceived, qint64 bytesTotal);
+    void progressSnapshot(const DownloadManager::ProgressSnapshot &snapshot);
+    // 最后一个未结束的任务下载成功
     void allTasksCompleted();
+    // 工作集已空（最后一个任务完成、失败、取消或被移除）
+    void queueDrained();
+    void syncFinished(const QString &syncId, const QString &summary);
+    void concurrencyChanged(const QString &server, int limit, const QString &reason);
+    void scheduleProfileChanged(const QString &name);
 
 private slots:
-    void onTaskStatusChanged(DownloadTask::Status status);
     void onDownloadStarted(DownloadTask *task);
     void onDownloadPaused(DownloadTask *task);
     void onDownloadResumed(DownloadTask *task);
@@ -82,18 +228,60 @@ private slots:
     void onDownloadCompleted(DownloadTask *task);
     void onDownloadFailed(DownloadTask *task, const QString &error);
     void onDownloadProgress(DownloadTask *task, qint64 bytesReceived, qint64 bytesTotal);
+    void checkSyncSchedule();
+    void publishProgress();
 
 private:
-    QMap<QString, DownloadTask*> m_tasks;
-    SmbDownloader *m_smbDownloader;
+    TaskRecordStore m_records;
+    QHash<TaskHandle, DownloadTask*> m_facades;
+    QSet<TaskHandle> m_transferring;    // 已交给下载器且尚未结束的任务，其外观对象不能释放
+    QMap<QString, DirectoryWorker*> m_scanners;
+    QMap<QString, SyncJob> m_syncJobs;
+    QTimer *m_syncTimer;
+    QTimer *m_progressTimer;
+    QSet<TaskHandle> m_progressChanged;
+    Downloader *m_downloader;
+    TaskStore m_store;
+    DiskSpaceLedger m_diskSpace;
+    ConcurrencyController *m_concurrency;
+    ThroughputEstimator m_throughput;
+    QList<ScheduleProfile> m_profiles;
+    int m_activeProfile;        // m_profiles 中的下标，-1 表示不在任何时段内
+    int m_minPriority;          // 当前时段允许自动开始的最低优先级
 
     QString m_defaultSavePath;
     int m_activeDownloadCount;
     QString m_lastUrl;
+    bool m_trustDirectoryMtime;
+    bool m_prescanDirectories;
+    int m_historyCounts[2];
     
     // 辅助方法
     void processNextTask();
+    void startPendingTasks();
+    bool applySchedule(bool force = false);
+    bool admitTask(DownloadTask *task);
+    int admitQueuedTasks();
     void updateActiveDownloadCount();
+    void startDirectoryScan(DownloadTask *task);
+    void stopDirectoryScan(DownloadTask *task);
+    void expandDirectoryFailures(DownloadTask *task);
+    void finishSyncRun(DownloadTask *task);
+    DownloadTask *facade(TaskHandle handle);
+    void releaseFacade(TaskHandle handle);
+    TaskRecord newRecord(const QString &url);
+    QString insertTask(const TaskRecord &record, const QString &url, const QString &savePath);
+    QJsonObject taskToJson(const TaskRecord &record) const;
+    QJsonObject taskToJson(const TaskRecord &record, const QString &url, const QString &savePath) const;
+    TaskRecord recordFromJson(const QJsonObject &taskObject);
+    QJsonObject settingsToJson() const;
+    void persistTask(DownloadTask *task);
+    void persistSettings();
+    void retireTask(TaskHandle handle);
+    void markProgressChanged(TaskHandle handle);
+    bool isQueueSizeExact() const;
+    static HistoryKind historyKindOf(int status);
+    static QList<int> historyStatuses(HistoryKind kind);
 };
 
 #endif // DOWNLOADMANAGER_H 
\ No newline at end of file
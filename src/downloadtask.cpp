@@ -1,41 +1,26 @@
 #include "downloadtask.h"
+#include "directoryjob.h"
 #include <QDebug>
 #include <QFileInfo>
 #include "pathutils.h"
-#include <QUuid>
 #include "logger.h"
 
-DownloadTask::DownloadTask(QObject *parent)
+DownloadTask::DownloadTask(TaskRecordStore *records, TaskHandle handle, QObject *parent)
     : QObject(parent)
-    , m_status(Pending)
-    , m_progress(0.0)
-    , m_downloadedSize(0)
-    , m_totalSize(0)
+    , m_records(records)
+    , m_handle(handle)
     , m_speed(0)
-    , m_supportsResume(false)
+    , m_etaConfidence(0.0)
+    , m_stalled(false)
 {
-    LOG_DEBUG("创建新的下载任务");
-    generateId();
 }
 
-DownloadTask::DownloadTask(const QString &url, const QString &savePath, QObject *parent)
-    : DownloadTask(parent)
+QString DownloadTask::fileNameFromUrl(const QString &url)
 {
-    setUrl(url);
-    setSavePath(savePath);
-}
-
-DownloadTask::~DownloadTask()
-{
-    LOG_DEBUG(QString("销毁下载任务 - ID: %1").arg(m_id));
-}
-
-void DownloadTask::setUrl(const QString &url)
-{
-    m_url = url;
-    
     // 从路径中提取文件名，避免 QUrl 误解析 '#' 等字符
     QString uncPath = toUncPath(url);
+    while (uncPath.endsWith('\\') || uncPath.endsWith('/'))
+        uncPath.chop(1);
     QString fileName = QFileInfo(uncPath).fileName();
     if (fileName.isEmpty()) {
         // UNC 转换失败时退回使用原字符串解析
@@ -44,23 +29,36 @@ void DownloadTask::setUrl(const QString &url)
     if (fileName.isEmpty()) {
         fileName = "downloaded_file";
     }
-    setFileName(fileName);
+    return fileName;
+}
+
+double DownloadTask::progressOf(const TaskRecord &record)
+{
+    if (record.totalSize <= 0)
+        return 0.0;
+    return qBound(0.0, (double)record.downloadedSize / record.totalSize * 100.0, 100.0);
+}
+
+void DownloadTask::setUrl(const QString &url)
+{
+    m_records->setUrl(record(), url);
+    setFileName(fileNameFromUrl(url));
 }
 
 void DownloadTask::setSavePath(const QString &path)
 {
-    m_savePath = path;
+    m_records->setSavePath(record(), path);
 }
 
 void DownloadTask::setFileName(const QString &name)
 {
-    m_fileName = name;
+    m_records->setFileName(record(), name);
 }
 
 void DownloadTask::setStatus(Status status)
 {
-    if (m_status != status) {
-        m_status = status;
+    if (record().status != status) {
+        m_records->setStatus(m_handle, status);
         emit statusChanged(status);
         
         // 记录状态变化
@@ -75,36 +73,30 @@ void DownloadTask::setStatus(Status status)
         case Cancelled: statusText = "取消"; break;
         }
         
-        LOG_INFO(QString("任务状态变化 - ID: %1, 状态: %2").arg(m_id).arg(statusText));
+        LOG_INFO(QString("任务状态变化 - ID: %1, 状态: %2").arg(id()).arg(statusText));
     }
 }
 
-void DownloadTask::setProgress(double progress)
+void DownloadTask::updateProgress(double previous)
 {
-    if (qAbs(m_progress - progress) > 0.01) { // 避免频繁更新
-        m_progress = qBound(0.0, progress, 100.0);
-        emit progressChanged(m_progress);
+    double progress = progressOf(record());
+    if (qAbs(progress - previous) > 0.01) { // 避免频繁更新
+        emit progressChanged(progress);
     }
 }
 
 void DownloadTask::setDownloadedSize(qint64 size)
 {
-    m_downloadedSize = size;
-    
-    // 更新进度
-    if (m_totalSize > 0) {
-        setProgress((double)m_downloadedSize / m_totalSize * 100.0);
-    }
+    double previous = progress();
+    m_records->setDownloadedSize(m_handle, size);
+    updateProgress(previous);
 }
 
 void DownloadTask::setTotalSize(qint64 size)
 {
-    m_totalSize = size;
-    
-    // 更新进度
-    if (m_totalSize > 0) {
-        setProgress((double)m_downloadedSize / m_totalSize * 100.0);
-    }
+    double previous = progress();
+    m_records->setTotalSize(m_handle, size);
+    updateProgress(previous);
 }
 
 void DownloadTask::setSpeed(qint64 speed)
@@ -115,21 +107,45 @@ void DownloadTask::setSpeed(qint64 speed)
     }
 }
 
+void DownloadTask::setEstimate(qint64 speed, double confidence, bool stalled)
+{
+    m_etaConfidence = confidence;
+    m_stalled = stalled;
+    setSpeed(speed);
+}
+
 void DownloadTask::setErrorMessage(const QString &message)
 {
-    m_errorMessage = message;
-    LOG_ERROR(QString("任务错误 - ID: %1, 错误: %2").arg(m_id).arg(message));
+    record().errorMessage = message;
+    LOG_ERROR(QString("任务错误 - ID: %1, 错误: %2").arg(id()).arg(message));
     emit errorOccurred(message);
 }
 
-void DownloadTask::generateId()
+QDateTime DownloadTask::endTime() const
+{
+    qint64 time = record().endTime;
+    return time ? QDateTime::fromMSecsSinceEpoch(time) : QDateTime();
+}
+
+void DownloadTask::setEndTime(const QDateTime &time)
+{
+    record().endTime = time.isValid() ? time.toMSecsSinceEpoch() : 0;
+}
+
+QDateTime DownloadTask::remoteModified() const
 {
-    m_id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    qint64 time = record().remoteModified;
+    return time ? QDateTime::fromMSecsSinceEpoch(time) : QDateTime();
+}
+
+void DownloadTask::setRemoteModified(const QDateTime &time)
+{
+    record().remoteModified = time.isValid() ? time.toMSecsSinceEpoch() : 0;
 }
 
 QString DownloadTask::statusText() const
 {
-    switch (m_status) {
+    switch (status()) {
     case Pending:
         return QObject::tr("等待中");
     case Queued:
@@ -172,21 +188,40 @@ QString DownloadTask::speedText() const
 
 QString DownloadTask::timeRemainingText() const
 {
-    if (m_speed <= 0 || m_progress <= 0) {
+    if (m_stalled && status() == Downloading)
+        return QObject::tr("停滞");
+    if (m_speed <= 0 || progress() <= 0) {
         return QObject::tr("计算中...");
     }
     
-    qint64 remainingBytes = m_totalSize - m_downloadedSize;
+    // 目录任务按扫描得到的总大小计算，扫描未结束时只是下限
+    const TaskRecord &task = record();
+    qint64 totalSize = task.totalSize;
+    QString prefix;
+    if (task.directoryJob) {
+        totalSize = qMax(totalSize, task.directoryJob->totalBytes());
+        if (!task.directoryJob->isScanFinished())
+            prefix = QObject::tr("至少");
+    }
+    // 窗口未填满或速率波动大时只是粗略估计
+    if (prefix.isEmpty() && m_etaConfidence < 0.5)
+        prefix = QObject::tr("约");
+
+    qint64 remainingBytes = totalSize - task.downloadedSize;
     if (remainingBytes <= 0) {
         return QObject::tr("完成");
     }
     
-    qint64 remainingSeconds = remainingBytes / m_speed;
-    if (remainingSeconds < 60) {
-        return QString("%1秒").arg(remainingSeconds);
-    } else if (remainingSeconds < 3600) {
-        return QString("%1分钟").arg(remainingSeconds / 60);
+    return prefix + durationText(remainingBytes / m_speed);
+}
+
+QString DownloadTask::durationText(qint64 seconds)
+{
+    if (seconds < 60) {
+        return QString("%1秒").arg(seconds);
+    } else if (seconds < 3600) {
+        return QString("%1分钟").arg(seconds / 60);
     } else {
-        return QString("%1小时").arg(remainingSeconds / 3600);
+        return QString("%1小时").arg(seconds / 3600);
     }
 } 
\ No newline at end of file
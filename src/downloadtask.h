@@ -5,6 +5,10 @@
 #include <QString>
 #include <QUrl>
 #include <QDateTime>
+#include <QSharedPointer>
+#include "taskrecordstore.h"
+
+class DirectoryJob;
 
 class DownloadTask : public QObject
 {
@@ -22,54 +26,73 @@ public:
     };
     Q_ENUM(Status)
 
-    explicit DownloadTask(QObject *parent = nullptr);
-    explicit DownloadTask(const QString &url, const QString &savePath, QObject *parent = nullptr);
-    ~DownloadTask();
-    
+    // 外观对象：数据保存在 TaskRecordStore 的记录中，只为界面正在显示
+    // 或下载器正在处理的任务创建，提供信号接口
+    DownloadTask(TaskRecordStore *records, TaskHandle handle, QObject *parent = nullptr);
+
+    TaskHandle handle() const { return m_handle; }
+
     // 基本属性
-    QString id() const { return m_id; }
-    void setId(const QString &id) { m_id = id; }
+    QString id() const { return record().id.toString(QUuid::WithoutBraces); }
     
-    QString url() const { return m_url; }
+    QString url() const { return m_records->url(record()); }
     void setUrl(const QString &url);
     
-    QString savePath() const { return m_savePath; }
+    QString savePath() const { return m_records->savePath(record()); }
     void setSavePath(const QString &path);
     
-    QString fileName() const { return m_fileName; }
+    QString fileName() const { return record().fileName; }
     void setFileName(const QString &name);
     
     // 状态和进度
-    Status status() const { return m_status; }
+    Status status() const { return static_cast<Status>(record().status); }
     void setStatus(Status status);
     
-    double progress() const { return m_progress; }
-    void setProgress(double progress);
+    double progress() const { return progressOf(record()); }
     
-    qint64 downloadedSize() const { return m_downloadedSize; }
+    qint64 downloadedSize() const { return record().downloadedSize; }
     void setDownloadedSize(qint64 size);
     
-    qint64 totalSize() const { return m_totalSize; }
+    qint64 totalSize() const { return record().totalSize; }
     void setTotalSize(qint64 size);
     
     qint64 speed() const { return m_speed; }
     void setSpeed(qint64 speed);
+    // 下载器按时间窗口估计的速率、剩余时间的可信度（0 到 1）和是否停滞
+    void setEstimate(qint64 speed, double confidence, bool stalled);
+    double etaConfidence() const { return m_etaConfidence; }
+    bool isStalled() const { return m_stalled; }
     
-    QString errorMessage() const { return m_errorMessage; }
+    QString errorMessage() const { return record().errorMessage; }
     void setErrorMessage(const QString &message);
     
-    bool supportsResume() const { return m_supportsResume; }
-    void setSupportsResume(bool supports) { m_supportsResume = supports; }
+    bool supportsResume() const { return record().supportsResume; }
+    void setSupportsResume(bool supports) { record().supportsResume = supports; }
     
     // 时间信息
-    QDateTime endTime() const { return m_endTime; }
-    void setEndTime(const QDateTime &time) { m_endTime = time; }
+    QDateTime endTime() const;
+    void setEndTime(const QDateTime &time);
+
+    // 远程文件的修改时间（列目录时取得，未知时无效）
+    QDateTime remoteModified() const;
+    void setRemoteModified(const QDateTime &time);
+
+    // 目录任务：子文件以紧凑记录保存在 DirectoryJob 中
+    bool isDirectory() const { return !record().directoryJob.isNull(); }
+    QSharedPointer<DirectoryJob> directoryJob() const { return record().directoryJob; }
+    void setDirectoryJob(const QSharedPointer<DirectoryJob> &job) { record().directoryJob = job; }
     
     // 文本表示
     QString statusText() const;
     QString speedText() const;
     QString timeRemainingText() const;
-    qint64 fileSize() const { return m_totalSize; }
+    qint64 fileSize() const { return record().totalSize; }
+
+    // 从地址中取出文件名，记录创建时不经过外观对象也能使用
+    static QString fileNameFromUrl(const QString &url);
+    static double progressOf(const TaskRecord &record);
+    // 剩余时间的文字，如 "5分钟"
+    static QString durationText(qint64 seconds);
 
 signals:
     void statusChanged(Status status);
@@ -78,20 +101,14 @@ signals:
     void errorOccurred(const QString &error);
 
 private:
-    void generateId();
-    
-    QString m_id;
-    QString m_url;
-    QString m_savePath;
-    QString m_fileName;
-    Status m_status;
-    double m_progress;
-    qint64 m_downloadedSize;
-    qint64 m_totalSize;
+    TaskRecord &record() const { return m_records->record(m_handle); }
+    void updateProgress(double previous);
+
+    TaskRecordStore *m_records;
+    TaskHandle m_handle;
     qint64 m_speed;
-    QString m_errorMessage;
-    bool m_supportsResume;
-    QDateTime m_endTime;
+    double m_etaConfidence;
+    bool m_stalled;
 };
 
 #endif // DOWNLOADTASK_H 
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "logger.h"
+#include "pathutils.h"
 #include <QCoreApplication>
 #include <QDir>
 #include <QDebug>
@@ -11,7 +12,7 @@ Logger::Logger(QObject *parent)
     , m_logLevel(Info)
 {
     // 设置默认日志文件路径
-    QString logPath = QCoreApplication::applicationDirPath() + "/logs";
+    QString logPath = dataDirectory() + "/logs";
     QDir().mkpath(logPath);
     
     QString logFile = logPath + "/downloadassistant.log";
@@ -1,13 +1,16 @@
 #include "mainwindow.h"
 
 #include <QApplication>
+#include "controlserver.h"
 #include "logger.h"
-#include <QSharedMemory>
 #include <QMessageBox>
+#ifdef Q_OS_WIN
 #include <winsock2.h>
+#endif
 
 int main(int argc, char *argv[])
 {
+#ifdef Q_OS_WIN
     WSADATA wsaData;
     int wsaInit = WSAStartup(MAKEWORD(2, 2), &wsaData);
     if (wsaInit != 0) {
@@ -15,12 +18,24 @@ int main(int argc, char *argv[])
                               QString("WSAStartup failed: %1").arg(wsaInit));
         return 1;
     }
+#endif
     QApplication a(argc, argv);
     
-    QSharedMemory sharedMemory("DownloadAssistantSingleInstanceKey");
-    if (!sharedMemory.create(1)) {
-        QMessageBox::warning(nullptr, "提示", "程序已在运行，不允许多开！");
-        return 0;
+    // 在打开任务数据库之前先占用控制接口的服务名，同一时间只有一个实例使用 tasks.db。
+    // 已有实例在运行时，把参数（下载地址，或没有参数时的激活请求）交给它后退出
+    const QStringList requests = ControlServer::requestsFromArguments(a.arguments().mid(1));
+    ControlServer *controlServer = new ControlServer(nullptr);
+    if (!controlServer->listen()) {
+        if (ControlServer::send(requests)) {
+            delete controlServer;
+            return 0;
+        }
+        if (controlServer->otherInstanceRunning()) {
+            QMessageBox::critical(nullptr, "DownloadAssistant", QObject::tr("程序已在运行，但没有响应。"));
+            delete controlServer;
+            return 1;
+        }
+        // 服务名无法使用但也没有其他实例，不提供控制接口继续运行
     }
     
     // 初始化日志系统
@@ -35,14 +50,20 @@ int main(int argc, char *argv[])
     // 设置应用程序图标和样式
     QApplication::setStyle("Fusion");
     
-    MainWindow w;
+    MainWindow w(controlServer);
     w.show();
     
     Logger::instance()->info("主窗口已显示");
 
+    // 首个实例启动时带的地址直接加入队列
+    if (a.arguments().size() > 1)
+        w.controlServer()->execute(requests);
+
     int ret = a.exec();
 
+#ifdef Q_OS_WIN
     WSACleanup();
+#endif
 
     return ret;
 }
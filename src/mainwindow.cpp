@@ -15,7 +15,7 @@
 #include "logger.h"
 #include "tasktablewidget.h"
 #include "filebrowserdialog.h"
-#include "directoryworker.h"
+#include "scanfilter.h"
 #include "pathutils.h"
 #include <QPushButton>
 #include <QTableWidgetItem>
@@ -27,17 +27,33 @@
 #include <QInputDialog>
 #include <QDesktopServices>
 #include <QSpinBox>
+#include <QCheckBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QProgressDialog>
+
+namespace {
+// 历史记录每次加载的条数
+const int kHistoryPageSize = 100;
+// 当前任务表中最多显示的等待任务数，其余只计入状态栏
+const int kVisiblePendingTasks = 500;
+}
 
 
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(ControlServer *controlServer, QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , m_downloadManager(new DownloadManager(this))
-    , m_updateTimer(new QTimer(this))
+    , m_controlServer(controlServer)
     , m_taskModel(new QStandardItemModel(this))
     , m_trayIcon(nullptr)
     , m_trayMenu(nullptr)
     , m_smbCheckThread(nullptr)
+    , m_historyFilterTimer(new QTimer(this))
+    , m_taskReloadTimer(new QTimer(this))
+    , m_importer(new BulkImporter(m_downloadManager, this))
+    , m_historyLoaded{0, 0}
+    , m_totalSpeed(0)
 {
     LOG_INFO("MainWindow 初始化开始");
     
@@ -53,15 +69,19 @@ MainWindow::MainWindow(QWidget *parent)
     // 设置默认保存路径
     ui->savePathEdit->setText(m_downloadManager->getDefaultSavePath());
     
-    // 启动更新定时器
-    m_updateTimer->setInterval(1000); // 每秒更新一次
-    connect(m_updateTimer, &QTimer::timeout, this, &MainWindow::onUpdateTimer);
-    m_updateTimer->start();
-    
     // 加载已保存的任务并刷新表格
     loadTasks();
     updateStatusBar();
 
+    // 本机控制接口：接收其他进程提交的任务，以及再次启动程序时转交的参数
+    connect(m_controlServer, &ControlServer::activationRequested, this, [this]() {
+        showNormal();
+        raise();
+        activateWindow();
+    });
+    m_controlServer->setParent(this);
+    m_controlServer->setManager(m_downloadManager);
+
     // 设置应用程序和窗口图标
     setWindowIcon(QIcon(":/images/icon.png"));
     
@@ -111,8 +131,6 @@ void MainWindow::setupUI()
     ui->completedTable->setTextElideMode(Qt::ElideMiddle);
     ui->completedTable->setWordWrap(false);
     ui->completedTable->horizontalHeader()->setMaximumSectionSize(400);
-    ui->completedTable->setSortingEnabled(true);
-    ui->completedTable->sortByColumn(3, Qt::DescendingOrder);
     // 右键菜单
     ui->completedTable->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(ui->completedTable, &QTableWidget::customContextMenuRequested, this, [this](const QPoint &pos) {
@@ -131,32 +149,11 @@ void MainWindow::setupUI()
                 }
             }
         } else if (act == removeAction) {
-            QList<QTableWidgetItem*> selected = ui->completedTable->selectedItems();
-            QSet<int> rows;
-            for (QTableWidgetItem *item : selected) rows.insert(item->row());
-            QList<int> rowList = rows.values();
-            std::sort(rowList.begin(), rowList.end(), std::greater<int>());
-            // 批量删除选中任务
-            for (int row : rowList) {
-                QTableWidgetItem *item = ui->completedTable->item(row, 0); // 文件名列
-                QTableWidgetItem *pathItem = ui->completedTable->item(row, 1); // 路径列
-                if (item && pathItem) {
-                    QString fileName = item->text();
-                    QString savePath = pathItem->text();
-                    // 遍历所有已完成任务，找到对应的 taskId
-                    QList<DownloadTask*> completedTasks = m_downloadManager->getCompletedTasks();
-                    for (DownloadTask *task : completedTasks) {
-                        if (task->fileName() == fileName && task->savePath() == savePath) {
-                            m_downloadManager->removeTask(task->id());
-                            break;
-                        }
-                    }
-                }
-            }
-            loadTasks();
+            removeSelectedHistory(DownloadManager::CompletedHistory);
         } else if (act == clearAction) {
-            m_downloadManager->removeCompletedTasks();
-            loadTasks();
+            m_downloadManager->clearHistory(DownloadManager::CompletedHistory);
+            reloadHistory(DownloadManager::CompletedHistory);
+            updateStatusBar();
         }
     });
 
@@ -182,35 +179,38 @@ void MainWindow::setupUI()
         QAction *clearAction = menu.addAction(tr("全部清空"));
         QAction *act = menu.exec(ui->failedTable->viewport()->mapToGlobal(pos));
         if (act == removeAction) {
-            QList<QTableWidgetItem*> selected = ui->failedTable->selectedItems();
-            QSet<int> rows;
-            for (QTableWidgetItem *item : selected) rows.insert(item->row());
-            QList<int> rowList = rows.values();
-            std::sort(rowList.begin(), rowList.end(), std::greater<int>());
-            for (int row : rowList) {
-                QTableWidgetItem *nameItem = ui->failedTable->item(row, 0);
-                QTableWidgetItem *pathItem = ui->failedTable->item(row, 1);
-                if (nameItem && pathItem) {
-                    QString fileName = nameItem->text();
-                    QString savePath = pathItem->text();
-                    QList<DownloadTask*> failedTasks = m_downloadManager->getFailedTasks();
-                    for (DownloadTask *task : failedTasks) {
-                        if (task->fileName() == fileName && task->savePath() == savePath) {
-                            m_downloadManager->removeTask(task->id());
-                            break;
-                        }
-                    }
-                }
-            }
-            loadTasks();
+            removeSelectedHistory(DownloadManager::FailedHistory);
         } else if (act == clearAction) {
-            QList<DownloadTask*> failedTasks = m_downloadManager->getFailedTasks();
-            for (DownloadTask *task : failedTasks) {
-                m_downloadManager->removeTask(task->id());
-            }
-            loadTasks();
+            m_downloadManager->clearHistory(DownloadManager::FailedHistory);
+            reloadHistory(DownloadManager::FailedHistory);
+            updateStatusBar();
         }
     });
+
+    m_taskReloadTimer->setSingleShot(true);
+    m_taskReloadTimer->setInterval(200);
+    connect(m_taskReloadTimer, &QTimer::timeout, this, [this]() {
+        loadTasks();
+        updateStatusBar();
+    });
+
+    // 历史记录分页加载，筛选输入停顿后再查询
+    m_historyFilterTimer->setSingleShot(true);
+    m_historyFilterTimer->setInterval(300);
+    connect(m_historyFilterTimer, &QTimer::timeout, this, [this]() {
+        m_historyLoaded[DownloadManager::CompletedHistory] = 0;
+        m_historyLoaded[DownloadManager::FailedHistory] = 0;
+        reloadHistory(DownloadManager::CompletedHistory);
+        reloadHistory(DownloadManager::FailedHistory);
+    });
+    connect(ui->completedFilterEdit, &QLineEdit::textChanged, m_historyFilterTimer, qOverload<>(&QTimer::start));
+    connect(ui->failedFilterEdit, &QLineEdit::textChanged, m_historyFilterTimer, qOverload<>(&QTimer::start));
+    connect(ui->completedMoreButton, &QPushButton::clicked, this, [this]() {
+        loadHistoryPage(DownloadManager::CompletedHistory);
+    });
+    connect(ui->failedMoreButton, &QPushButton::clicked, this, [this]() {
+        loadHistoryPage(DownloadManager::FailedHistory);
+    });
 }
 
 void MainWindow::setupConnections()
@@ -220,9 +220,11 @@ void MainWindow::setupConnections()
     connect(ui->startAllButton, &QPushButton::clicked, this, &MainWindow::onStartAllClicked);
     connect(ui->pauseAllButton, &QPushButton::clicked, this, &MainWindow::onPauseAllClicked);
     connect(ui->browseSmbButton, &QPushButton::clicked, this, &MainWindow::onBrowseSmbButtonClicked);
+    connect(ui->importListButton, &QPushButton::clicked, this, &MainWindow::onImportListClicked);
     
     // 连接下载管理器信号
     connect(m_downloadManager, &DownloadManager::taskAdded, this, &MainWindow::onTaskAdded);
+    connect(m_downloadManager, &DownloadManager::tasksAdded, this, &MainWindow::onTasksAdded);
     connect(m_downloadManager, &DownloadManager::taskRemoved, this, &MainWindow::onTaskRemoved);
     connect(m_downloadManager, &DownloadManager::taskStarted, this, &MainWindow::onTaskStarted);
     connect(m_downloadManager, &DownloadManager::taskPaused, this, &MainWindow::onTaskPaused);
@@ -231,8 +233,15 @@ void MainWindow::setupConnections()
     connect(m_downloadManager, &DownloadManager::taskCompleted, this, &MainWindow::onTaskCompleted);
     connect(m_downloadManager, &DownloadManager::taskFailed, this, &MainWindow::onTaskFailed);
     connect(m_downloadManager, &DownloadManager::allTasksCompleted, this, &MainWindow::onAllTasksCompleted);
-    connect(m_downloadManager, &DownloadManager::taskProgress,
-            this, &MainWindow::onTaskProgress);
+    connect(m_downloadManager, &DownloadManager::progressSnapshot,
+            this, &MainWindow::onProgressSnapshot);
+    connect(m_downloadManager, &DownloadManager::syncFinished, this, &MainWindow::onSyncFinished);
+    connect(m_downloadManager, &DownloadManager::concurrencyChanged, this, &MainWindow::updateStatusBar);
+    connect(m_downloadManager, &DownloadManager::scheduleProfileChanged, this, &MainWindow::updateStatusBar);
+    connect(ui->mirrorCheckBox, &QCheckBox::toggled, ui->deleteRemovedCheckBox, &QWidget::setEnabled);
+    connect(ui->mirrorCheckBox, &QCheckBox::toggled, ui->syncIntervalSpinBox, &QWidget::setEnabled);
+    ui->deleteRemovedCheckBox->setEnabled(false);
+    ui->syncIntervalSpinBox->setEnabled(false);
 
     // 连接 TaskTableWidget 的操作信号到 DownloadManager
     connect(ui->taskTable, &TaskTableWidget::startTaskRequested, this, [this](DownloadTask *task) {
@@ -277,14 +286,21 @@ void MainWindow::onPauseAllClicked()
 
 void MainWindow::onTaskAdded(const QString &taskId)
 {
-    DownloadTask *task = m_downloadManager->getTask(taskId);
-    if (task) {
+    // 只读取记录，批量添加时不为每个任务创建外观对象
+    if (m_downloadManager->taskRecord(taskId)) {
         // ui->taskTable->addTask(task); // 已注释
         updateStatusBar();
         LOG_INFO(QString("任务已添加到界面 - ID: %1").arg(taskId));
     }
 }
 
+void MainWindow::onTasksAdded(int count)
+{
+    // 导入时每批都会触发，短时间内的多次刷新合并为一次
+    LOG_DEBUG(QString("批量任务已添加到界面 - 数量: %1").arg(count));
+    m_taskReloadTimer->start();
+}
+
 void MainWindow::onTaskRemoved(const QString &taskId)
 {
     // 通过 taskId 查找并删除对应的行
@@ -368,32 +384,42 @@ void MainWindow::onAllTasksCompleted()
     showInfo(tr("所有下载任务已完成"));
 }
 
-void MainWindow::onUpdateTimer()
-{
-    // 更新所有任务的行
-    for (int row = 0; row < ui->taskTable->rowCount(); ++row) {
-        QTableWidgetItem *item = ui->taskTable->item(row, 0);
-        if (item) {
-            DownloadTask *task = static_cast<DownloadTask*>(item->data(Qt::UserRole).value<void*>());
-            if (task) {
-                ui->taskTable->updateTask(task);
-            }
-        }
-    }
-}
-
 void MainWindow::updateStatusBar()
 {
-    QList<DownloadTask*> allTasks = m_downloadManager->getAllTasks();
-    QList<DownloadTask*> activeTasks = m_downloadManager->getActiveTasks();
-    QList<DownloadTask*> completedTasks = m_downloadManager->getCompletedTasks();
-    QList<DownloadTask*> failedTasks = m_downloadManager->getFailedTasks();
+    // 计数都由下载管理器即时维护，这里不遍历任务列表
+    int activeCount = m_downloadManager->taskCount(DownloadTask::Downloading)
+                      + m_downloadManager->taskCount(DownloadTask::Paused);
+    int completedCount = m_downloadManager->historyCount(DownloadManager::CompletedHistory);
+    int failedCount = m_downloadManager->historyCount(DownloadManager::FailedHistory);
 
     QString status = tr("总任务：%1 | 活动：%2 | 已完成：%3 | 失败：%4")
-                    .arg(allTasks.size())
-                    .arg(activeTasks.size())
-                    .arg(completedTasks.size())
-                    .arg(failedTasks.size());
+                    .arg(m_downloadManager->taskCount() + completedCount + failedCount)
+                    .arg(activeCount)
+                    .arg(completedCount)
+                    .arg(failedCount);
+    if (m_downloadManager->taskCount(DownloadTask::Downloading) > 0) {
+        status += tr(" | 速度：%1/s").arg(formatBytes(m_totalSpeed));
+        if (!m_queueEta.isEmpty())
+            status += tr(" | 剩余：%1").arg(m_queueEta);
+    }
+
+    // 各服务器自动调整的并发上限，调整原因放在提示中
+    QStringList limits;
+    QStringList reasons;
+    const QList<ConcurrencyController::ServerState> servers = m_downloadManager->concurrencyState();
+    for (const ConcurrencyController::ServerState &server : servers) {
+        if (server.active == 0)
+            continue;
+        QString name = server.server.isEmpty() ? tr("本地") : server.server;
+        limits.append(QString("%1 %2/%3").arg(name).arg(server.active).arg(server.limit));
+        reasons.append(QString("%1：%2").arg(name).arg(server.reason));
+    }
+    if (!limits.isEmpty())
+        status += tr(" | 并发：%1").arg(limits.join(", "));
+    QString profile = m_downloadManager->activeProfileName();
+    if (!profile.isEmpty())
+        status += tr(" | 时段：%1").arg(profile);
+    statusBar()->setToolTip(reasons.join('\n'));
     
     statusBar()->showMessage(status);
 }
@@ -481,7 +507,10 @@ void MainWindow::onDownloadDirectoryClicked(const QString &dirUrl)
     if (savePath.isEmpty())
         savePath = m_downloadManager->getDefaultSavePath();
 
-    savePath = buildFinalSavePath(savePath);
+    // 镜像同步每次写入同一个目录，不再按日期分目录
+    bool mirror = ui->mirrorCheckBox->isChecked();
+    if (!mirror)
+        savePath = buildFinalSavePath(savePath);
 
     QString dirName = QFileInfo(toUncPath(dirUrl)).fileName();
     if (dirName.isEmpty()) {
@@ -491,95 +520,139 @@ void MainWindow::onDownloadDirectoryClicked(const QString &dirUrl)
         dirName = QFileInfo(path).fileName();
     }
 
+    QString filterError;
+    ScanFilter::fromString(ui->filterEdit->text(), &filterError);
+    if (!filterError.isEmpty()) {
+        showWarning(tr("过滤规则无效：%1").arg(filterError));
+        return;
+    }
+
+    // 整个目录作为一个任务下载，子文件在后台扫描时逐步加入
     QString localPath = QDir(savePath).filePath(dirName);
-    DirectoryWorker *worker = new DirectoryWorker(dirUrl, localPath, m_downloadManager, this);
-    connect(worker, &DirectoryWorker::finished, this, [this, worker]() {
-        worker->deleteLater();
-        loadTasks();
-        updateStatusBar();
-        showInfo(tr("已添加下载任务"));
-    });
-    worker->start();
+    if (mirror) {
+        QString syncId = m_downloadManager->addSyncJob(dirUrl, localPath,
+                                                       ui->filterEdit->text().trimmed(),
+                                                       ui->deleteRemovedCheckBox->isChecked(),
+                                                       ui->syncIntervalSpinBox->value());
+        m_downloadManager->runSyncJob(syncId);
+        return;
+    }
+
+    QString taskId = m_downloadManager->addDirectoryTask(dirUrl, localPath,
+                                                         ui->filterEdit->text().trimmed());
+    m_downloadManager->startTask(taskId);
+}
+
+void MainWindow::onSyncFinished(const QString &syncId, const QString &summary)
+{
+    QString title = tr("镜像同步完成");
+    for (const DownloadManager::SyncJob &job : m_downloadManager->syncJobs()) {
+        if (job.id == syncId) {
+            title = tr("镜像同步完成：%1").arg(QDir::toNativeSeparators(job.localPath));
+            break;
+        }
+    }
+
+    if (m_trayIcon && m_trayIcon->isVisible())
+        m_trayIcon->showMessage(title, summary, QSystemTrayIcon::Information, 5000);
+    else
+        statusBar()->showMessage(title + " - " + summary, 10000);
+    loadTasks();
+    updateStatusBar();
 }
 
 void MainWindow::loadTasks()
 {
-    // 从下载管理器获取所有已加载的任务并插入到表格中
+    // 当前任务来自内存工作集，已完成和失败的任务按页从数据库读取
     LOG_INFO("加载任务到界面");
-    QList<DownloadTask*> allTasks = m_downloadManager->getAllTasks();
 
-    // Temporarily disable sorting to avoid row reordering while inserting items
-    bool completedSortingEnabled = ui->completedTable->isSortingEnabled();
-    int completedSortColumn = ui->completedTable->horizontalHeader()->sortIndicatorSection();
-    Qt::SortOrder completedSortOrder = ui->completedTable->horizontalHeader()->sortIndicatorOrder();
-    ui->completedTable->setSortingEnabled(false);
+    ui->taskTable->setRowCount(0);
+    const QList<DownloadTask*> activeTasks = m_downloadManager->getVisibleTasks(kVisiblePendingTasks);
+    for (DownloadTask *task : activeTasks)
+        ui->taskTable->addTask(task);
 
-    bool failedSortingEnabled = ui->failedTable->isSortingEnabled();
-    int failedSortColumn = ui->failedTable->horizontalHeader()->sortIndicatorSection();
-    Qt::SortOrder failedSortOrder = ui->failedTable->horizontalHeader()->sortIndicatorOrder();
-    ui->failedTable->setSortingEnabled(false);
+    reloadHistory(DownloadManager::CompletedHistory);
+    reloadHistory(DownloadManager::FailedHistory);
 
-    ui->taskTable->setRowCount(0);
-    ui->completedTable->setRowCount(0);
-    ui->failedTable->setRowCount(0);
-
-    QList<DownloadTask*> completed;
-    QList<DownloadTask*> failed;
-    QList<DownloadTask*> active;
-
-    for (DownloadTask *task : allTasks) {
-        LOG_INFO(QString("遍历任务 - ID: %1, 状态: %2").arg(task->id()).arg(task->status()));
-        if (task->status() == DownloadTask::Completed) {
-            completed.append(task);
-        } else if (task->status() == DownloadTask::Failed || task->status() == DownloadTask::Cancelled) {
-            failed.append(task);
-        } else {
-            active.append(task);
-        }
-    }
+    updateStatusBar();
+}
 
-    std::sort(completed.begin(), completed.end(), [](DownloadTask *a, DownloadTask *b) {
-        return a->endTime() < b->endTime();
-    });
+QTableWidget *MainWindow::historyTable(DownloadManager::HistoryKind kind) const
+{
+    return kind == DownloadManager::CompletedHistory ? ui->completedTable : ui->failedTable;
+}
 
-    for (DownloadTask *task : completed) {
-        int row = ui->completedTable->rowCount();
-        ui->completedTable->insertRow(row);
-        QTableWidgetItem *nameItem = new QTableWidgetItem(task->fileName());
-        nameItem->setToolTip(task->fileName());
-        ui->completedTable->setItem(row, 0, nameItem);
-        ui->completedTable->setItem(row, 1, new QTableWidgetItem(task->savePath()));
-        ui->completedTable->setItem(row, 2, new QTableWidgetItem(formatBytes(task->downloadedSize())));
-        ui->completedTable->setItem(row, 3, new QTableWidgetItem(task->endTime().toString("yyyy-MM-dd HH:mm:ss")));
-        LOG_INFO(QString("已插入到已完成任务表格 - ID: %1, 行: %2, 完成时间: %3")
-                 .arg(task->id()).arg(row).arg(task->endTime().toString(Qt::ISODate)));
-    }
-
-    for (DownloadTask *task : failed) {
-        int row = ui->failedTable->rowCount();
-        ui->failedTable->insertRow(row);
-        QTableWidgetItem *nameItem = new QTableWidgetItem(task->fileName());
-        nameItem->setToolTip(task->fileName());
-        ui->failedTable->setItem(row, 0, nameItem);
-        ui->failedTable->setItem(row, 1, new QTableWidgetItem(task->savePath()));
-        QString reason = task->status() == DownloadTask::Cancelled ? tr("用户取消") : task->errorMessage();
-        ui->failedTable->setItem(row, 2, new QTableWidgetItem(reason));
-        LOG_INFO(QString("已插入到失败任务表格 - ID: %1, 行: %2").arg(task->id()).arg(row));
-    }
-
-    for (DownloadTask *task : active) {
-        ui->taskTable->addTask(task);
-        LOG_INFO(QString("已插入到当前任务表格 - ID: %1").arg(task->id()));
-    }
-    // Restore sorting state for completed and failed tables
-    ui->completedTable->setSortingEnabled(completedSortingEnabled);
-    if (completedSortingEnabled)
-        ui->completedTable->sortByColumn(completedSortColumn, completedSortOrder);
+QString MainWindow::historyFilter(DownloadManager::HistoryKind kind) const
+{
+    return kind == DownloadManager::CompletedHistory ? ui->completedFilterEdit->text()
+                                                     : ui->failedFilterEdit->text();
+}
+
+void MainWindow::reloadHistory(DownloadManager::HistoryKind kind)
+{
+    // 保持已展开的页数，刷新时不丢失用户已加载的记录
+    int limit = qMax(kHistoryPageSize, m_historyLoaded[kind]);
+    historyTable(kind)->setRowCount(0);
+    m_historyLoaded[kind] = 0;
+    appendHistory(kind, limit);
+}
+
+void MainWindow::loadHistoryPage(DownloadManager::HistoryKind kind)
+{
+    appendHistory(kind, kHistoryPageSize);
+}
 
-    ui->failedTable->setSortingEnabled(failedSortingEnabled);
-    if (failedSortingEnabled)
-        ui->failedTable->sortByColumn(failedSortColumn, failedSortOrder);
+void MainWindow::appendHistory(DownloadManager::HistoryKind kind, int limit)
+{
+    QTableWidget *table = historyTable(kind);
+    QString filter = historyFilter(kind);
+    const QList<DownloadManager::HistoryRecord> records =
+        m_downloadManager->queryHistory(kind, filter, m_historyLoaded[kind], limit);
 
+    table->setUpdatesEnabled(false);
+    for (const DownloadManager::HistoryRecord &record : records) {
+        int row = table->rowCount();
+        table->insertRow(row);
+        QTableWidgetItem *nameItem = new QTableWidgetItem(record.fileName);
+        nameItem->setToolTip(record.fileName);
+        nameItem->setData(Qt::UserRole, record.id);
+        table->setItem(row, 0, nameItem);
+        table->setItem(row, 1, new QTableWidgetItem(record.savePath));
+        if (kind == DownloadManager::CompletedHistory) {
+            table->setItem(row, 2, new QTableWidgetItem(formatBytes(record.size)));
+            table->setItem(row, 3, new QTableWidgetItem(record.endTime.toString("yyyy-MM-dd HH:mm:ss")));
+        } else {
+            QString reason = record.status == DownloadTask::Cancelled ? tr("用户取消") : record.errorMessage;
+            table->setItem(row, 2, new QTableWidgetItem(reason));
+        }
+    }
+    table->setUpdatesEnabled(true);
+    m_historyLoaded[kind] += records.size();
+
+    int total = m_downloadManager->historyCount(kind, filter);
+    QLabel *countLabel = kind == DownloadManager::CompletedHistory ? ui->completedCountLabel
+                                                                   : ui->failedCountLabel;
+    QPushButton *moreButton = kind == DownloadManager::CompletedHistory ? ui->completedMoreButton
+                                                                        : ui->failedMoreButton;
+    countLabel->setText(tr("已显示 %1 / %2 条").arg(m_historyLoaded[kind]).arg(total));
+    moreButton->setEnabled(m_historyLoaded[kind] < total);
+}
+
+void MainWindow::removeSelectedHistory(DownloadManager::HistoryKind kind)
+{
+    QTableWidget *table = historyTable(kind);
+    QSet<int> rows;
+    const QList<QTableWidgetItem*> selected = table->selectedItems();
+    for (QTableWidgetItem *item : selected)
+        rows.insert(item->row());
+
+    // 批量删除选中任务
+    for (int row : rows) {
+        QTableWidgetItem *item = table->item(row, 0);
+        if (item)
+            m_downloadManager->removeTask(item->data(Qt::UserRole).toString());
+    }
+    reloadHistory(kind);
     updateStatusBar();
 }
 
@@ -589,6 +662,8 @@ void MainWindow::createTrayMenu()
     m_trayMenu = new QMenu(this);
     QAction *showAction = m_trayMenu->addAction(tr("显示窗口"));
     connect(showAction, &QAction::triggered, this, &QWidget::showNormal);
+    QAction *syncAction = m_trayMenu->addAction(tr("立即同步全部"));
+    connect(syncAction, &QAction::triggered, m_downloadManager, &DownloadManager::runAllSyncJobs);
     QAction *quitAction = m_trayMenu->addAction(tr("退出"));
     connect(quitAction, &QAction::triggered, qApp, &QApplication::quit);
 }
@@ -685,15 +760,18 @@ void MainWindow::onSmbPathCheckFinished(bool exists, const QString &uncPath)
         savePath = m_downloadManager->getDefaultSavePath();
     savePath = buildFinalSavePath(savePath);
 
+    // 文件任务一次性加入，只写一次数据库
+    QStringList files;
     for (const QString &p : paths) {
         QFileInfo info(p);
-        if (info.isDir()) {
+        if (info.isDir())
             onDownloadDirectoryClicked(p);
-        } else {
-            QString taskId = m_downloadManager->addTask(p, savePath);
-            m_downloadManager->startTask(taskId);
-        }
+        else
+            files.append(p);
     }
+    const QStringList taskIds = m_downloadManager->addTasks(files, savePath);
+    for (const QString &taskId : taskIds)
+        m_downloadManager->startTask(taskId);
 
     loadTasks();
     updateStatusBar();
@@ -701,11 +779,84 @@ void MainWindow::onSmbPathCheckFinished(bool exists, const QString &uncPath)
 }
 
 
-void MainWindow::onTaskProgress(const QString &taskId, qint64 bytesReceived, qint64 bytesTotal)
+void MainWindow::onImportListClicked()
 {
-    DownloadTask *task = m_downloadManager->getTask(taskId);
-    if (task) {
-        ui->taskTable->updateTask(task);
+    if (m_importer->isRunning())
+        return;
+
+    QString listPath = QFileDialog::getOpenFileName(this, tr("选择下载列表"), QString(),
+                                                    tr("文本文件 (*.txt *.lst *.tsv);;所有文件 (*)"));
+    if (listPath.isEmpty())
+        return;
+
+    QString savePath = ui->savePathEdit->text().trimmed();
+    m_importer->setDefaultSavePath(savePath.isEmpty() ? m_downloadManager->getDefaultSavePath() : savePath);
+    m_importer->setStartTasks(false);
+    m_importer->setRejectFile(listPath + ".rejected.txt");
+    if (!m_importer->start(listPath)) {
+        showError(tr("无法打开列表文件：%1").arg(listPath));
+        return;
+    }
+
+    // 进度按已读字节的千分比显示，列表可能超过 int 范围
+    QProgressDialog *progress = new QProgressDialog(tr("正在导入下载列表..."), tr("取消"), 0, 1000, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(500);
+    progress->setAttribute(Qt::WA_DeleteOnClose);
+    connect(progress, &QProgressDialog::canceled, m_importer, &BulkImporter::cancel);
+    connect(m_importer, &BulkImporter::progress, progress,
+            [progress](qint64 bytesRead, qint64 bytesTotal, int accepted, int rejected) {
+        progress->setValue(bytesTotal > 0 ? static_cast<int>(bytesRead * 1000 / bytesTotal) : 0);
+        progress->setLabelText(tr("正在导入下载列表... 已加入 %1，拒绝 %2").arg(accepted).arg(rejected));
+    });
+
+    connect(m_importer, &BulkImporter::finished, this,
+            [this, progress, listPath](const BulkImporter::Summary &summary) {
+        disconnect(m_importer, &BulkImporter::progress, progress, nullptr);
+        progress->close();
+
+        loadTasks();
         updateStatusBar();
+
+        if (!summary.error.isEmpty()) {
+            showError(tr("读取列表失败：%1").arg(summary.error));
+            return;
+        }
+        QString message = tr("%1：已加入 %2 个任务，重复 %3 个，拒绝 %4 行")
+                              .arg(summary.cancelled ? tr("导入已取消") : tr("导入完成"))
+                              .arg(summary.accepted).arg(summary.duplicates).arg(summary.rejected);
+        if (summary.rejected > 0) {
+            message += tr("\n\n%1\n\n全部被拒绝的行已写入：%2")
+                           .arg(summary.rejectedSamples.join('\n'))
+                           .arg(QDir::toNativeSeparators(listPath + ".rejected.txt"));
+            showWarning(message);
+        } else {
+            showInfo(message);
+        }
+    }, Qt::SingleShotConnection);
+}
+
+void MainWindow::onProgressSnapshot(const DownloadManager::ProgressSnapshot &snapshot)
+{
+    // 每个快照只遍历一次表格，刷新有变化的行
+    QSet<DownloadTask*> changed;
+    for (const DownloadManager::TaskProgress &progress : snapshot.tasks) {
+        DownloadTask *task = m_downloadManager->getTask(progress.taskId);
+        if (task)
+            changed.insert(task);
     }
+    ui->taskTable->updateTasks(changed);
+
+    m_totalSpeed = snapshot.speed;
+    if (snapshot.stalled) {
+        m_queueEta = tr("停滞");
+    } else if (snapshot.secondsRemaining < 0) {
+        m_queueEta.clear();
+    } else {
+        // 有大小未知的任务时只是下限，速率波动大时只是粗略估计
+        QString prefix = !snapshot.queueRemainingExact ? tr("至少")
+                         : snapshot.confidence < 0.5 ? tr("约") : QString();
+        m_queueEta = prefix + DownloadTask::durationText(snapshot.secondsRemaining);
+    }
+    updateStatusBar();
 }
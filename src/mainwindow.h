@@ -6,6 +6,8 @@
 #include <QTimer>
 #include <QSystemTrayIcon>
 #include <QMenu>
+#include "bulkimporter.h"
+#include "controlserver.h"
 #include "downloadmanager.h"
 #include "tasktablewidget.h"
 #include "smbpathchecker.h"
@@ -20,16 +22,22 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    // controlServer 已由 main 占用服务名，窗口接管它并在加载任务后开始处理请求
+    MainWindow(ControlServer *controlServer, QWidget *parent = nullptr);
     ~MainWindow();
 
+    // 其他进程提交任务的本机控制接口
+    ControlServer *controlServer() const { return m_controlServer; }
+
 private slots:
     // UI 事件处理
     void onBrowseClicked();
     void onBrowseSmbButtonClicked();
+    void onImportListClicked();
     
     // 下载管理器事件
     void onTaskAdded(const QString &taskId);
+    void onTasksAdded(int count);
     void onTaskRemoved(const QString &taskId);
     void onTaskStarted(const QString &taskId);
     void onTaskPaused(const QString &taskId);
@@ -37,14 +45,13 @@ private slots:
     void onTaskCancelled(const QString &taskId);
     void onTaskCompleted(const QString &taskId);
     void onTaskFailed(const QString &taskId, const QString &error);
-    void onTaskProgress(const QString &taskId, qint64 bytesReceived, qint64 bytesTotal);
+    void onProgressSnapshot(const DownloadManager::ProgressSnapshot &snapshot);
     
-    // 定时器事件
-    void onUpdateTimer();
     void onTrayIconActivated(QSystemTrayIcon::ActivationReason reason);
     void onDownloadFileClicked(const QString &fileName);
     void onDownloadDirectoryClicked(const QString &dirUrl);
     void onSmbPathCheckFinished(bool exists, const QString &uncPath);
+    void onSyncFinished(const QString &syncId, const QString &summary);
 
 private:
     // UI 组件
@@ -52,18 +59,32 @@ private:
     
     // 核心组件
     DownloadManager *m_downloadManager;
+    ControlServer *m_controlServer;
     QStandardItemModel *m_taskModel;
-    QTimer *m_updateTimer;
     QSystemTrayIcon *m_trayIcon;
     QMenu *m_trayMenu;
     QThread *m_smbCheckThread;
     QString m_lastSmbUrl;
+    QTimer *m_historyFilterTimer;
+    QTimer *m_taskReloadTimer;  // 合并批量添加后的表格刷新
+    BulkImporter *m_importer;
+    int m_historyLoaded[2];     // 每种历史记录已加载到表格的条数
+    qint64 m_totalSpeed;        // 最近一次进度快照中的合计速度
+    QString m_queueEta;         // 最近一次进度快照中全部任务的剩余时间
     
     // 辅助方法
     void setupUI();
     void setupConnections();
     void loadTasks();
     void updateStatusBar();
+
+    // 历史记录分页
+    QTableWidget *historyTable(DownloadManager::HistoryKind kind) const;
+    QString historyFilter(DownloadManager::HistoryKind kind) const;
+    void reloadHistory(DownloadManager::HistoryKind kind);
+    void loadHistoryPage(DownloadManager::HistoryKind kind);
+    void appendHistory(DownloadManager::HistoryKind kind, int limit);
+    void removeSelectedHistory(DownloadManager::HistoryKind kind);
     void onStartAllClicked();
     void onPauseAllClicked();
     void onAllTasksCompleted();
@@ -0,0 +1,215 @@
+#include "metricsexporter.h"
+#include "bandwidthlimiter.h"
+#include "logger.h"
+#include "transfermetrics.h"
+#include <QHostAddress>
+#include <QSaveFile>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+namespace {
+
+const char *const kPrefix = "downloadassistant_";
+// 请求头超过这个长度仍未结束时直接断开
+const int kMaxRequestBytes = 8192;
+
+QString escapeLabel(QString value)
+{
+    value.replace('\\', QLatin1String("\\\\"));
+    value.replace('"', QLatin1String("\\\""));
+    value.replace('\n', QLatin1String("\\n"));
+    return value;
+}
+
+// 按名称输出一组同类指标，labels 为空时输出不带标签的一行
+class MetricWriter
+{
+public:
+    explicit MetricWriter(QStringList *lines) : m_lines(lines) {}
+
+    void declare(const QString &name, const QString &type, const QString &help)
+    {
+        m_name = QLatin1String(kPrefix) + name;
+        *m_lines << QString("# HELP %1 %2").arg(m_name, help)
+                 << QString("# TYPE %1 %2").arg(m_name, type);
+    }
+
+    void sample(qint64 value, const QString &labels = QString())
+    {
+        if (labels.isEmpty())
+            *m_lines << QString("%1 %2").arg(m_name).arg(value);
+        else
+            *m_lines << QString("%1{%2} %3").arg(m_name, labels).arg(value);
+    }
+
+private:
+    QStringList *m_lines;
+    QString m_name;
+};
+
+} // namespace
+
+MetricsExporter::MetricsExporter(DownloadManager *manager, QObject *parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_server(new QTcpServer(this))
+    , m_fileTimer(new QTimer(this))
+    , m_speed(0)
+    , m_averageSpeed(0)
+    , m_stalled(false)
+    , m_queueRemaining(0)
+    , m_secondsRemaining(-1)
+{
+    connect(m_manager, &DownloadManager::progressSnapshot, this, &MetricsExporter::onProgressSnapshot);
+    connect(m_fileTimer, &QTimer::timeout, this, &MetricsExporter::writeNow);
+    connect(m_server, &QTcpServer::newConnection, this, &MetricsExporter::onNewConnection);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    m_server->close();
+}
+
+void MetricsExporter::writeFile(const QString &path, int intervalMs)
+{
+    m_path = path;
+    m_fileTimer->setInterval(qMax(1000, intervalMs));
+    m_fileTimer->start();
+    writeNow();
+    LOG_INFO(QString("指标文件 - %1，每 %2 秒写入").arg(path).arg(m_fileTimer->interval() / 1000));
+}
+
+bool MetricsExporter::listen(quint16 port)
+{
+    if (!m_server->listen(QHostAddress::LocalHost, port)) {
+        LOG_WARNING(QString("指标接口启动失败 - 端口 %1: %2").arg(port).arg(m_server->errorString()));
+        return false;
+    }
+    LOG_INFO(QString("指标接口已启动 - http://127.0.0.1:%1/metrics").arg(m_server->serverPort()));
+    return true;
+}
+
+QString MetricsExporter::errorString() const
+{
+    return m_server->errorString();
+}
+
+void MetricsExporter::onProgressSnapshot(const DownloadManager::ProgressSnapshot &snapshot)
+{
+    m_speed = snapshot.speed;
+    m_averageSpeed = snapshot.averageSpeed;
+    m_stalled = snapshot.stalled;
+    m_queueRemaining = snapshot.queueRemaining;
+    m_secondsRemaining = snapshot.secondsRemaining;
+}
+
+QString MetricsExporter::metricsText() const
+{
+    QStringList lines;
+    MetricWriter metric(&lines);
+
+    metric.declare("queue_tasks", "gauge", "Unfinished tasks by status.");
+    const QList<QPair<DownloadTask::Status, QString>> statuses = {
+        {DownloadTask::Pending, "pending"},
+        {DownloadTask::Queued, "queued"},
+        {DownloadTask::Downloading, "downloading"},
+        {DownloadTask::Paused, "paused"},
+    };
+    for (const auto &status : statuses)
+        metric.sample(m_manager->taskCount(status.first), QString("status=\"%1\"").arg(status.second));
+
+    metric.declare("history_tasks", "gauge", "Finished tasks kept in history.");
+    metric.sample(m_manager->historyCount(DownloadManager::CompletedHistory), "result=\"completed\"");
+    metric.sample(m_manager->historyCount(DownloadManager::FailedHistory), "result=\"failed\"");
+
+    // 只有本次运行中出现过的服务器，本地路径的服务器名为空
+    const QList<ConcurrencyController::ServerState> servers = m_manager->concurrencyState();
+    auto serverLabel = [](const ConcurrencyController::ServerState &server) {
+        return QString("server=\"%1\"").arg(escapeLabel(server.server));
+    };
+    metric.declare("server_bytes_total", "counter", "Bytes received per server.");
+    for (const ConcurrencyController::ServerState &server : servers)
+        metric.sample(server.bytesTransferred, serverLabel(server));
+    metric.declare("server_active_transfers", "gauge", "Transfers running per server.");
+    for (const ConcurrencyController::ServerState &server : servers)
+        metric.sample(server.active, serverLabel(server));
+    metric.declare("server_concurrency_limit", "gauge", "Auto-tuned concurrent transfer limit per server.");
+    for (const ConcurrencyController::ServerState &server : servers)
+        metric.sample(server.limit, serverLabel(server));
+    metric.declare("server_throughput_bytes_per_second", "gauge", "Throughput per server in the last sample period.");
+    for (const ConcurrencyController::ServerState &server : servers)
+        metric.sample(server.throughput, serverLabel(server));
+
+    // 只导出下载中的任务，避免标签随队列长度无限增长
+    const QList<DownloadManager::TaskProgress> transfers = m_manager->activeTransfers();
+    metric.declare("task_received_bytes", "gauge", "Bytes received by each downloading task.");
+    for (const DownloadManager::TaskProgress &transfer : transfers)
+        metric.sample(transfer.bytesReceived, QString("task=\"%1\"").arg(transfer.taskId));
+    metric.declare("task_size_bytes", "gauge", "Total size of each downloading task, 0 when unknown.");
+    for (const DownloadManager::TaskProgress &transfer : transfers)
+        metric.sample(transfer.bytesTotal, QString("task=\"%1\"").arg(transfer.taskId));
+
+    metric.declare("throughput_bytes_per_second", "gauge", "Aggregate throughput over the estimation window.");
+    metric.sample(m_speed);
+    metric.declare("average_throughput_bytes_per_second", "gauge", "Aggregate throughput since downloads became active.");
+    metric.sample(m_averageSpeed);
+    metric.declare("stalled", "gauge", "1 when downloads are active but made no progress recently.");
+    metric.sample(m_stalled ? 1 : 0);
+    metric.declare("queue_remaining_bytes", "gauge", "Bytes left in unfinished tasks of known size.");
+    metric.sample(m_queueRemaining);
+    metric.declare("queue_eta_seconds", "gauge", "Estimated time to finish the queue, -1 when unknown.");
+    metric.sample(m_secondsRemaining);
+    metric.declare("bandwidth_limit_bytes_per_second", "gauge", "Active bandwidth cap, 0 when unlimited.");
+    metric.sample(bandwidthLimit());
+
+    return lines.join('\n') + '\n' + transferMetricsText(QLatin1String(kPrefix));
+}
+
+void MetricsExporter::writeNow()
+{
+    if (m_path.isEmpty())
+        return;
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        LOG_WARNING(QString("无法写入指标文件 - %1: %2").arg(m_path).arg(file.errorString()));
+        return;
+    }
+    file.write(metricsText().toUtf8());
+    if (!file.commit())
+        LOG_WARNING(QString("无法写入指标文件 - %1: %2").arg(m_path).arg(file.errorString()));
+}
+
+void MetricsExporter::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            // 只需要请求行，读到请求头结束再应答
+            if (socket->property("answered").toBool())
+                return;
+            QByteArray request = socket->property("request").toByteArray() + socket->readAll();
+            if (!request.contains("\r\n\r\n")) {
+                if (request.size() > kMaxRequestBytes)
+                    socket->abort();
+                else
+                    socket->setProperty("request", request);
+                return;
+            }
+            socket->setProperty("answered", true);
+
+            QByteArray status = "200 OK";
+            QByteArray body;
+            if (!request.startsWith("GET ")) {
+                status = "405 Method Not Allowed";
+            } else {
+                body = metricsText().toUtf8();
+            }
+            socket->write("HTTP/1.0 " + status + "\r\n"
+                          "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n" + body);
+            socket->disconnectFromHost();
+        });
+    }
+}
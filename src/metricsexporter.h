@@ -0,0 +1,55 @@
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+#include <QObject>
+#include <QString>
+#include "downloadmanager.h"
+
+class QTcpServer;
+class QTimer;
+
+// 以 Prometheus 文本格式导出运行指标，无人值守运行时供监控系统采集：
+// 传输引擎的字节数、各操作的延迟直方图和错误次数、停滞次数、工作线程和缓冲区占用
+// （见 transfermetrics.h），以及队列深度、各服务器的字节数和并发、下载中任务的进度、
+// 合计吞吐和队列剩余时间。
+// 可以定期写入文件（供 node_exporter 的 textfile 收集器读取），也可以在本机回环地址上
+// 提供 HTTP 接口。指标只在导出时汇总，不增加传输路径上的开销。
+class MetricsExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsExporter(DownloadManager *manager, QObject *parent = nullptr);
+    ~MetricsExporter();
+
+    // 每隔 intervalMs 写入一次 path，先写临时文件再替换，读取方不会读到写了一半的文件
+    void writeFile(const QString &path, int intervalMs = 15000);
+    // 只在 127.0.0.1 上监听，对 GET 请求应答全部指标；端口被占用时返回 false
+    bool listen(quint16 port);
+    QString errorString() const;
+
+    QString metricsText() const;
+
+public slots:
+    // 立即写入一次指标文件，例如退出前；没有设置文件时什么也不做
+    void writeNow();
+
+private slots:
+    void onProgressSnapshot(const DownloadManager::ProgressSnapshot &snapshot);
+    void onNewConnection();
+
+private:
+    DownloadManager *m_manager;
+    QTcpServer *m_server;
+    QTimer *m_fileTimer;
+    QString m_path;
+
+    // 最近一次进度快照中的合计值
+    qint64 m_speed;
+    qint64 m_averageSpeed;
+    bool m_stalled;
+    qint64 m_queueRemaining;
+    qint64 m_secondsRemaining;
+};
+
+#endif // METRICSEXPORTER_H
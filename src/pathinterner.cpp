@@ -0,0 +1,63 @@
+#include "pathinterner.h"
+
+PathInterner::PathInterner()
+{
+    clear();
+}
+
+quint32 PathInterner::acquire(const QString &path)
+{
+    if (path.isEmpty())
+        return 0;
+
+    auto it = m_ids.constFind(path);
+    if (it != m_ids.constEnd()) {
+        ++m_refs[static_cast<int>(it.value())];
+        return it.value();
+    }
+
+    quint32 id;
+    if (!m_freeIds.isEmpty()) {
+        id = m_freeIds.takeLast();
+        m_paths[static_cast<int>(id)] = path;
+        m_refs[static_cast<int>(id)] = 1;
+    } else {
+        id = static_cast<quint32>(m_paths.size());
+        m_paths.append(path);
+        m_refs.append(1);
+    }
+    // 字典和数组共享同一份字符串数据
+    m_ids.insert(m_paths.at(static_cast<int>(id)), id);
+    return id;
+}
+
+void PathInterner::release(quint32 id)
+{
+    int index = static_cast<int>(id);
+    if (id == 0 || index >= m_refs.size() || m_refs.at(index) == 0)
+        return;
+    if (--m_refs[index] > 0)
+        return;
+
+    m_ids.remove(m_paths.at(index));
+    m_paths[index] = QString();
+    m_freeIds.append(id);
+}
+
+void PathInterner::clear()
+{
+    m_paths.clear();
+    m_refs.clear();
+    m_freeIds.clear();
+    m_ids.clear();
+    m_paths.append(QString());
+    m_refs.append(0);
+    m_ids.insert(m_paths.constLast(), 0);
+}
+
+int PathInterner::nameStart(const QString &path)
+{
+    int slash = path.lastIndexOf('/');
+    int backslash = path.lastIndexOf('\\');
+    return qMax(slash, backslash) + 1;
+}
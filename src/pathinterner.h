@@ -0,0 +1,32 @@
+#ifndef PATHINTERNER_H
+#define PATHINTERNER_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// 目录前缀字典：同一目录下的大量任务只保存一份目录字符串，任务中记录其编号。
+// 编号 0 固定为空字符串，不计引用；其余条目按引用计数，最后一个引用释放后编号留给新的路径。
+class PathInterner
+{
+public:
+    PathInterner();
+
+    // 取得路径的编号并增加一次引用，每次 acquire 对应一次 release
+    quint32 acquire(const QString &path);
+    void release(quint32 id);
+    QString path(quint32 id) const { return m_paths.value(static_cast<int>(id)); }
+    int size() const { return m_ids.size(); }
+    void clear();
+
+    // 路径中最后一段的起始位置（最后一个 '/' 或 '\' 之后），目录前缀包含分隔符
+    static int nameStart(const QString &path);
+
+private:
+    QVector<QString> m_paths;
+    QVector<quint32> m_refs;
+    QVector<quint32> m_freeIds;
+    QHash<QString, quint32> m_ids;
+};
+
+#endif // PATHINTERNER_H
@@ -1,11 +1,55 @@
 #include "pathutils.h"
+#include <QCoreApplication>
+#include <QDir>
 
+namespace {
+QString s_shareMountRoot;
+QString s_dataDirectory;
+}
 
 QString toUncPath(QString path)
 {
     path.remove('\r');
     path.remove('\n');
     path = path.trimmed();
+#ifdef Q_OS_WIN
     path.replace('/', '\\');
+#else
+    path.replace('\\', '/');
+    if (path.startsWith("//"))
+        path = QDir::cleanPath(s_shareMountRoot + '/' + path.mid(2));
+#endif
     return path;
 }
+
+QString shareMountRoot()
+{
+    return s_shareMountRoot;
+}
+
+void setShareMountRoot(const QString &path)
+{
+    s_shareMountRoot = QDir::cleanPath(path);
+    if (s_shareMountRoot == "/")
+        s_shareMountRoot.clear();
+}
+
+QString partialDownloadPath(const QString &filePath, qint64 size, qint64 modified)
+{
+    return QString("%1.%2-%3.dapart").arg(filePath)
+        .arg(QString::number(size, 16), QString::number(modified, 16));
+}
+
+QString dataDirectory()
+{
+    if (s_dataDirectory.isEmpty())
+        return QCoreApplication::applicationDirPath();
+    return s_dataDirectory;
+}
+
+void setDataDirectory(const QString &path)
+{
+    s_dataDirectory = path.isEmpty() ? QString() : QDir(path).absolutePath();
+    if (!s_dataDirectory.isEmpty())
+        QDir().mkpath(s_dataDirectory);
+}
@@ -3,6 +3,21 @@
 
 #include <QString>
 
+// 把输入的共享路径转换为本机可直接打开的路径。
+// Windows 上为 UNC 路径（\\server\share\...）；其他平台通过挂载目录访问共享，
+// \\server\share\a 对应 <挂载根目录>/server/share/a。
 QString toUncPath(QString path);
 
+// 非 Windows 平台上共享的挂载根目录，默认为根目录
+QString shareMountRoot();
+void setShareMountRoot(const QString &path);
+
+// 下载中的临时文件。名称中带有远程文件的大小和修改时间（毫秒），
+// 远程文件变化后旧版本留下的部分文件不会被当作续传的基础
+QString partialDownloadPath(const QString &filePath, qint64 size, qint64 modified);
+
+// 数据目录：任务数据库、日志和同步清单的位置，默认为程序所在目录
+QString dataDirectory();
+void setDataDirectory(const QString &path);
+
 #endif // PATHUTILS_H
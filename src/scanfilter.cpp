@@ -0,0 +1,213 @@
+#include "scanfilter.h"
+#include <QObject>
+#include <QStringList>
+#include <limits>
+#include "units.h"
+
+namespace {
+QString globToRegex(const QString &glob)
+{
+    QString rx;
+    for (int i = 0; i < glob.size(); ++i) {
+        QChar c = glob.at(i);
+        if (c == '*') {
+            if (i + 1 < glob.size() && glob.at(i + 1) == '*') {
+                ++i;
+                if (i + 1 < glob.size() && glob.at(i + 1) == '/') {
+                    ++i;
+                    rx += "(?:.*/)?";   // "**/" 匹配零个或多个目录层级
+                } else {
+                    rx += ".*";
+                }
+            } else {
+                rx += "[^/]*";
+            }
+        } else if (c == '?') {
+            rx += "[^/]";
+        } else {
+            rx += QRegularExpression::escape(QString(c));
+        }
+    }
+    return rx;
+}
+
+QRegularExpression compile(const QStringList &patterns)
+{
+    if (patterns.isEmpty())
+        return QRegularExpression();
+    QRegularExpression rx("^(?:" + patterns.join('|') + ")$",
+                          QRegularExpression::CaseInsensitiveOption);
+    rx.optimize();
+    return rx;
+}
+
+bool matches(const QRegularExpression &rx, const QString &subject)
+{
+    return !rx.pattern().isEmpty() && rx.match(subject).hasMatch();
+}
+
+bool isSimpleSuffix(const QString &glob)
+{
+    if (!glob.startsWith("*.") || glob.size() < 3)
+        return false;
+    QString ext = glob.mid(2);
+    return !ext.contains('*') && !ext.contains('?') && !ext.contains('/')
+           && !ext.contains('[');
+}
+
+bool parseAmount(const QString &number, const QString &unit, bool isAge, qint64 *value)
+{
+    // 大小与时段、模拟源的带宽使用同一套字节单位
+    if (!isAge)
+        return parseBytes(number + unit, value);
+
+    bool ok = false;
+    double base = number.toDouble(&ok);
+    if (!ok)
+        return false;
+
+    QString u = unit.toLower();
+    double factor = 1;
+    if (u.isEmpty() || u == "s") factor = 1000;
+    else if (u == "m") factor = 60 * 1000.0;
+    else if (u == "h") factor = 3600 * 1000.0;
+    else if (u == "d") factor = 24 * 3600 * 1000.0;
+    else return false;
+    *value = static_cast<qint64>(base * factor);
+    return true;
+}
+}
+
+ScanFilter::ScanFilter()
+    : m_hasIncludes(false)
+    , m_minSize(0)
+    , m_maxSize(std::numeric_limits<qint64>::max())
+    , m_minAgeMs(0)
+    , m_maxAgeMs(std::numeric_limits<qint64>::max())
+{
+}
+
+ScanFilter ScanFilter::fromString(const QString &text, QString *error)
+{
+    ScanFilter filter;
+    filter.m_text = text.trimmed();
+
+    QStringList includeName, includePath, excludeName, excludePath, excludeDirName, excludeDirPath;
+    static const QRegularExpression predicateRx("^(size|age)(<=|>=|<|>)(\\d+(?:\\.\\d+)?)([a-zA-Z]*)$",
+                                                QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression separatorRx("[\\s;]+");
+
+    const QStringList tokens = filter.m_text.split(separatorRx, Qt::SkipEmptyParts);
+    for (QString token : tokens) {
+        QRegularExpressionMatch m = predicateRx.match(token);
+        if (m.hasMatch()) {
+            bool isAge = m.captured(1).toLower() == "age";
+            QString op = m.captured(2);
+            qint64 value = 0;
+            if (!parseAmount(m.captured(3), m.captured(4), isAge, &value)) {
+                if (error)
+                    *error = QObject::tr("无法识别的单位：%1").arg(token);
+                return ScanFilter();
+            }
+            // 上下限都是闭区间，严格比较换算成相邻的整数；多个条件取交集
+            qint64 &minimum = isAge ? filter.m_minAgeMs : filter.m_minSize;
+            qint64 &maximum = isAge ? filter.m_maxAgeMs : filter.m_maxSize;
+            if (op == "<")
+                maximum = qMin(maximum, value - 1);
+            else if (op == "<=")
+                maximum = qMin(maximum, value);
+            else if (op == ">")
+                minimum = qMax(minimum, value + 1);
+            else
+                minimum = qMax(minimum, value);
+            continue;
+        }
+
+        token.replace('\\', '/');
+        bool exclude = token.startsWith('!');
+        if (exclude)
+            token.remove(0, 1);
+        bool dirOnly = token.endsWith('/');
+        while (token.endsWith('/'))
+            token.chop(1);
+        if (token.startsWith('/'))
+            token.remove(0, 1);
+        if (token.isEmpty()) {
+            if (error)
+                *error = QObject::tr("规则为空");
+            return ScanFilter();
+        }
+
+        // 不含 '/' 的规则只匹配名称，否则匹配相对路径
+        bool byName = !token.contains('/');
+        if (!exclude) {
+            if (byName && isSimpleSuffix(token))
+                filter.m_includeSuffixes.insert(token.mid(2).toLower());
+            else if (byName)
+                includeName << globToRegex(token);
+            else
+                includePath << globToRegex(token);
+            filter.m_hasIncludes = true;
+        } else if (dirOnly) {
+            (byName ? excludeDirName : excludeDirPath) << globToRegex(token);
+        } else {
+            (byName ? excludeName : excludePath) << globToRegex(token);
+        }
+    }
+
+    filter.m_includeName = compile(includeName);
+    filter.m_includePath = compile(includePath);
+    filter.m_excludeName = compile(excludeName);
+    filter.m_excludePath = compile(excludePath);
+    filter.m_excludeDirName = compile(excludeDirName);
+    filter.m_excludeDirPath = compile(excludeDirPath);
+    return filter;
+}
+
+bool ScanFilter::isEmpty() const
+{
+    return m_text.isEmpty();
+}
+
+bool ScanFilter::acceptsDirectory(const QString &relativePath, const QString &name) const
+{
+    if (isEmpty())
+        return true;
+    return !matches(m_excludeDirName, name) && !matches(m_excludeDirPath, relativePath)
+           && !matches(m_excludeName, name) && !matches(m_excludePath, relativePath);
+}
+
+bool ScanFilter::acceptsFile(const QString &relativePath, const QString &name,
+                             qint64 size, const QDateTime &modified) const
+{
+    if (isEmpty())
+        return true;
+
+    if (matches(m_excludeName, name) || matches(m_excludePath, relativePath))
+        return false;
+    if (m_hasIncludes && !matchesIncludes(relativePath, name))
+        return false;
+    if (size < m_minSize || size > m_maxSize)
+        return false;
+
+    if (m_minAgeMs > 0 || m_maxAgeMs != std::numeric_limits<qint64>::max()) {
+        if (!modified.isValid())
+            return false;
+        qint64 age = modified.msecsTo(QDateTime::currentDateTime());
+        if (age < m_minAgeMs || age > m_maxAgeMs)
+            return false;
+    }
+    return true;
+}
+
+bool ScanFilter::matchesIncludes(const QString &relativePath, const QString &name) const
+{
+    if (!m_includeSuffixes.isEmpty()) {
+        // 依次尝试每个 '.' 之后的部分，支持 "*.tar.gz" 这样的多段扩展名
+        for (int dot = name.indexOf('.'); dot >= 0; dot = name.indexOf('.', dot + 1)) {
+            if (m_includeSuffixes.contains(name.mid(dot + 1).toLower()))
+                return true;
+        }
+    }
+    return matches(m_includeName, name) || matches(m_includePath, relativePath);
+}
@@ -0,0 +1,50 @@
+#ifndef SCANFILTER_H
+#define SCANFILTER_H
+
+#include <QDateTime>
+#include <QRegularExpression>
+#include <QSet>
+#include <QString>
+
+// 目录扫描时使用的包含/排除规则，解析一次后在遍历过程中反复匹配。
+//
+// 规则以空白或分号分隔：
+//   *.zip  bin/**/*.pdb     包含规则，不含 '/' 时只匹配文件名
+//   !obj/  !**/*.tmp        排除规则，以 '/' 结尾时只作用于目录
+//   size>10M  age<7d        大小和修改时间条件（单位 K/M/G，s/m/h/d）
+class ScanFilter
+{
+public:
+    ScanFilter();
+
+    static ScanFilter fromString(const QString &text, QString *error = nullptr);
+
+    bool isEmpty() const;
+    QString text() const { return m_text; }
+
+    // 被排除的目录在列出内容之前就会被剪掉
+    bool acceptsDirectory(const QString &relativePath, const QString &name) const;
+    bool acceptsFile(const QString &relativePath, const QString &name,
+                     qint64 size, const QDateTime &modified) const;
+
+private:
+    bool matchesIncludes(const QString &relativePath, const QString &name) const;
+
+    QString m_text;
+
+    QSet<QString> m_includeSuffixes;    // "*.zip" 这类规则直接按扩展名查表
+    QRegularExpression m_includeName;
+    QRegularExpression m_includePath;
+    QRegularExpression m_excludeName;
+    QRegularExpression m_excludePath;
+    QRegularExpression m_excludeDirName;
+    QRegularExpression m_excludeDirPath;
+    bool m_hasIncludes;
+
+    qint64 m_minSize;
+    qint64 m_maxSize;
+    qint64 m_minAgeMs;
+    qint64 m_maxAgeMs;
+};
+
+#endif // SCANFILTER_H
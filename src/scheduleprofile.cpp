@@ -0,0 +1,182 @@
+#include "scheduleprofile.h"
+#include <QStringList>
+#include "units.h"
+
+namespace {
+
+const int kAllDays = 0x7F;
+const char *const kDayNames[] = {"mon", "tue", "wed", "thu", "fri", "sat", "sun"};
+
+int dayIndex(const QString &name)
+{
+    for (int i = 0; i < 7; ++i) {
+        if (name == QLatin1String(kDayNames[i]))
+            return i;
+    }
+    return -1;
+}
+
+// "mon-fri"、"sat+sun"、"all"，范围可以跨过周日
+bool parseDays(const QString &text, int *days)
+{
+    int mask = 0;
+    const QStringList parts = text.toLower().split('+', Qt::SkipEmptyParts);
+    for (const QString &part : parts) {
+        if (part == "all") {
+            mask = kAllDays;
+            continue;
+        }
+        int first = dayIndex(part.section('-', 0, 0).trimmed());
+        int last = part.contains('-') ? dayIndex(part.section('-', 1).trimmed()) : first;
+        if (first < 0 || last < 0)
+            return false;
+        for (int day = first;; day = (day + 1) % 7) {
+            mask |= 1 << day;
+            if (day == last)
+                break;
+        }
+    }
+    if (mask == 0)
+        return false;
+    *days = mask;
+    return true;
+}
+
+QString daysToString(int days)
+{
+    if ((days & kAllDays) == kAllDays)
+        return QStringLiteral("all");
+    QStringList names;
+    for (int i = 0; i < 7; ++i) {
+        if (days & (1 << i))
+            names.append(QLatin1String(kDayNames[i]));
+    }
+    return names.join('+');
+}
+
+bool parseTime(const QString &text, QTime *time)
+{
+    QTime value = QTime::fromString(text, "HH:mm");
+    if (!value.isValid())
+        value = QTime::fromString(text, "H:mm");
+    if (!value.isValid())
+        return false;
+    *time = value;
+    return true;
+}
+
+bool dayMatches(int days, const QDate &date)
+{
+    return (days & (1 << (date.dayOfWeek() - 1))) != 0;
+}
+
+} // namespace
+
+ScheduleProfile::ScheduleProfile()
+    : days(kAllDays)
+    , start(0, 0)
+    , end(0, 0)
+    , bandwidth(0)
+    , concurrency(0)
+    , minPriority(-128)
+{
+}
+
+bool ScheduleProfile::contains(const QDateTime &time) const
+{
+    QTime now = time.time();
+    QDate today = time.date();
+    if (start == end)
+        return dayMatches(days, today);
+    if (start < end)
+        return dayMatches(days, today) && now >= start && now < end;
+    // 跨过午夜：午夜之后的部分属于前一天的时段
+    if (now >= start)
+        return dayMatches(days, today);
+    return now < end && dayMatches(days, today.addDays(-1));
+}
+
+bool ScheduleProfile::fromString(const QString &spec, ScheduleProfile *profile, QString *error)
+{
+    ScheduleProfile result;
+    const QStringList items = spec.split(',', Qt::SkipEmptyParts);
+    for (const QString &item : items) {
+        QString key = item.section('=', 0, 0).trimmed();
+        QString value = item.section('=', 1).trimmed();
+        bool ok = true;
+        if (key == "name")
+            result.name = value;
+        else if (key == "days")
+            ok = parseDays(value, &result.days);
+        else if (key == "from")
+            ok = parseTime(value, &result.start);
+        else if (key == "to")
+            ok = parseTime(value, &result.end);
+        else if (key == "bandwidth")
+            ok = parseBytes(value, &result.bandwidth);
+        else if (key == "concurrency")
+            result.concurrency = value.toInt(&ok);
+        else if (key == "priority")
+            result.minPriority = value.toInt(&ok);
+        else {
+            *error = QString("未知的参数: %1").arg(key);
+            return false;
+        }
+        if (!ok || result.concurrency < 0 || result.minPriority < -128 || result.minPriority > 127) {
+            *error = QString("参数值无效: %1").arg(item.trimmed());
+            return false;
+        }
+    }
+    if (result.name.isEmpty())
+        result.name = QString("%1 %2-%3").arg(daysToString(result.days))
+                          .arg(result.start.toString("HH:mm")).arg(result.end.toString("HH:mm"));
+    *profile = result;
+    return true;
+}
+
+QString ScheduleProfile::toString() const
+{
+    return QString("name=%1,days=%2,from=%3,to=%4,bandwidth=%5,concurrency=%6,priority=%7")
+        .arg(name).arg(daysToString(days))
+        .arg(start.toString("HH:mm")).arg(end.toString("HH:mm"))
+        .arg(bandwidth).arg(concurrency).arg(minPriority);
+}
+
+ScheduleProfile ScheduleProfile::fromJson(const QJsonObject &json)
+{
+    ScheduleProfile profile;
+    profile.name = json["name"].toString();
+    profile.days = json["days"].toInt(kAllDays) & kAllDays;
+    profile.start = QTime::fromString(json["from"].toString(), "HH:mm");
+    profile.end = QTime::fromString(json["to"].toString(), "HH:mm");
+    if (!profile.start.isValid())
+        profile.start = QTime(0, 0);
+    if (!profile.end.isValid())
+        profile.end = QTime(0, 0);
+    profile.bandwidth = json["bandwidth"].toVariant().toLongLong();
+    profile.concurrency = json["concurrency"].toInt();
+    profile.minPriority = json["minPriority"].toInt(-128);
+    return profile;
+}
+
+QJsonObject ScheduleProfile::toJson() const
+{
+    QJsonObject json;
+    json["name"] = name;
+    json["days"] = days;
+    json["from"] = start.toString("HH:mm");
+    json["to"] = end.toString("HH:mm");
+    json["bandwidth"] = bandwidth;
+    json["concurrency"] = concurrency;
+    json["minPriority"] = minPriority;
+    return json;
+}
+
+int ScheduleProfile::activeIndex(const QList<ScheduleProfile> &profiles, const QDateTime &time)
+{
+    for (int i = 0; i < profiles.size(); ++i) {
+        if (profiles.at(i).contains(time))
+            return i;
+    }
+    return -1;
+}
@@ -0,0 +1,38 @@
+#ifndef SCHEDULEPROFILE_H
+#define SCHEDULEPROFILE_H
+
+#include <QDateTime>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QTime>
+
+// 按时段生效的传输限制，例如办公时间限速、夜间不限。
+// 多个时段重叠时取列表中靠前的一个，不在任何时段内时不限制。
+struct ScheduleProfile
+{
+    ScheduleProfile();
+
+    QString name;
+    int days;                   // 星期掩码，第 0 位为周一
+    QTime start;                // 与 end 相同时表示全天；end 早于 start 时跨过午夜
+    QTime end;
+    qint64 bandwidth;           // 全部传输合计的速率上限（字节/秒），0 表示不限
+    int concurrency;            // 同时传输的任务总数上限，0 表示不限
+    int minPriority;            // 只自动开始优先级不低于此值的任务
+
+    bool contains(const QDateTime &time) const;
+
+    // 解析 "name=office,days=mon-fri,from=08:00,to=18:00,bandwidth=10M,concurrency=2,priority=0"，
+    // days 可写成 mon-fri、sat+sun 或 all，大小可带 K/M/G 后缀。出错时返回 false 并给出原因
+    static bool fromString(const QString &spec, ScheduleProfile *profile, QString *error);
+    QString toString() const;
+
+    static ScheduleProfile fromJson(const QJsonObject &json);
+    QJsonObject toJson() const;
+
+    // 当前生效的时段在列表中的下标，没有时返回 -1
+    static int activeIndex(const QList<ScheduleProfile> &profiles, const QDateTime &time);
+};
+
+#endif // SCHEDULEPROFILE_H
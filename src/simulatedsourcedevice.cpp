@@ -0,0 +1,183 @@
+#include "simulatedsourcedevice.h"
+#include <QHash>
+#include <QStringList>
+#include <QThread>
+#include "units.h"
+
+namespace {
+
+bool parseRate(const QString &text, double *rate)
+{
+    bool ok = false;
+    double value = text.toDouble(&ok);
+    if (!ok || value < 0 || value > 1)
+        return false;
+    *rate = value;
+    return true;
+}
+
+bool parseMs(const QString &text, int *ms)
+{
+    bool ok = false;
+    int value = text.toInt(&ok);
+    if (!ok || value < 0)
+        return false;
+    *ms = value;
+    return true;
+}
+
+} // namespace
+
+SimulatedSourceConfig::SimulatedSourceConfig()
+    : openLatencyMs(0)
+    , readLatencyMs(0)
+    , jitterMs(0)
+    , bandwidth(0)
+    , openErrorRate(0.0)
+    , readErrorRate(0.0)
+    , stallRate(0.0)
+    , stallMs(0)
+    , seed(1)
+{
+}
+
+bool SimulatedSourceConfig::fromString(const QString &spec, SimulatedSourceConfig *config,
+                                       QString *error)
+{
+    SimulatedSourceConfig result;
+    const QStringList items = spec.split(',', Qt::SkipEmptyParts);
+    for (const QString &item : items) {
+        QString key = item.section('=', 0, 0).trimmed();
+        QString value = item.section('=', 1).trimmed();
+        bool ok;
+        if (key == "latency")
+            ok = parseMs(value, &result.readLatencyMs);
+        else if (key == "open-latency")
+            ok = parseMs(value, &result.openLatencyMs);
+        else if (key == "jitter")
+            ok = parseMs(value, &result.jitterMs);
+        else if (key == "bandwidth")
+            ok = parseBytes(value, &result.bandwidth);
+        else if (key == "errors")
+            ok = parseRate(value, &result.readErrorRate);
+        else if (key == "open-errors")
+            ok = parseRate(value, &result.openErrorRate);
+        else if (key == "stalls")
+            ok = parseRate(value, &result.stallRate);
+        else if (key == "stall-ms")
+            ok = parseMs(value, &result.stallMs);
+        else if (key == "seed")
+            result.seed = value.toUInt(&ok);
+        else {
+            *error = QString("未知的参数: %1").arg(key);
+            return false;
+        }
+        if (!ok) {
+            *error = QString("参数值无效: %1").arg(item.trimmed());
+            return false;
+        }
+    }
+    *config = result;
+    return true;
+}
+
+QString SimulatedSourceConfig::toString() const
+{
+    return QString("latency=%1,open-latency=%2,jitter=%3,bandwidth=%4,errors=%5,open-errors=%6,"
+                   "stalls=%7,stall-ms=%8,seed=%9")
+        .arg(readLatencyMs).arg(openLatencyMs).arg(jitterMs).arg(bandwidth)
+        .arg(readErrorRate).arg(openErrorRate).arg(stallRate).arg(stallMs).arg(seed);
+}
+
+SimulatedSourceDevice::SimulatedSourceDevice(const QString &path, const SimulatedSourceConfig &config,
+                                             QObject *parent)
+    : QIODevice(parent)
+    , m_file(path)
+    , m_config(config)
+    , m_random(config.seed ^ static_cast<quint32>(qHash(path)))
+    , m_bytesRead(0)
+{
+}
+
+bool SimulatedSourceDevice::open(OpenMode mode)
+{
+    if (!(mode & ReadOnly) || (mode & WriteOnly)) {
+        setErrorString(QStringLiteral("模拟设备只支持只读"));
+        return false;
+    }
+
+    roundTrip(m_config.openLatencyMs);
+    if (m_random.generateDouble() < m_config.openErrorRate) {
+        setErrorString(QStringLiteral("模拟的打开失败"));
+        return false;
+    }
+    if (!m_file.open(ReadOnly)) {
+        setErrorString(m_file.errorString());
+        return false;
+    }
+
+    m_clock.start();
+    m_bytesRead = 0;
+    return QIODevice::open(ReadOnly | Unbuffered);
+}
+
+void SimulatedSourceDevice::close()
+{
+    QIODevice::close();
+    m_file.close();
+}
+
+bool SimulatedSourceDevice::seek(qint64 pos)
+{
+    return QIODevice::seek(pos) && m_file.seek(pos);
+}
+
+qint64 SimulatedSourceDevice::size() const
+{
+    return m_file.size();
+}
+
+qint64 SimulatedSourceDevice::readData(char *data, qint64 maxSize)
+{
+    roundTrip(m_config.readLatencyMs);
+    if (m_random.generateDouble() < m_config.stallRate)
+        QThread::msleep(static_cast<unsigned long>(m_config.stallMs));
+    if (m_random.generateDouble() < m_config.readErrorRate) {
+        setErrorString(QStringLiteral("模拟的读取错误"));
+        return -1;
+    }
+
+    qint64 n = m_file.read(data, maxSize);
+    if (n < 0) {
+        setErrorString(m_file.errorString());
+        return -1;
+    }
+    m_bytesRead += n;
+    throttle();
+    return n;
+}
+
+qint64 SimulatedSourceDevice::writeData(const char *, qint64)
+{
+    return -1;
+}
+
+void SimulatedSourceDevice::roundTrip(int latencyMs)
+{
+    int delay = latencyMs;
+    if (m_config.jitterMs > 0)
+        delay += m_random.bounded(m_config.jitterMs + 1);
+    if (delay > 0)
+        QThread::msleep(static_cast<unsigned long>(delay));
+}
+
+void SimulatedSourceDevice::throttle()
+{
+    // 已读字节按限速应耗费的时间比实际耗时多出的部分补足
+    if (m_config.bandwidth <= 0)
+        return;
+    qint64 dueMs = m_bytesRead * 1000 / m_config.bandwidth;
+    qint64 elapsedMs = m_clock.elapsed();
+    if (dueMs > elapsedMs)
+        QThread::msleep(static_cast<unsigned long>(dueMs - elapsedMs));
+}
@@ -0,0 +1,61 @@
+#ifndef SIMULATEDSOURCEDEVICE_H
+#define SIMULATEDSOURCEDEVICE_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QIODevice>
+#include <QRandomGenerator>
+#include <QString>
+
+// 模拟共享的读取条件
+struct SimulatedSourceConfig
+{
+    SimulatedSourceConfig();
+
+    int openLatencyMs;          // 每次打开文件的往返时间
+    int readLatencyMs;          // 每次读请求的往返时间
+    int jitterMs;               // 往返时间上随机增加的 0~jitterMs 毫秒
+    qint64 bandwidth;           // 每个文件的读取速率上限（字节/秒），0 表示不限
+    double openErrorRate;       // 打开失败的概率
+    double readErrorRate;       // 每次读请求失败的概率
+    double stallRate;           // 每次读请求卡住的概率
+    int stallMs;                // 卡住的时长
+    quint32 seed;
+
+    // 解析 "latency=20,jitter=5,bandwidth=10M,errors=0.001,stalls=0.0005,stall-ms=3000,seed=7"，
+    // 其余键为 open-latency、open-errors；大小可带 K/M/G 后缀。出错时返回 false 并给出原因
+    static bool fromString(const QString &spec, SimulatedSourceConfig *config, QString *error);
+    QString toString() const;
+};
+
+// 包装本地文件的只读设备，按配置为打开和每次读请求注入延迟、限速、错误和卡顿。
+// 随机数由种子和文件路径决定，同一配置下每个文件的表现可以重现，与复制顺序无关。
+// 以无缓冲方式打开，调用方的每次 read 对应一次模拟的读请求。
+class SimulatedSourceDevice : public QIODevice
+{
+public:
+    SimulatedSourceDevice(const QString &path, const SimulatedSourceConfig &config,
+                          QObject *parent = nullptr);
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override { return false; }
+    bool seek(qint64 pos) override;
+    qint64 size() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    void roundTrip(int latencyMs);
+    void throttle();
+
+    QFile m_file;
+    SimulatedSourceConfig m_config;
+    QRandomGenerator m_random;
+    QElapsedTimer m_clock;
+    qint64 m_bytesRead;
+};
+
+#endif // SIMULATEDSOURCEDEVICE_H
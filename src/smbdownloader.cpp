@@ -5,17 +5,19 @@
 #include <QDir>
 #include <QFile>
 #include <QStandardPaths>
-#include <QMessageBox>
-#include <QApplication>
 #include <QDebug>
 #include <QThread>
 #include <QTimer>
 #include "logger.h"
+#include "transfermetrics.h"
 
 SmbDownloader::SmbDownloader(QObject *parent)
-    : QObject(parent)
+    : Downloader(parent)
+    , m_speedTimer(new QTimer(this))
 {
     LOG_INFO("SmbDownloader 初始化");
+    m_speedTimer->setInterval(1000); // 每秒更新一次速度
+    connect(m_speedTimer, &QTimer::timeout, this, &SmbDownloader::updateSpeed);
 }
 
 SmbDownloader::~SmbDownloader()
@@ -28,10 +30,6 @@ SmbDownloader::~SmbDownloader()
             info->worker->wait();
             delete info->worker;
         }
-        if (info->speedTimer) {
-            info->speedTimer->stop();
-            delete info->speedTimer;
-        }
         delete info;
     }
     m_activeDownloads.clear();
@@ -51,16 +49,24 @@ bool SmbDownloader::startDownload(DownloadTask *task)
         LOG_WARNING(QString("任务状态不正确 - ID: %1, 状态: %2").arg(task->id()).arg(static_cast<int>(task->status())));
         return false;
     }
+
+    // 暂停后经排队再开始的任务，工作线程仍在，直接继续
+    if (DownloadInfo *paused = findDownloadInfo(task)) {
+        if (paused->worker) {
+            paused->worker->resumeWork();
+            paused->throughput.reset(QDateTime::currentMSecsSinceEpoch(), task->downloadedSize());
+            emit downloadResumed(task);
+            return true;
+        }
+        cleanupDownload(task);
+    }
     
     // 创建下载信息
     DownloadInfo *info = new DownloadInfo;
     info->task = task;
     info->worker = new SmbWorker(task, this);
-    info->speedTimer = nullptr;
-    info->lastBytesReceived = task->downloadedSize();
-    info->lastSpeedUpdate = QDateTime::currentMSecsSinceEpoch();
     info->totalBytes = 0;
-    info->smoothedSpeed = 0.0;
+    info->throughput.reset(QDateTime::currentMSecsSinceEpoch(), task->downloadedSize());
 
     // 检查文件是否存在以确定断点续传
     QUrl url(task->url());
@@ -77,22 +83,21 @@ bool SmbDownloader::startDownload(DownloadTask *task)
         task->setSupportsResume(true);
     }
     
-    // 连接信号
+    // 连接信号：进度直接绑定到对应的下载信息，无需按发送者查找。
+    // 以工作线程对象为上下文，对象删除后尚未处理的进度通知随之丢弃
     connect(info->worker, &SmbWorker::progress,
-            this, &SmbDownloader::onDownloadProgress);
+            info->worker, [this, info](qint64 bytesReceived, qint64 bytesTotal) {
+                onDownloadProgress(info, bytesReceived, bytesTotal);
+            });
     connect(info->worker, &SmbWorker::finished,
             this, [this, task](bool success, const QString &err) {
                 onDownloadFinished(task, success, err);
             });
 
-    // 创建速度计时器
-    info->speedTimer = new QTimer(this);
-    info->speedTimer->setInterval(1000); // 每秒更新一次速度
-    connect(info->speedTimer, &QTimer::timeout, this, &SmbDownloader::updateSpeed);
-    info->speedTimer->start();
-
     // 添加到活动下载列表
     m_activeDownloads[task] = info;
+    if (!m_speedTimer->isActive())
+        m_speedTimer->start();
 
     // 更新任务状态并启动线程
     task->setStatus(DownloadTask::Downloading);
@@ -115,6 +120,7 @@ void SmbDownloader::pauseDownload(DownloadTask *task)
     // 暂停下载
     info->worker->requestPause();
     task->setStatus(DownloadTask::Paused);
+    task->setEstimate(0, 0.0, false);
     
     LOG_INFO(QString("SMB 下载已暂停 - 任务ID: %1").arg(task->id()));
     emit downloadPaused(task);
@@ -132,6 +138,8 @@ void SmbDownloader::resumeDownload(DownloadTask *task)
     DownloadInfo *info = findDownloadInfo(task);
     if (info && info->worker) {
         info->worker->resumeWork();
+        // 暂停期间不计入速率
+        info->throughput.reset(QDateTime::currentMSecsSinceEpoch(), task->downloadedSize());
         task->setStatus(DownloadTask::Downloading);
         emit downloadResumed(task);
     } else {
@@ -156,16 +164,18 @@ void SmbDownloader::cancelDownload(DownloadTask *task)
         info->worker->wait();
     }
 
-    // 删除已下载的部分文件
-    QUrl url(task->url());
-    QString filePath = task->savePath();
-    if (!filePath.endsWith('/') && !filePath.endsWith('\\'))
-        filePath += '/';
-    QString fileName = url.fileName();
-    if (fileName.isEmpty())
-        fileName = "downloaded_file";
-    filePath += fileName;
-    QFile::remove(filePath);
+    // 删除已下载的部分文件，目录任务保留已经下载完成的文件
+    if (!task->isDirectory()) {
+        QUrl url(task->url());
+        QString filePath = task->savePath();
+        if (!filePath.endsWith('/') && !filePath.endsWith('\\'))
+            filePath += '/';
+        QString fileName = url.fileName();
+        if (fileName.isEmpty())
+            fileName = "downloaded_file";
+        filePath += fileName;
+        QFile::remove(filePath);
+    }
 
     task->setStatus(DownloadTask::Cancelled);
     cleanupDownload(task);
@@ -176,25 +186,9 @@ void SmbDownloader::cancelDownload(DownloadTask *task)
 
 
 
-void SmbDownloader::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
+void SmbDownloader::onDownloadProgress(DownloadInfo *info, qint64 bytesReceived, qint64 bytesTotal)
 {
-    SmbWorker *worker = qobject_cast<SmbWorker*>(sender());
-    if (!worker)
-        return;
-
-    DownloadTask *task = nullptr;
-    DownloadInfo *info = nullptr;
-
-    for (auto it = m_activeDownloads.begin(); it != m_activeDownloads.end(); ++it) {
-        if (it.value()->worker == worker) {
-            task = it.key();
-            info = it.value();
-            break;
-        }
-    }
-
-    if (!task || !info)
-        return;
+    DownloadTask *task = info->task;
 
     if (bytesTotal > 0) {
         task->setTotalSize(bytesTotal);
@@ -224,27 +218,18 @@ void SmbDownloader::onDownloadFinished(DownloadTask *task, bool success, const Q
 
 void SmbDownloader::updateSpeed()
 {
-    for (auto it = m_activeDownloads.begin(); it != m_activeDownloads.end(); ++it) {
-        DownloadInfo *info = it.value();
-        DownloadTask *task = it.key();
-        
-        if (info->speedTimer && info->speedTimer->isActive()) {
-            qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
-            qint64 timeDiff = currentTime - info->lastSpeedUpdate;
-
-            if (timeDiff > 0) {
-                qint64 bytesDiff = task->downloadedSize() - info->lastBytesReceived;
-                double newSpeed = (bytesDiff * 1000.0) / timeDiff; // 字节/秒
-
-                if (bytesDiff > 0) {
-                    info->smoothedSpeed = 0.7 * info->smoothedSpeed + 0.3 * newSpeed;
-                }
-
-                info->lastSpeedUpdate = currentTime;
-                info->lastBytesReceived = task->downloadedSize();
-                task->setSpeed(static_cast<qint64>(info->smoothedSpeed));
-            }
-        }
+    qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+    const auto &downloads = m_activeDownloads;
+    for (DownloadInfo *info : downloads) {
+        DownloadTask *task = info->task;
+        if (task->status() != DownloadTask::Downloading)
+            continue;
+        // 没有进度也要采样，停滞时速率才会降下来
+        info->throughput.addSample(currentTime, task->downloadedSize());
+        bool stalled = info->throughput.isStalled();
+        if (stalled && !task->isStalled())
+            recordStall();
+        task->setEstimate(info->throughput.rate(), info->throughput.confidence(), stalled);
     }
 }
 
@@ -265,11 +250,8 @@ void SmbDownloader::cleanupDownload(DownloadTask *task)
         delete info->worker;
     }
     
-    if (info->speedTimer) {
-        info->speedTimer->stop();
-        delete info->speedTimer;
-    }
-    
     delete info;
+    if (m_activeDownloads.isEmpty())
+        m_speedTimer->stop();
 }
 
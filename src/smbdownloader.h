@@ -5,10 +5,12 @@
 #include <QTimer>
 #include <QDateTime>
 #include <QMap>
+#include "downloader.h"
 #include "smbworker.h"
 #include "downloadtask.h"
+#include "throughputestimator.h"
 
-class SmbDownloader : public QObject
+class SmbDownloader : public Downloader
 {
     Q_OBJECT
 
@@ -17,40 +19,29 @@ public:
     ~SmbDownloader();
 
     // 下载控制
-    bool startDownload(DownloadTask *task);
-    void pauseDownload(DownloadTask *task);
-    void resumeDownload(DownloadTask *task);
-    void cancelDownload(DownloadTask *task);
-    
-
-signals:
-    void downloadStarted(DownloadTask *task);
-    void downloadPaused(DownloadTask *task);
-    void downloadResumed(DownloadTask *task);
-    void downloadCancelled(DownloadTask *task);
-    void downloadCompleted(DownloadTask *task);
-    void downloadFailed(DownloadTask *task, const QString &error);
-    void downloadProgress(DownloadTask *task, qint64 bytesReceived, qint64 bytesTotal);
+    bool startDownload(DownloadTask *task) override;
+    void pauseDownload(DownloadTask *task) override;
+    void resumeDownload(DownloadTask *task) override;
+    void cancelDownload(DownloadTask *task) override;
 
 private slots:
-    void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
     void onDownloadFinished(DownloadTask *task, bool success, const QString &error);
+    // 全部活动下载共用一个计时器，每秒统一计算一次速度
     void updateSpeed();
 
 private:
     struct DownloadInfo {
         DownloadTask *task;
         SmbWorker *worker;
-        QTimer *speedTimer;
-        qint64 lastBytesReceived;
-        qint64 lastSpeedUpdate;
         qint64 totalBytes;
-        double smoothedSpeed;
+        ThroughputEstimator throughput;
     };
 
     QMap<DownloadTask*, DownloadInfo*> m_activeDownloads;
+    QTimer *m_speedTimer;
     
     // 辅助方法
+    void onDownloadProgress(DownloadInfo *info, qint64 bytesReceived, qint64 bytesTotal);
     DownloadInfo* findDownloadInfo(DownloadTask *task);
     void cleanupDownload(DownloadTask *task);
 };
@@ -1,18 +1,45 @@
 #include "smbworker.h"
 #include "downloadtask.h"
+#include "directoryjob.h"
 #include <QFile>
 #include <QDir>
+#include <QScopedPointer>
 #include <QUrl>
 #include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
 #include <QThread>
 #include <QDebug>
+#include "bandwidthlimiter.h"
 #include "logger.h"
 #include "pathutils.h"
+#include "sourcedevice.h"
+#include "transfermetrics.h"
+
+namespace {
+// 进入时计入工作线程数或缓冲区占用，离开作用域时扣除，各个返回路径都不会漏掉
+struct WorkerGauge {
+    WorkerGauge() { adjustActiveWorkers(1); }
+    ~WorkerGauge() { adjustActiveWorkers(-1); }
+};
+
+struct BufferGauge {
+    explicit BufferGauge(qint64 bytes) : m_bytes(bytes) { adjustBufferBytes(m_bytes); }
+    ~BufferGauge() { adjustBufferBytes(-m_bytes); }
+    qint64 m_bytes;
+};
+}
 
 SmbWorker::SmbWorker(DownloadTask *task, QObject *parent)
-    : QThread(parent), m_task(task), m_pauseRequested(false),
+    : QThread(parent), m_hasTask(task != nullptr), m_totalSize(0), m_pauseRequested(false),
       m_cancelRequested(false), m_offset(0)
 {
+    if (task) {
+        m_url = task->url();
+        m_savePath = task->savePath();
+        m_totalSize = task->totalSize();
+        m_job = task->directoryJob();
+    }
 }
 
 void SmbWorker::requestPause()
@@ -32,11 +59,20 @@ void SmbWorker::resumeWork()
 
 void SmbWorker::run()
 {
-    if (!m_task)
+    if (!m_hasTask)
         return;
 
-    QUrl url(m_task->url());
-    QString filePath = m_task->savePath();
+    WorkerGauge gauge;
+    if (m_job)
+        runDirectory();
+    else
+        runFile();
+}
+
+void SmbWorker::runFile()
+{
+    QUrl url(m_url);
+    QString filePath = m_savePath;
     if (!filePath.endsWith('/') && !filePath.endsWith('\\'))
         filePath += '/';
     QString fileName = url.fileName();
@@ -44,43 +80,133 @@ void SmbWorker::run()
         fileName = "downloaded_file";
     filePath += fileName;
 
+    QString error;
+    CopyResult result = copyFile(m_url, filePath, m_totalSize, &error);
+    if (result == CopyCancelled) {
+        emit finished(false, QObject::tr("用户取消"));
+    } else if (result == CopyFailed) {
+        emit finished(false, error);
+    } else {
+        emit finished(true, QString());
+    }
+}
+
+void SmbWorker::runDirectory()
+{
+    // 整个目录树由同一个线程依次下载，暂停、继续和取消都只作用于这一个线程
+    QString rootUrl = m_url;
+    if (!rootUrl.endsWith('/') && !rootUrl.endsWith('\\'))
+        rootUrl += '/';
+    QDir localRoot(m_savePath);
+
+    // 预扫描模式下先等待扫描完成，使总大小和剩余时间从一开始就准确
+    if (m_job->isPrescan() && !m_job->isScanFinished()) {
+        LOG_INFO(QString("SmbWorker: 等待目录预扫描完成 - %1").arg(m_url));
+        while (!m_cancelRequested && !m_job->isScanFinished())
+            msleep(100);
+    }
+
+    int index = 0;
+    while (!m_cancelRequested) {
+        if (m_pauseRequested) {
+            msleep(100);
+            continue;
+        }
+
+        DirectoryJob::Entry entry;
+        if (!m_job->waitForEntry(index, &entry, 200)) {
+            if (m_job->isScanFinished() && index >= m_job->fileCount())
+                break;
+            continue;
+        }
+
+        if (entry.status == DirectoryJob::EntryPending) {
+            // 重新同步时排队的可能是远程已变化的文件，本地的旧文件不能作为续传的基础，
+            // 因此子文件都先写入临时文件，完整下载后再替换
+            QString error;
+            CopyResult result = replaceFile(rootUrl + entry.relativePath,
+                                            localRoot.filePath(entry.relativePath),
+                                            entry.size, entry.modified, &error);
+            if (result == CopyCancelled)
+                break;
+            if (result == CopyFailed)
+                LOG_WARNING(QString("SmbWorker: 子文件下载失败 %1: %2").arg(entry.relativePath).arg(error));
+            m_job->markEntry(index, result == CopySucceeded ? DirectoryJob::EntryCompleted
+                                                            : DirectoryJob::EntryFailed, error);
+            emitProgress(0, 0);
+        }
+        ++index;
+    }
+
+    if (m_cancelRequested) {
+        emit finished(false, QObject::tr("用户取消"));
+    } else {
+        LOG_INFO(QString("SmbWorker: 目录下载结束，完成 %1，失败 %2")
+                 .arg(m_job->completedCount()).arg(m_job->failedCount()));
+        emit finished(true, QString());
+    }
+}
+
+SmbWorker::CopyResult SmbWorker::copyFile(const QString &remoteUrl, const QString &filePath,
+                                          qint64 knownSize, QString *error)
+{
     QFileInfo info(filePath);
     QDir().mkpath(info.absolutePath());
 
     QFile file(filePath);
     if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
-        emit finished(false, QObject::tr("无法创建文件"));
-        return;
+        *error = QObject::tr("无法创建文件");
+        return CopyFailed;
     }
 
     m_offset = file.size();
+    // 本地文件比远程还大，不可能是同一个文件的前半部分
+    if (knownSize > 0 && m_offset > knownSize) {
+        LOG_WARNING(QString("SmbWorker: 本地文件大于远程文件，重新下载 - %1").arg(filePath));
+        file.resize(0);
+        m_offset = 0;
+    }
 
-    QString unc = toUncPath(m_task->url());
-    LOG_INFO(QString("SmbWorker 尝试打开远程文件: %1").arg(unc));
-    QFile remoteFile(unc);
-    LOG_INFO("SmbWorker: remoteFile.open() 前");
-    if (!remoteFile.open(QIODevice::ReadOnly)) {
-        LOG_ERROR(QString("SmbWorker 打开失败: %1").arg(remoteFile.errorString()));
+    QString unc = toUncPath(remoteUrl);
+    LOG_DEBUG(QString("SmbWorker 尝试打开远程文件: %1").arg(unc));
+    QScopedPointer<QIODevice> remoteFile(createSourceDevice(unc));
+    QElapsedTimer timer;
+    timer.start();
+    bool opened = remoteFile->open(QIODevice::ReadOnly);
+    recordOperation(OperationOpen, timer.nsecsElapsed(), !opened);
+    if (!opened) {
+        LOG_ERROR(QString("SmbWorker 打开失败: %1").arg(remoteFile->errorString()));
         file.close();
-        emit finished(false, QObject::tr("无法打开远程文件: %1").arg(remoteFile.errorString()));
-        return;
+        *error = QObject::tr("无法打开远程文件: %1").arg(remoteFile->errorString());
+        return CopyFailed;
     }
-    LOG_INFO("SmbWorker: remoteFile.open() 成功");
 
-    if (m_offset > 0 && !remoteFile.seek(m_offset)) {
-        remoteFile.close();
+    bool positioned = true;
+    if (m_offset > 0) {
+        recordResumedTransfer();
+        timer.start();
+        positioned = remoteFile->seek(m_offset);
+        recordOperation(OperationSeek, timer.nsecsElapsed(), !positioned);
+    }
+    if (!positioned) {
+        remoteFile->close();
         file.close();
         LOG_ERROR("SmbWorker: remoteFile.seek() 失败");
-        emit finished(false, QObject::tr("无法定位远程文件"));
-        return;
+        *error = QObject::tr("无法定位远程文件");
+        return CopyFailed;
     }
 
-    qint64 total = remoteFile.size();
-    LOG_INFO(QString("SmbWorker: remoteFile.size() = %1").arg(total));
-    emit progress(m_offset, total);
+    // 列目录时已得到文件大小则直接使用，避免再发起一次元数据请求
+    qint64 total = knownSize;
+    if (total <= 0) {
+        total = remoteFile->size();
+        LOG_INFO(QString("SmbWorker: remoteFile.size() = %1").arg(total));
+    }
+    emitProgress(m_offset, total);
 
     const int bufSize = 524288; // 512KB
     char buf[bufSize];
+    BufferGauge bufferGauge(bufSize);
     qint64 received = m_offset;
 
     while (!m_cancelRequested) {
@@ -88,34 +214,82 @@ void SmbWorker::run()
             msleep(100);
             continue;
         }
-        qint64 n = remoteFile.read(buf, bufSize);
+        timer.start();
+        qint64 n = remoteFile->read(buf, bufSize);
+        recordOperation(OperationRead, timer.nsecsElapsed(), n < 0);
         if (n < 0) {
-            remoteFile.close();
+            *error = remoteFile->errorString();
+            remoteFile->close();
             file.close();
-            LOG_ERROR(QString("SmbWorker: 读取数据失败: %1").arg(remoteFile.errorString()));
-            emit finished(false, remoteFile.errorString());
-            return;
+            LOG_ERROR(QString("SmbWorker: 读取数据失败: %1").arg(*error));
+            return CopyFailed;
         }
         if (n == 0)
             break;
-        if (file.write(buf, n) != n) {
-            remoteFile.close();
+        recordBytesRead(n);
+        throttleTransfer(n, &m_cancelRequested);
+        timer.start();
+        qint64 written = file.write(buf, n);
+        recordOperation(OperationWrite, timer.nsecsElapsed(), written != n);
+        if (written > 0)
+            recordBytesWritten(written);
+        if (written != n) {
+            remoteFile->close();
             file.close();
             LOG_ERROR("SmbWorker: 写入文件失败");
-            emit finished(false, QObject::tr("写入文件失败"));
-            return;
+            *error = QObject::tr("写入文件失败");
+            return CopyFailed;
         }
         received += n;
-        emit progress(received, total);
+        emitProgress(received, total);
     }
 
-    remoteFile.close();
+    remoteFile->close();
     file.close();
 
-    if (m_cancelRequested) {
-        emit finished(false, QObject::tr("用户取消"));
-    } else {
-        emit finished(true, QString());
+    return m_cancelRequested ? CopyCancelled : CopySucceeded;
+}
+
+SmbWorker::CopyResult SmbWorker::replaceFile(const QString &remoteUrl, const QString &filePath,
+                                             qint64 knownSize, qint64 remoteModified, QString *error)
+{
+    // 目录中的子文件先写入临时文件，完整下载后再替换旧文件，
+    // 并把修改时间设为远程时间，下次同步据此判断是否变化。
+    // 临时文件名对应远程的大小和修改时间，只续传同一版本的部分文件；
+    // 服务器未提供修改时间时无法确认版本，从头下载
+    QString partPath = partialDownloadPath(filePath, knownSize, remoteModified);
+    if (remoteModified <= 0)
+        QFile::remove(partPath);
+    CopyResult result = copyFile(remoteUrl, partPath, knownSize, error);
+    if (result != CopySucceeded)
+        return result;
+
+    if (QFile::exists(filePath) && !QFile::remove(filePath)) {
+        *error = QObject::tr("无法替换本地文件");
+        return CopyFailed;
+    }
+    if (!QFile::rename(partPath, filePath)) {
+        *error = QObject::tr("无法重命名临时文件");
+        return CopyFailed;
     }
+
+    if (remoteModified > 0) {
+        QFile file(filePath);
+        if (file.open(QIODevice::Append)) {
+            file.setFileTime(QDateTime::fromMSecsSinceEpoch(remoteModified),
+                             QFileDevice::FileModificationTime);
+            file.close();
+        }
+    }
+    return CopySucceeded;
 }
 
+void SmbWorker::emitProgress(qint64 received, qint64 total)
+{
+    // 目录任务汇报整棵树的累计进度：已完成的子文件加上正在下载的部分，
+    // 失败的子文件没有传输数据，不计入，否则会被当作吞吐的突增
+    if (m_job)
+        emit progress(m_job->completedBytes() + received, m_job->totalBytes());
+    else
+        emit progress(received, total);
+}
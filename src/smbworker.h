@@ -3,8 +3,10 @@
 
 #include <QThread>
 #include <QString>
+#include <QSharedPointer>
 
 class DownloadTask;
+class DirectoryJob;
 
 class SmbWorker : public QThread
 {
@@ -24,7 +26,26 @@ protected:
     void run() override;
 
 private:
-    DownloadTask *m_task;
+    enum CopyResult {
+        CopySucceeded,
+        CopyFailed,
+        CopyCancelled
+    };
+
+    void runFile();
+    void runDirectory();
+    CopyResult copyFile(const QString &remoteUrl, const QString &filePath,
+                        qint64 knownSize, QString *error);
+    CopyResult replaceFile(const QString &remoteUrl, const QString &filePath,
+                           qint64 knownSize, qint64 remoteModified, QString *error);
+    void emitProgress(qint64 received, qint64 total);
+
+    // 任务信息在构造时（主线程）复制一份，工作线程不再访问 DownloadTask
+    bool m_hasTask;
+    QString m_url;
+    QString m_savePath;
+    qint64 m_totalSize;
+    QSharedPointer<DirectoryJob> m_job;
     bool m_pauseRequested;
     bool m_cancelRequested;
     qint64 m_offset;
@@ -0,0 +1,26 @@
+#include "sourcedevice.h"
+#include <QFile>
+#include <QMutex>
+
+namespace {
+QMutex s_factoryMutex;
+SourceDeviceFactory s_factory;
+}
+
+QIODevice *createSourceDevice(const QString &path)
+{
+    SourceDeviceFactory factory;
+    {
+        QMutexLocker locker(&s_factoryMutex);
+        factory = s_factory;
+    }
+    if (factory)
+        return factory(path);
+    return new QFile(path);
+}
+
+void setSourceDeviceFactory(const SourceDeviceFactory &factory)
+{
+    QMutexLocker locker(&s_factoryMutex);
+    s_factory = factory;
+}
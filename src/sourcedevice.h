@@ -0,0 +1,19 @@
+#ifndef SOURCEDEVICE_H
+#define SOURCEDEVICE_H
+
+#include <QIODevice>
+#include <QString>
+#include <functional>
+
+// 传输的读取端：SmbWorker 通过这里为远程文件创建只读设备（未打开）。
+// 默认是直接打开本机路径的 QFile；测试和基准可换成模拟设备，
+// 在本地磁盘上重现共享的延迟、带宽和读取错误。
+typedef std::function<QIODevice *(const QString &path)> SourceDeviceFactory;
+
+// path 为 toUncPath 转换后的本机路径，调用方负责删除返回的设备
+QIODevice *createSourceDevice(const QString &path);
+
+// 应在开始传输之前设置，传入空函数恢复默认
+void setSourceDeviceFactory(const SourceDeviceFactory &factory);
+
+#endif // SOURCEDEVICE_H
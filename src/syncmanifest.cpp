@@ -0,0 +1,185 @@
+#include "syncmanifest.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <algorithm>
+#include "logger.h"
+#include "pathutils.h"
+
+namespace {
+const quint32 kManifestMagic = 0x44414D46; // "DAMF"
+const quint16 kManifestVersion = 2;
+
+bool entryLess(const SyncManifest::Entry &a, const SyncManifest::Entry &b)
+{
+    return a.path < b.path;
+}
+
+QString normalizedRoot(const QString &rootUrl)
+{
+    QString root = toUncPath(rootUrl);
+    while (root.endsWith('\\') || root.endsWith('/'))
+        root.chop(1);
+    return root.toLower();
+}
+}
+
+SyncManifest::SyncManifest(const QString &rootUrl, const QString &localRoot,
+                           const QString &filterText)
+    : m_rootUrl(normalizedRoot(rootUrl))
+    , m_localRoot(QDir::cleanPath(localRoot))
+    , m_filterText(filterText)
+{
+}
+
+QString SyncManifest::filePath() const
+{
+    QByteArray key = QCryptographicHash::hash(m_rootUrl.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return dataDirectory() + "/manifests/" + QString::fromLatin1(key) + ".manifest";
+}
+
+bool SyncManifest::load()
+{
+    m_previous.clear();
+
+    QFile file(filePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QByteArray data = file.readAll();
+    file.close();
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_12);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    QString rootUrl;
+    QString localRoot;
+    QString filterText;
+    quint32 count = 0;
+    in >> magic >> version >> rootUrl >> localRoot >> filterText >> count;
+    if (magic != kManifestMagic || version != kManifestVersion || in.status() != QDataStream::Ok) {
+        LOG_WARNING(QString("清单文件格式无效: %1").arg(filePath()));
+        return false;
+    }
+
+    // 本地目标目录或过滤规则变化后上一次的记录不再可信，按全量扫描处理
+    if (rootUrl != m_rootUrl || localRoot != m_localRoot || filterText != m_filterText) {
+        LOG_INFO(QString("清单与当前目录不匹配，执行全量扫描: %1").arg(m_rootUrl));
+        return false;
+    }
+
+    // 路径按排序后的前缀压缩存储：共享前缀长度 + 剩余部分
+    m_previous.reserve(static_cast<int>(count));
+    QString lastPath;
+    for (quint32 i = 0; i < count; ++i) {
+        quint16 shared = 0;
+        QString suffix;
+        Entry entry;
+        in >> shared >> suffix >> entry.size >> entry.modified >> entry.flags;
+        if (in.status() != QDataStream::Ok || shared > lastPath.size()) {
+            LOG_WARNING(QString("清单文件已损坏: %1").arg(filePath()));
+            m_previous.clear();
+            return false;
+        }
+        entry.path = lastPath.left(shared) + suffix;
+        lastPath = entry.path;
+        m_previous.append(entry);
+    }
+
+    LOG_INFO(QString("已加载清单 %1 条 - %2").arg(m_previous.size()).arg(m_rootUrl));
+    return true;
+}
+
+bool SyncManifest::save()
+{
+    QMutexLocker locker(&m_currentMutex);
+    std::sort(m_current.begin(), m_current.end(), entryLess);
+
+    QDir().mkpath(QFileInfo(filePath()).absolutePath());
+    QSaveFile file(filePath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        LOG_ERROR(QString("无法写入清单文件: %1").arg(filePath()));
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << kManifestMagic << kManifestVersion << m_rootUrl << m_localRoot << m_filterText
+        << static_cast<quint32>(m_current.size());
+
+    QString lastPath;
+    for (const Entry &entry : m_current) {
+        int shared = 0;
+        int maxShared = static_cast<int>(qMin(lastPath.size(), entry.path.size()));
+        maxShared = qMin(maxShared, 0xFFFF);
+        while (shared < maxShared && lastPath.at(shared) == entry.path.at(shared))
+            ++shared;
+        out << static_cast<quint16>(shared) << entry.path.mid(shared)
+            << entry.size << entry.modified << entry.flags;
+        lastPath = entry.path;
+    }
+
+    if (!file.commit()) {
+        LOG_ERROR(QString("保存清单文件失败: %1").arg(file.errorString()));
+        return false;
+    }
+
+    LOG_INFO(QString("已保存清单 %1 条 - %2").arg(m_current.size()).arg(m_rootUrl));
+    return true;
+}
+
+const SyncManifest::Entry *SyncManifest::previous(const QString &path) const
+{
+    Entry key;
+    key.path = path;
+    auto it = std::lower_bound(m_previous.constBegin(), m_previous.constEnd(), key, entryLess);
+    if (it != m_previous.constEnd() && it->path == path)
+        return &(*it);
+    return nullptr;
+}
+
+QVector<SyncManifest::Entry>::const_iterator SyncManifest::subtreeBegin(const QString &dirPath) const
+{
+    Entry key;
+    key.path = dirPath + '/';
+    return std::lower_bound(m_previous.constBegin(), m_previous.constEnd(), key, entryLess);
+}
+
+bool SyncManifest::isSubtreeSynced(const QString &dirPath) const
+{
+    const QString prefix = dirPath + '/';
+    for (auto it = subtreeBegin(dirPath); it != m_previous.constEnd() && it->path.startsWith(prefix); ++it) {
+        if (!(it->flags & (IsDir | Synced)))
+            return false;
+    }
+    return true;
+}
+
+void SyncManifest::carryOverSubtree(const QString &dirPath)
+{
+    const QString prefix = dirPath + '/';
+    QMutexLocker locker(&m_currentMutex);
+    for (auto it = subtreeBegin(dirPath); it != m_previous.constEnd() && it->path.startsWith(prefix); ++it)
+        m_current.append(*it);
+}
+
+void SyncManifest::record(const Entry &entry)
+{
+    QMutexLocker locker(&m_currentMutex);
+    m_current.append(entry);
+}
+
+QSet<QString> SyncManifest::currentPaths()
+{
+    QMutexLocker locker(&m_currentMutex);
+    QSet<QString> paths;
+    paths.reserve(m_current.size());
+    for (const Entry &entry : m_current)
+        paths.insert(entry.path);
+    return paths;
+}
@@ -0,0 +1,62 @@
+#ifndef SYNCMANIFEST_H
+#define SYNCMANIFEST_H
+
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+// 记录某个远程根目录上一次同步时的文件清单，用于增量重新同步。
+// 每个 (服务器, 根目录) 对应 manifests 目录下的一个文件。
+// 扫描期间可由多个线程同时记录条目。
+class SyncManifest
+{
+public:
+    enum EntryFlag : quint8 {
+        IsDir = 0x01,   // 目录条目
+        Synced = 0x02   // 扫描时本地文件已完整存在
+    };
+
+    struct Entry {
+        QString path;       // 相对根目录的路径，以 '/' 分隔
+        qint64 size;
+        qint64 modified;    // 毫秒时间戳，0 表示服务器未提供
+        quint8 flags;
+    };
+
+    SyncManifest(const QString &rootUrl, const QString &localRoot,
+                 const QString &filterText = QString());
+
+    bool load();
+    bool save();
+    QString filePath() const;
+
+    // 查询上一次同步的记录，没有记录时返回 nullptr
+    const Entry *previous(const QString &path) const;
+
+    // 上一次记录中该目录下的所有条目是否都已同步
+    bool isSubtreeSynced(const QString &dirPath) const;
+    // 目录未变化时直接沿用上一次的子树记录
+    void carryOverSubtree(const QString &dirPath);
+
+    // 记录本次扫描看到的条目
+    void record(const Entry &entry);
+
+    // 本次扫描记录到的全部路径（含沿用的子树）
+    QSet<QString> currentPaths();
+
+    int previousCount() const { return m_previous.size(); }
+    int currentCount() const { return m_current.size(); }
+
+private:
+    QVector<Entry>::const_iterator subtreeBegin(const QString &dirPath) const;
+
+    QString m_rootUrl;
+    QString m_localRoot;
+    QString m_filterText;
+    QVector<Entry> m_previous;  // 按 path 排序，扫描期间只读
+    QVector<Entry> m_current;
+    QMutex m_currentMutex;
+};
+
+#endif // SYNCMANIFEST_H
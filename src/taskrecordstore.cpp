@@ -0,0 +1,245 @@
+#include "taskrecordstore.h"
+#include "directoryjob.h"
+#include "downloadtask.h"
+#include "concurrencycontroller.h"
+
+static_assert(DownloadTask::Cancelled + 1 == 7, "TaskRecordStore::StatusCount 需要与 DownloadTask::Status 一致");
+
+TaskRecord::TaskRecord()
+    : urlDir(0)
+    , savePath(0)
+    , downloadedSize(0)
+    , totalSize(0)
+    , endTime(0)
+    , remoteModified(0)
+    , status(DownloadTask::Pending)
+    , priority(0)
+    , supportsResume(false)
+    , live(false)
+{
+}
+
+TaskRecordStore::TaskRecordStore()
+    : m_remainingBytes(0)
+    , m_unknownSizeCount(0)
+{
+}
+
+TaskHandle TaskRecordStore::insert(const TaskRecord &record, const QString &url, const QString &savePath)
+{
+    TaskHandle handle;
+    if (!m_freeSlots.isEmpty()) {
+        handle = m_freeSlots.takeLast();
+        m_records[handle] = record;
+    } else {
+        handle = static_cast<TaskHandle>(m_records.size());
+        m_records.append(record);
+    }
+
+    TaskRecord &stored = m_records[handle];
+    int nameStart = PathInterner::nameStart(url);
+    stored.urlDir = m_paths.acquire(url.left(nameStart));
+    stored.urlName = url.mid(nameStart);
+    stored.savePath = m_paths.acquire(savePath);
+    setFileName(stored, stored.fileName);
+    stored.live = true;
+    m_byId.insert(stored.id, handle);
+    m_byStatus[stored.status].insert(handle);
+    if (stored.status == DownloadTask::Pending)
+        indexPending(handle, true);
+    if (stored.directoryJob)
+        m_directories.insert(handle);
+    countRemaining(stored, 1);
+    return handle;
+}
+
+void TaskRecordStore::remove(TaskHandle handle)
+{
+    if (!contains(handle))
+        return;
+
+    TaskRecord &record = m_records[handle];
+    record.live = false;
+    m_byId.remove(record.id);
+    m_byStatus[record.status].remove(handle);
+    if (record.status == DownloadTask::Pending)
+        indexPending(handle, false);
+    m_directories.remove(handle);
+    countRemaining(record, -1);
+}
+
+void TaskRecordStore::recycle(TaskHandle handle)
+{
+    if (handle >= static_cast<TaskHandle>(m_records.size()) || m_records.at(handle).live)
+        return;
+
+    // 释放路径引用、字符串和目录任务，槽位留给下一个新任务
+    m_paths.release(m_records.at(handle).urlDir);
+    m_paths.release(m_records.at(handle).savePath);
+    m_records[handle] = TaskRecord();
+    m_freeSlots.append(handle);
+}
+
+void TaskRecordStore::clear()
+{
+    m_records.clear();
+    m_freeSlots.clear();
+    m_byId.clear();
+    for (QSet<TaskHandle> &handles : m_byStatus)
+        handles.clear();
+    m_pendingByServer.clear();
+    m_directories.clear();
+    m_remainingBytes = 0;
+    m_unknownSizeCount = 0;
+    m_paths.clear();
+}
+
+bool TaskRecordStore::contains(TaskHandle handle) const
+{
+    return handle < static_cast<TaskHandle>(m_records.size()) && m_records.at(handle).live;
+}
+
+TaskHandle TaskRecordStore::find(const QString &taskId) const
+{
+    if (taskId.isEmpty())
+        return InvalidTaskHandle;
+    return find(QUuid::fromString(taskId));
+}
+
+TaskHandle TaskRecordStore::find(const QUuid &taskId) const
+{
+    if (taskId.isNull())
+        return InvalidTaskHandle;
+    return m_byId.value(taskId, InvalidTaskHandle);
+}
+
+void TaskRecordStore::setStatus(TaskHandle handle, int status)
+{
+    TaskRecord &record = m_records[handle];
+    if (record.status == status)
+        return;
+    if (record.live) {
+        m_byStatus[record.status].remove(handle);
+        m_byStatus[status].insert(handle);
+        if (record.status == DownloadTask::Pending)
+            indexPending(handle, false);
+    }
+    record.status = static_cast<quint8>(status);
+    if (record.live && status == DownloadTask::Pending)
+        indexPending(handle, true);
+}
+
+void TaskRecordStore::setPriority(TaskHandle handle, int priority)
+{
+    TaskRecord &record = m_records[handle];
+    priority = qBound(-128, priority, 127);
+    if (record.priority == priority)
+        return;
+    bool pending = record.live && record.status == DownloadTask::Pending;
+    if (pending)
+        indexPending(handle, false);
+    record.priority = static_cast<qint8>(priority);
+    if (pending)
+        indexPending(handle, true);
+}
+
+void TaskRecordStore::setDownloadedSize(TaskHandle handle, qint64 size)
+{
+    TaskRecord &record = m_records[handle];
+    if (record.live)
+        countRemaining(record, -1);
+    record.downloadedSize = size;
+    if (record.live)
+        countRemaining(record, 1);
+}
+
+void TaskRecordStore::setTotalSize(TaskHandle handle, qint64 size)
+{
+    TaskRecord &record = m_records[handle];
+    if (record.live)
+        countRemaining(record, -1);
+    record.totalSize = size;
+    if (record.live)
+        countRemaining(record, 1);
+}
+
+qint64 TaskRecordStore::remainingBytes(const TaskRecord &record)
+{
+    // 大小未知时记为 0，磁盘预留和剩余合计都在传输中得到总大小后再更新
+    return record.totalSize > 0 ? qMax<qint64>(0, record.totalSize - record.downloadedSize) : 0;
+}
+
+void TaskRecordStore::countRemaining(const TaskRecord &record, int sign)
+{
+    m_remainingBytes += sign * remainingBytes(record);
+    if (record.totalSize <= 0)
+        m_unknownSizeCount += sign;
+}
+
+QStringList TaskRecordStore::pendingServers() const
+{
+    return m_pendingByServer.keys();
+}
+
+TaskHandle TaskRecordStore::nextPending(const QString &server) const
+{
+    auto it = m_pendingByServer.constFind(server);
+    if (it == m_pendingByServer.constEnd() || it->isEmpty())
+        return InvalidTaskHandle;
+    return *it->last().cbegin();
+}
+
+void TaskRecordStore::indexPending(TaskHandle handle, bool pending)
+{
+    const TaskRecord &record = m_records.at(handle);
+    QString server = ConcurrencyController::serverOf(url(record));
+    int priority = record.priority;
+    if (pending) {
+        m_pendingByServer[server][priority].insert(handle);
+        return;
+    }
+    auto serverIt = m_pendingByServer.find(server);
+    if (serverIt == m_pendingByServer.end())
+        return;
+    auto it = serverIt->find(priority);
+    if (it == serverIt->end())
+        return;
+    it->remove(handle);
+    if (it->isEmpty())
+        serverIt->erase(it);
+    if (serverIt->isEmpty())
+        m_pendingByServer.erase(serverIt);
+}
+
+QString TaskRecordStore::url(const TaskRecord &record) const
+{
+    return m_paths.path(record.urlDir) + record.urlName;
+}
+
+void TaskRecordStore::setUrl(TaskRecord &record, const QString &url)
+{
+    // 等待中的任务换了地址可能换了服务器，重新放入对应的等待索引
+    TaskHandle handle = record.live && record.status == DownloadTask::Pending
+                        ? m_byId.value(record.id, InvalidTaskHandle) : InvalidTaskHandle;
+    if (handle != InvalidTaskHandle)
+        indexPending(handle, false);
+    int nameStart = PathInterner::nameStart(url);
+    quint32 oldDir = record.urlDir;
+    record.urlDir = m_paths.acquire(url.left(nameStart));
+    record.urlName = url.mid(nameStart);
+    m_paths.release(oldDir);
+    if (handle != InvalidTaskHandle)
+        indexPending(handle, true);
+}
+
+void TaskRecordStore::setSavePath(TaskRecord &record, const QString &path)
+{
+    quint32 oldPath = record.savePath;
+    record.savePath = m_paths.acquire(path);
+    m_paths.release(oldPath);
+}
+
+void TaskRecordStore::setFileName(TaskRecord &record, const QString &name)
+{
+    record.fileName = name == record.urlName ? record.urlName : name;
+}
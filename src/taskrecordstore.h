@@ -0,0 +1,122 @@
+#ifndef TASKRECORDSTORE_H
+#define TASKRECORDSTORE_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QUuid>
+#include <QVector>
+#include "pathinterner.h"
+
+class DirectoryJob;
+
+// 任务句柄：记录在 TaskRecordStore 中的槽位下标
+typedef quint32 TaskHandle;
+const TaskHandle InvalidTaskHandle = 0xFFFFFFFFu;
+
+// 任务的纯数据记录，不是 QObject，没有信号和日志开销。
+// 时间以毫秒时间戳保存，进度由已下载和总大小推算，速度只在下载中的外观对象上。
+// 地址拆成目录前缀编号和最后一段，保存路径整体是一个编号，字符串在 TaskRecordStore 的
+// 路径字典中，插入时才登记，通过 TaskRecordStore::url/savePath 读写。
+struct TaskRecord
+{
+    TaskRecord();
+
+    QUuid id;
+    quint32 urlDir;
+    QString urlName;
+    quint32 savePath;
+    QString fileName;           // 与 urlName 相同时共享同一份数据
+    QString errorMessage;
+    qint64 downloadedSize;
+    qint64 totalSize;
+    qint64 endTime;             // 0 表示未结束
+    qint64 remoteModified;      // 0 表示未知
+    QSharedPointer<DirectoryJob> directoryJob;
+    quint8 status;              // DownloadTask::Status
+    qint8 priority;             // 等待中的任务按优先级从高到低开始，默认 0
+    bool supportsResume;
+    bool live;                  // 仍在工作集中（移除后槽位等待复用时为 false）
+};
+
+// 内存中的任务工作集：记录连续存放在数组中，以整数句柄访问，
+// 按 ID 和按状态各有一份索引，计数和按状态遍历都不需要扫描全部记录；
+// 等待中的任务另按服务器和优先级分组，名额已满的服务器整体跳过，取下一个要开始的任务也不需要扫描。
+// 移除的记录先保留槽位，等外观对象销毁后再 recycle，避免旧指针读到新任务。
+// 不加锁，只能在主线程访问；工作线程需要的任务信息在创建工作线程时复制一份。
+class TaskRecordStore
+{
+public:
+    TaskRecordStore();
+
+    // 地址和保存路径在插入时登记到路径字典，记录回收或清空时释放
+    TaskHandle insert(const TaskRecord &record, const QString &url, const QString &savePath);
+    void remove(TaskHandle handle);
+    void recycle(TaskHandle handle);
+    void clear();
+
+    bool contains(TaskHandle handle) const;
+    TaskHandle find(const QString &taskId) const;
+    TaskHandle find(const QUuid &taskId) const;
+
+    TaskRecord &record(TaskHandle handle) { return m_records[handle]; }
+    const TaskRecord &record(TaskHandle handle) const { return m_records.at(handle); }
+
+    // 修改状态并同步更新状态索引，已移除的记录只改字段
+    void setStatus(TaskHandle handle, int status);
+    void setPriority(TaskHandle handle, int priority);
+    // 修改进度并同步更新剩余字节的合计
+    void setDownloadedSize(TaskHandle handle, qint64 size);
+    void setTotalSize(TaskHandle handle, qint64 size);
+
+    // 有等待任务的服务器（服务器名同 ConcurrencyController::serverOf）
+    QStringList pendingServers() const;
+    // 该服务器上优先级最高的等待任务，没有时返回 InvalidTaskHandle
+    TaskHandle nextPending(const QString &server) const;
+
+    // 地址和保存路径经路径字典存取，只用于已插入的记录
+    QString url(const TaskRecord &record) const;
+    void setUrl(TaskRecord &record, const QString &url);
+    QString savePath(const TaskRecord &record) const { return m_paths.path(record.savePath); }
+    void setSavePath(TaskRecord &record, const QString &path);
+    void setFileName(TaskRecord &record, const QString &name);
+    int pathCount() const { return m_paths.size(); }
+
+    int count() const { return m_byId.size(); }
+    int count(int status) const { return m_byStatus[status].size(); }
+    const QSet<TaskHandle> &withStatus(int status) const { return m_byStatus[status]; }
+    QList<TaskHandle> handles() const { return m_byId.values(); }
+
+    // 工作集中全部任务剩余的字节，随插入、移除和进度更新维护，读取时不需要遍历；
+    // 大小未知的任务不计入，unknownSizeCount() 不为 0 时只是下限
+    qint64 totalRemainingBytes() const { return m_remainingBytes; }
+    int unknownSizeCount() const { return m_unknownSizeCount; }
+    // 工作集中的目录任务，扫描未完成时合计同样只是下限
+    const QSet<TaskHandle> &directories() const { return m_directories; }
+
+    // 单个任务剩余的字节，大小未知时为 0
+    static qint64 remainingBytes(const TaskRecord &record);
+
+private:
+    enum { StatusCount = 7 };
+
+    QVector<TaskRecord> m_records;
+    PathInterner m_paths;
+    QVector<TaskHandle> m_freeSlots;
+    QHash<QUuid, TaskHandle> m_byId;
+    QSet<TaskHandle> m_byStatus[StatusCount];
+    QHash<QString, QMap<int, QSet<TaskHandle>>> m_pendingByServer;
+    QSet<TaskHandle> m_directories;
+    qint64 m_remainingBytes;
+    int m_unknownSizeCount;
+
+    void indexPending(TaskHandle handle, bool pending);
+    // 把记录计入（sign 为 1）或移出（sign 为 -1）剩余字节的合计
+    void countRemaining(const TaskRecord &record, int sign);
+};
+
+#endif // TASKRECORDSTORE_H
@@ -0,0 +1,553 @@
+#include "taskstore.h"
+#include <QCborValue>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QUuid>
+#include <QVariant>
+#include "downloadtask.h"
+#include "logger.h"
+#include "pathinterner.h"
+
+namespace {
+const int kSchemaVersion = 4;
+
+const char kFinishedStatuses[] = "(4, 5, 6)";   // Completed, Failed, Cancelled
+static_assert(DownloadTask::Completed == 4 && DownloadTask::Failed == 5 &&
+              DownloadTask::Cancelled == 6, "kFinishedStatuses 与 DownloadTask::Status 不一致");
+
+QString createTasksSql(const QString &table)
+{
+    return QString("CREATE TABLE IF NOT EXISTS %1 ("
+                   " id TEXT PRIMARY KEY NOT NULL,"
+                   " status INTEGER NOT NULL,"
+                   " end_time INTEGER NOT NULL DEFAULT 0,"
+                   " name TEXT NOT NULL DEFAULT '',"
+                   " path_id INTEGER NOT NULL DEFAULT 0,"
+                   " error TEXT NOT NULL DEFAULT '',"
+                   " data BLOB NOT NULL)").arg(table);
+}
+
+const char kPutTaskSql[] = "INSERT OR REPLACE INTO tasks (id, status, end_time, name, path_id, error, data)"
+                           " VALUES (?, ?, ?, ?, ?, ?, ?)";
+
+const char kPutEntrySql[] = "INSERT OR REPLACE INTO directory_entries"
+                            " (task_id, idx, path, size, modified, status, error)"
+                            " VALUES (?, ?, ?, ?, ?, ?, ?)";
+
+QByteArray encodeTask(const QJsonObject &task)
+{
+    return QCborValue::fromJsonValue(task).toCbor();
+}
+
+QJsonObject decodeTask(const QByteArray &data)
+{
+    return QCborValue::fromCbor(data).toJsonValue().toObject();
+}
+
+qint64 endTimeOf(const QJsonObject &task)
+{
+    QDateTime endTime = QDateTime::fromString(task["endTime"].toString(), Qt::ISODate);
+    return endTime.isValid() ? endTime.toMSecsSinceEpoch() : 0;
+}
+
+QString statusList(const QList<int> &statuses)
+{
+    QStringList values;
+    for (int status : statuses)
+        values << QString::number(status);
+    return "(" + values.join(", ") + ")";
+}
+
+// 按文件名、保存路径或错误信息模糊匹配。"%关键字%" 形式的 LIKE 无法使用索引，
+// 这几列不建索引；查询先由 (status, end_time) 索引限定到单个历史分类再逐行匹配
+QString filterClause(const QString &filter)
+{
+    if (filter.trimmed().isEmpty())
+        return QString();
+    return " AND (name LIKE ? ESCAPE '\\'"
+           " OR path_id IN (SELECT id FROM paths WHERE path LIKE ? ESCAPE '\\')"
+           " OR error LIKE ? ESCAPE '\\')";
+}
+
+void bindFilter(QSqlQuery &query, const QString &filter)
+{
+    QString text = filter.trimmed();
+    if (text.isEmpty())
+        return;
+    text.replace('\\', "\\\\").replace('%', "\\%").replace('_', "\\_");
+    QString pattern = "%" + text + "%";
+    query.addBindValue(pattern);
+    query.addBindValue(pattern);
+    query.addBindValue(pattern);
+}
+
+bool execOrLog(QSqlQuery &query)
+{
+    if (query.exec())
+        return true;
+    LOG_ERROR(QString("任务数据库操作失败: %1").arg(query.lastError().text()));
+    return false;
+}
+
+bool execOrLog(QSqlQuery &query, const QString &sql)
+{
+    if (query.exec(sql))
+        return true;
+    LOG_ERROR(QString("任务数据库操作失败: %1 - %2").arg(sql).arg(query.lastError().text()));
+    return false;
+}
+
+// 版本 4 之前目录任务的条目整体保存在任务内容中，取出并转换成逐条保存的格式
+QJsonArray takeInlineEntries(QJsonObject &task)
+{
+    QJsonArray changes;
+    QJsonObject job = task["job"].toObject();
+    if (!job.contains("entries"))
+        return changes;
+
+    QHash<int, QString> errors;
+    const QJsonArray errorArray = job.take("errors").toArray();
+    for (const QJsonValue &value : errorArray) {
+        QJsonArray record = value.toArray();
+        errors.insert(record.at(0).toInt(), record.at(1).toString());
+    }
+    const QJsonArray entries = job.take("entries").toArray();
+    for (int index = 0; index < entries.size(); ++index) {
+        QJsonArray record = entries.at(index).toArray();
+        changes.append(QJsonArray{index, record.at(0), record.at(1), record.at(2), record.at(3),
+                                  errors.value(index)});
+    }
+    task["job"] = job;
+    return changes;
+}
+
+// 旧版本的持久化格式：config.json 中保存设置和全部任务
+QJsonObject readLegacyState(const QString &configPath, bool *found)
+{
+    QFile file(configPath);
+    *found = file.open(QIODevice::ReadOnly);
+    if (!*found)
+        return QJsonObject();
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+}
+
+TaskStore::TaskStore(const QString &databasePath)
+    : m_databasePath(databasePath)
+    , m_connectionName("taskstore-" + QUuid::createUuid().toString(QUuid::WithoutBraces))
+{
+}
+
+TaskStore::~TaskStore()
+{
+    {
+        QSqlDatabase db = QSqlDatabase::database(m_connectionName, false);
+        if (db.isOpen())
+            db.close();
+    }
+    QSqlDatabase::removeDatabase(m_connectionName);
+}
+
+QSqlDatabase TaskStore::database() const
+{
+    return QSqlDatabase::database(m_connectionName, false);
+}
+
+bool TaskStore::open()
+{
+    if (database().isOpen())
+        return true;
+
+    QDir().mkpath(QFileInfo(m_databasePath).absolutePath());
+    QSqlDatabase db = QSqlDatabase::contains(m_connectionName)
+                          ? QSqlDatabase::database(m_connectionName, false)
+                          : QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+    db.setDatabaseName(m_databasePath);
+    if (!db.open()) {
+        LOG_ERROR(QString("无法打开任务数据库: %1 - %2").arg(m_databasePath).arg(db.lastError().text()));
+        return false;
+    }
+
+    // WAL：每次提交只追加到日志并落盘，由 SQLite 在后台合并回主文件
+    QSqlQuery query(db);
+    execOrLog(query, "PRAGMA journal_mode=WAL");
+    execOrLog(query, "PRAGMA synchronous=FULL");
+
+    int version = 0;
+    if (execOrLog(query, "PRAGMA user_version") && query.next())
+        version = query.value(0).toInt();
+
+    if (!execOrLog(query, createTasksSql("tasks"))
+        || !execOrLog(query, "CREATE TABLE IF NOT EXISTS paths ("
+                             " id INTEGER PRIMARY KEY,"
+                             " path TEXT NOT NULL UNIQUE)")
+        || !execOrLog(query, "CREATE TABLE IF NOT EXISTS directory_entries ("
+                             " task_id TEXT NOT NULL,"
+                             " idx INTEGER NOT NULL,"
+                             " path TEXT NOT NULL,"
+                             " size INTEGER NOT NULL,"
+                             " modified INTEGER NOT NULL,"
+                             " status INTEGER NOT NULL,"
+                             " error TEXT NOT NULL DEFAULT '',"
+                             " PRIMARY KEY (task_id, idx))")
+        || !execOrLog(query, "CREATE TABLE IF NOT EXISTS settings ("
+                             " key TEXT PRIMARY KEY NOT NULL,"
+                             " value BLOB NOT NULL)")) {
+        return false;
+    }
+
+    m_pathIds.clear();
+    m_paths.clear();
+    query.setForwardOnly(true);
+    if (!execOrLog(query, "SELECT id, path FROM paths"))
+        return false;
+    while (query.next()) {
+        qint64 id = query.value(0).toLongLong();
+        QString path = query.value(1).toString();
+        m_pathIds.insert(path, id);
+        m_paths.insert(id, path);
+    }
+
+    if (version >= 1 && version < kSchemaVersion && !upgradeSchema(version))
+        return false;
+
+    // 历史按状态分页并按结束时间排序，(status, end_time) 可直接走索引
+    if (!execOrLog(query, "DROP INDEX IF EXISTS tasks_status")
+        || !execOrLog(query, "CREATE INDEX IF NOT EXISTS tasks_status_end ON tasks(status, end_time)")
+        || !execOrLog(query, "CREATE INDEX IF NOT EXISTS tasks_end_time ON tasks(end_time)")) {
+        return false;
+    }
+    execOrLog(query, QString("PRAGMA user_version=%1").arg(kSchemaVersion));
+    return true;
+}
+
+bool TaskStore::upgradeSchema(int version)
+{
+    // 版本 1 没有用于筛选的列；版本 2 每行保存完整路径。
+    // 两者都按当前结构重建表（DROP COLUMN 需要 SQLite 3.35，不能依赖），
+    // 再从任务内容重新写入，路径改为引用 paths 表；
+    // 版本 3 及以前目录任务的条目在任务内容中，重新写入时移到条目表。整个升级在一个事务中完成
+    QSqlDatabase db = database();
+    db.transaction();
+    QSqlQuery query(db);
+    bool ok = true;
+    if (version < 3) {
+        ok = execOrLog(query, "DROP TABLE IF EXISTS tasks_new")
+             && execOrLog(query, createTasksSql("tasks_new"))
+             && execOrLog(query, "INSERT INTO tasks_new (id, status, end_time, data)"
+                                 " SELECT id, status, end_time, data FROM tasks")
+             && execOrLog(query, "DROP TABLE tasks")
+             && execOrLog(query, "ALTER TABLE tasks_new RENAME TO tasks");
+    }
+
+    QList<QJsonObject> tasks;
+    query.setForwardOnly(true);
+    ok = ok && execOrLog(query, "SELECT data FROM tasks");
+    while (ok && query.next())
+        tasks.append(expandTask(decodeTask(query.value(0).toByteArray())));
+    query.finish();
+
+    QSqlQuery put(db);
+    ok = ok && put.prepare(kPutTaskSql);
+    for (QJsonObject &task : tasks) {
+        if (!ok)
+            break;
+        QJsonArray entries = takeInlineEntries(task);
+        bindTask(put, task);
+        ok = execOrLog(put) && putEntries(task["id"].toString(), entries);
+    }
+    ok = ok && execOrLog(query, QString("PRAGMA user_version=%1").arg(kSchemaVersion));
+
+    if (!ok || !db.commit()) {
+        db.rollback();
+        m_pathIds.clear();
+        m_paths.clear();
+        LOG_ERROR(QString("任务数据库从版本 %1 升级失败").arg(version));
+        return false;
+    }
+
+    LOG_INFO(QString("任务数据库已从版本 %1 升级，共 %2 个任务，%3 个不同路径")
+             .arg(version).arg(tasks.size()).arg(m_paths.size()));
+    return true;
+}
+
+qint64 TaskStore::internPath(const QString &path)
+{
+    if (path.isEmpty())
+        return 0;
+    auto it = m_pathIds.constFind(path);
+    if (it != m_pathIds.constEnd())
+        return it.value();
+
+    QSqlQuery query(database());
+    query.prepare("INSERT INTO paths (path) VALUES (?)");
+    query.addBindValue(path);
+    if (!execOrLog(query))
+        return -1;
+    qint64 id = query.lastInsertId().toLongLong();
+    m_pathIds.insert(path, id);
+    m_paths.insert(id, path);
+    return id;
+}
+
+QJsonObject TaskStore::compactTask(const QJsonObject &task)
+{
+    // 地址拆成目录编号和最后一段，保存路径换成编号；与最后一段相同的文件名不再重复保存
+    QJsonObject compact = task;
+    QString url = compact.take("url").toString();
+    QString savePath = compact.take("savePath").toString();
+    int nameStart = PathInterner::nameStart(url);
+    qint64 urlDir = internPath(url.left(nameStart));
+    qint64 saveDir = internPath(savePath);
+    if (urlDir < 0 || saveDir < 0)
+        return task;
+
+    QString urlName = url.mid(nameStart);
+    compact["urlDir"] = urlDir;
+    compact["urlName"] = urlName;
+    compact["saveDir"] = saveDir;
+    if (compact["fileName"].toString() == urlName)
+        compact.remove("fileName");
+    return compact;
+}
+
+QJsonObject TaskStore::expandTask(const QJsonObject &compact) const
+{
+    if (!compact.contains("urlDir"))
+        return compact;
+
+    QJsonObject task = compact;
+    QString urlName = task.take("urlName").toString();
+    task["url"] = m_paths.value(task.take("urlDir").toVariant().toLongLong()) + urlName;
+    task["savePath"] = m_paths.value(task.take("saveDir").toVariant().toLongLong());
+    if (!task.contains("fileName"))
+        task["fileName"] = urlName;
+    return task;
+}
+
+void TaskStore::bindTask(QSqlQuery &query, const QJsonObject &task)
+{
+    // 条目的变化写入条目表，不进入任务内容
+    QJsonObject compact = compactTask(task);
+    compact.remove("entryChanges");
+    query.bindValue(0, task["id"].toString());
+    query.bindValue(1, task["status"].toInt());
+    query.bindValue(2, endTimeOf(task));
+    query.bindValue(3, task["fileName"].toString());
+    query.bindValue(4, compact["saveDir"].toVariant().toLongLong());
+    query.bindValue(5, task["errorMessage"].toString());
+    query.bindValue(6, encodeTask(compact));
+}
+
+bool TaskStore::importLegacy(const QString &configPath)
+{
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+    if (!execOrLog(query, "SELECT (SELECT COUNT(*) FROM tasks) + (SELECT COUNT(*) FROM settings)")
+        || !query.next() || query.value(0).toInt() > 0) {
+        return false;
+    }
+
+    bool found = false;
+    QJsonObject state = readLegacyState(configPath, &found);
+    if (!found)
+        return false;
+
+    QList<QJsonObject> tasks;
+    const QJsonArray array = state.take("tasks").toArray();
+    tasks.reserve(array.size());
+    for (const QJsonValue &value : array) {
+        QJsonObject task = value.toObject();
+        QJsonArray entries = takeInlineEntries(task);
+        if (!entries.isEmpty())
+            task["entryChanges"] = entries;
+        tasks.append(task);
+    }
+
+    putTasks(tasks);
+    putSettings(state);
+
+    // 旧文件改名保留，避免下次启动重复导入
+    QFile::remove(configPath + ".bak");
+    QFile::rename(configPath, configPath + ".bak");
+
+    LOG_INFO(QString("已从 %1 导入 %2 个任务").arg(configPath).arg(tasks.size()));
+    return true;
+}
+
+bool TaskStore::putEntries(const QString &taskId, const QJsonArray &changes)
+{
+    if (changes.isEmpty())
+        return true;
+
+    QSqlQuery query(database());
+    query.prepare(kPutEntrySql);
+    for (const QJsonValue &value : changes) {
+        QJsonArray record = value.toArray();
+        query.bindValue(0, taskId);
+        query.bindValue(1, record.at(0).toInt());
+        query.bindValue(2, record.at(1).toString());
+        query.bindValue(3, record.at(2).toVariant().toLongLong());
+        query.bindValue(4, record.at(3).toVariant().toLongLong());
+        query.bindValue(5, record.at(4).toInt());
+        query.bindValue(6, record.at(5).toString());
+        if (!execOrLog(query))
+            return false;
+    }
+    return true;
+}
+
+void TaskStore::loadEntries(QJsonObject &task) const
+{
+    // 还原成 DirectoryJob::fromJson 读取的格式，条目按序号连续保存
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    query.prepare("SELECT idx, path, size, modified, status, error FROM directory_entries"
+                  " WHERE task_id = ? ORDER BY idx");
+    query.addBindValue(task["id"].toString());
+    if (!execOrLog(query))
+        return;
+
+    QJsonArray entries;
+    QJsonArray errors;
+    while (query.next()) {
+        int index = query.value(0).toInt();
+        entries.append(QJsonArray{query.value(1).toString(), query.value(2).toLongLong(),
+                                  query.value(3).toLongLong(), query.value(4).toInt()});
+        QString error = query.value(5).toString();
+        if (!error.isEmpty())
+            errors.append(QJsonArray{index, error});
+    }
+    QJsonObject job = task["job"].toObject();
+    job["entries"] = entries;
+    job["errors"] = errors;
+    task["job"] = job;
+}
+
+void TaskStore::putTask(const QJsonObject &task)
+{
+    // 任务行和变化的条目在同一个事务中写入
+    QJsonArray changes = task["entryChanges"].toArray();
+    QSqlDatabase db = database();
+    if (!changes.isEmpty())
+        db.transaction();
+    QSqlQuery query(db);
+    query.prepare(kPutTaskSql);
+    bindTask(query, task);
+    execOrLog(query);
+    if (!changes.isEmpty()) {
+        putEntries(task["id"].toString(), changes);
+        db.commit();
+    }
+}
+
+void TaskStore::putTasks(const QList<QJsonObject> &tasks)
+{
+    QSqlDatabase db = database();
+    db.transaction();
+    QSqlQuery query(db);
+    query.prepare(kPutTaskSql);
+    for (const QJsonObject &task : tasks) {
+        bindTask(query, task);
+        execOrLog(query);
+        putEntries(task["id"].toString(), task["entryChanges"].toArray());
+    }
+    db.commit();
+}
+
+int TaskStore::removeTask(const QString &taskId)
+{
+    QSqlQuery query(database());
+    query.prepare("SELECT status FROM tasks WHERE id = ?");
+    query.addBindValue(taskId);
+    if (!execOrLog(query) || !query.next())
+        return -1;
+    int status = query.value(0).toInt();
+
+    query.prepare("DELETE FROM directory_entries WHERE task_id = ?");
+    query.addBindValue(taskId);
+    execOrLog(query);
+
+    query.prepare("DELETE FROM tasks WHERE id = ?");
+    query.addBindValue(taskId);
+    return execOrLog(query) ? status : -1;
+}
+
+int TaskStore::removeTasks(const QList<int> &statuses)
+{
+    QSqlQuery query(database());
+    execOrLog(query, QString("DELETE FROM directory_entries WHERE task_id IN"
+                             " (SELECT id FROM tasks WHERE status IN %1)").arg(statusList(statuses)));
+    if (!execOrLog(query, QString("DELETE FROM tasks WHERE status IN %1").arg(statusList(statuses))))
+        return 0;
+    return query.numRowsAffected();
+}
+
+QJsonObject TaskStore::settings() const
+{
+    QSqlQuery query(database());
+    query.prepare("SELECT value FROM settings WHERE key = 'settings'");
+    if (!execOrLog(query) || !query.next())
+        return QJsonObject();
+    return QJsonDocument::fromJson(query.value(0).toByteArray()).object();
+}
+
+void TaskStore::putSettings(const QJsonObject &settings)
+{
+    QSqlQuery query(database());
+    query.prepare("INSERT OR REPLACE INTO settings (key, value) VALUES ('settings', ?)");
+    query.addBindValue(QJsonDocument(settings).toJson(QJsonDocument::Compact));
+    execOrLog(query);
+}
+
+QList<QJsonObject> TaskStore::activeTasks() const
+{
+    QList<QJsonObject> tasks;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    if (!execOrLog(query, QString("SELECT data FROM tasks WHERE status NOT IN %1").arg(kFinishedStatuses)))
+        return tasks;
+    while (query.next())
+        tasks.append(expandTask(decodeTask(query.value(0).toByteArray())));
+    for (QJsonObject &task : tasks) {
+        if (task["kind"].toString() == "directory")
+            loadEntries(task);
+    }
+    return tasks;
+}
+
+QList<QJsonObject> TaskStore::finishedTasks(const QList<int> &statuses, const QString &filter,
+                                            int offset, int limit) const
+{
+    QList<QJsonObject> tasks;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT data FROM tasks WHERE status IN %1%2"
+                          " ORDER BY end_time DESC LIMIT ? OFFSET ?")
+                      .arg(statusList(statuses), filterClause(filter)));
+    bindFilter(query, filter);
+    query.addBindValue(limit);
+    query.addBindValue(offset);
+    if (!execOrLog(query))
+        return tasks;
+    while (query.next())
+        tasks.append(expandTask(decodeTask(query.value(0).toByteArray())));
+    return tasks;
+}
+
+int TaskStore::finishedCount(const QList<int> &statuses, const QString &filter) const
+{
+    QSqlQuery query(database());
+    query.prepare(QString("SELECT COUNT(*) FROM tasks WHERE status IN %1%2")
+                      .arg(statusList(statuses), filterClause(filter)));
+    bindFilter(query, filter);
+    if (!execOrLog(query) || !query.next())
+        return 0;
+    return query.value(0).toInt();
+}
@@ -0,0 +1,64 @@
+#ifndef TASKSTORE_H
+#define TASKSTORE_H
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+
+// 任务的磁盘存储，基于 SQLite（WAL 模式）。
+// 每个任务一行，按状态和结束时间建索引：启动时只读取未结束的任务，
+// 历史记录按需分页查询，启动耗时不随历史数量增长。
+// 任务内容以 CBOR 二进制保存，状态、结束时间和用于筛选的名称、路径、错误信息单独成列。
+// 地址的目录前缀和保存路径只在 paths 表中保存一次，任务中记录其编号；
+// 对外的任务 JSON 仍是完整的 url 和 savePath，读写时在这里转换。
+// 目录任务的子条目单独存在 directory_entries 表中，按任务 ID 和条目序号逐条更新，
+// 暂停、失败等状态变化不需要重写整个条目列表。
+class TaskStore
+{
+public:
+    explicit TaskStore(const QString &databasePath);
+    ~TaskStore();
+
+    bool open();
+
+    // 数据库为空时导入旧版 config.json，导入后旧文件改名保留
+    bool importLegacy(const QString &configPath);
+
+    // 任务中的 entryChanges 是目录任务变化的条目（见 DirectoryJob::takeChangedEntries）
+    void putTask(const QJsonObject &task);
+    void putTasks(const QList<QJsonObject> &tasks);
+    // 返回被删除任务的状态，任务不存在时返回 -1
+    int removeTask(const QString &taskId);
+    int removeTasks(const QList<int> &statuses);
+
+    QJsonObject settings() const;
+    void putSettings(const QJsonObject &settings);
+
+    // 未结束的任务（等待、排队、下载中、暂停），目录任务附带全部条目
+    QList<QJsonObject> activeTasks() const;
+    // 指定状态的已结束任务，按结束时间倒序分页；filter 匹配文件名、路径或错误信息
+    QList<QJsonObject> finishedTasks(const QList<int> &statuses, const QString &filter,
+                                     int offset, int limit) const;
+    int finishedCount(const QList<int> &statuses, const QString &filter = QString()) const;
+
+private:
+    QSqlDatabase database() const;
+    bool upgradeSchema(int version);
+    qint64 internPath(const QString &path);
+    QJsonObject compactTask(const QJsonObject &task);
+    QJsonObject expandTask(const QJsonObject &compact) const;
+    void bindTask(QSqlQuery &query, const QJsonObject &task);
+    bool putEntries(const QString &taskId, const QJsonArray &changes);
+    void loadEntries(QJsonObject &task) const;
+
+    QString m_databasePath;
+    QString m_connectionName;
+    QHash<QString, qint64> m_pathIds;
+    QHash<qint64, QString> m_paths;
+};
+
+#endif // TASKSTORE_H
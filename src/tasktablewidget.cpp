@@ -1,4 +1,5 @@
 #include "tasktablewidget.h"
+#include "directoryjob.h"
 #include <QHeaderView>
 #include <QProgressBar>
 #include <QHBoxLayout>
@@ -48,7 +49,7 @@ void TaskTableWidget::addTask(DownloadTask *task)
     int row = rowCount();
     insertRow(row);
 
-    QTableWidgetItem *fileNameItem = new QTableWidgetItem(task->fileName());
+    QTableWidgetItem *fileNameItem = new QTableWidgetItem(displayName(task));
     fileNameItem->setToolTip(task->fileName());
     fileNameItem->setData(Qt::UserRole, QVariant::fromValue(static_cast<void*>(task)));
     setItem(row, 0, fileNameItem);
@@ -93,7 +94,7 @@ void TaskTableWidget::updateTask(DownloadTask *task)
     if (row < 0)
         return;
 
-    item(row,0)->setText(task->fileName());
+    item(row,0)->setText(displayName(task));
     item(row,0)->setToolTip(task->fileName());
 
     QProgressBar *progressBar = qobject_cast<QProgressBar*>(cellWidget(row,1));
@@ -109,6 +110,28 @@ void TaskTableWidget::updateTask(DownloadTask *task)
     updateOperationButtons(row, task);
 }
 
+void TaskTableWidget::updateTasks(const QSet<DownloadTask*> &tasks)
+{
+    if (tasks.isEmpty())
+        return;
+
+    for (int row = 0; row < rowCount(); ++row) {
+        QTableWidgetItem *it = item(row, 0);
+        if (!it)
+            continue;
+        DownloadTask *task = static_cast<DownloadTask*>(it->data(Qt::UserRole).value<void*>());
+        if (!tasks.contains(task))
+            continue;
+
+        QProgressBar *progressBar = qobject_cast<QProgressBar*>(cellWidget(row, 1));
+        if (progressBar)
+            progressBar->setValue(static_cast<int>(task->progress()));
+        item(row, 2)->setText(task->speedText());
+        item(row, 3)->setText(formatBytes(task->fileSize()));
+        item(row, 4)->setText(task->timeRemainingText());
+    }
+}
+
 void TaskTableWidget::createOperationButtons(int row, DownloadTask *task)
 {
     QWidget *widget = new QWidget();
@@ -199,3 +222,15 @@ QString TaskTableWidget::formatBytes(qint64 bytes) const
     else
         return QString("%1 B").arg(bytes);
 }
+
+QString TaskTableWidget::displayName(DownloadTask *task) const
+{
+    if (!task->isDirectory())
+        return task->fileName();
+
+    // 目录任务显示已处理/总文件数
+    QSharedPointer<DirectoryJob> job = task->directoryJob();
+    return QString("%1 (%2/%3)").arg(task->fileName())
+        .arg(job->completedCount() + job->failedCount())
+        .arg(job->fileCount());
+}
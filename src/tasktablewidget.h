@@ -1,6 +1,7 @@
 #ifndef TASKTABLEWIDGET_H
 #define TASKTABLEWIDGET_H
 
+#include <QSet>
 #include <QTableWidget>
 #include "downloadtask.h"
 
@@ -14,6 +15,8 @@ public:
     void addTask(DownloadTask *task);
     void removeTask(DownloadTask *task);
     void updateTask(DownloadTask *task);
+    // 一次遍历刷新多个任务所在的行
+    void updateTasks(const QSet<DownloadTask*> &tasks);
     int findTaskRow(DownloadTask *task);
 
 signals:
@@ -26,6 +29,7 @@ private:
     void createOperationButtons(int row, DownloadTask *task);
     void updateOperationButtons(int row, DownloadTask *task);
     QString formatBytes(qint64 bytes) const;
+    QString displayName(DownloadTask *task) const;
 };
 
 #endif // TASKTABLEWIDGET_H
@@ -0,0 +1,118 @@
+#include "throughputestimator.h"
+#include <QtMath>
+
+namespace {
+qint64 rateOf(qint64 bytes, qint64 elapsedMs)
+{
+    return elapsedMs > 0 ? bytes * 1000 / elapsedMs : 0;
+}
+}
+
+ThroughputEstimator::ThroughputEstimator(qint64 windowMs, qint64 stallMs)
+    : m_windowMs(windowMs)
+    , m_stallMs(stallMs)
+    , m_startTime(0)
+    , m_startBytes(0)
+    , m_lastProgress(0)
+{
+}
+
+void ThroughputEstimator::reset(qint64 now, qint64 bytes)
+{
+    m_samples.clear();
+    m_samples.append(Sample{now, bytes});
+    m_startTime = now;
+    m_startBytes = bytes;
+    m_lastProgress = now;
+}
+
+void ThroughputEstimator::addSample(qint64 now, qint64 bytes)
+{
+    if (m_samples.isEmpty()) {
+        reset(now, bytes);
+        return;
+    }
+    const Sample &last = m_samples.constLast();
+    if (now <= last.time)
+        return;
+    if (bytes > last.bytes)
+        m_lastProgress = now;
+    m_samples.append(Sample{now, bytes});
+
+    // 保留一个不晚于窗口起点的样本，使窗口速率覆盖完整的窗口
+    while (m_samples.size() > 2 && m_samples.at(1).time <= now - m_windowMs)
+        m_samples.removeFirst();
+}
+
+qint64 ThroughputEstimator::instantRate() const
+{
+    if (m_samples.size() < 2)
+        return 0;
+    const Sample &previous = m_samples.at(m_samples.size() - 2);
+    const Sample &last = m_samples.constLast();
+    return rateOf(last.bytes - previous.bytes, last.time - previous.time);
+}
+
+qint64 ThroughputEstimator::windowRate() const
+{
+    if (m_samples.size() < 2)
+        return 0;
+    const Sample &first = m_samples.constFirst();
+    const Sample &last = m_samples.constLast();
+    return rateOf(last.bytes - first.bytes, last.time - first.time);
+}
+
+qint64 ThroughputEstimator::averageRate() const
+{
+    if (m_samples.isEmpty())
+        return 0;
+    const Sample &last = m_samples.constLast();
+    return rateOf(last.bytes - m_startBytes, last.time - m_startTime);
+}
+
+bool ThroughputEstimator::isStalled() const
+{
+    if (m_samples.isEmpty())
+        return false;
+    return m_samples.constLast().time - m_lastProgress >= m_stallMs;
+}
+
+qint64 ThroughputEstimator::secondsRemaining(qint64 remainingBytes) const
+{
+    if (remainingBytes <= 0)
+        return 0;
+    qint64 speed = rate();
+    if (speed <= 0)
+        return -1;
+    return (remainingBytes + speed - 1) / speed;
+}
+
+double ThroughputEstimator::confidence() const
+{
+    if (m_samples.size() < 3 || isStalled())
+        return 0.0;
+
+    const Sample &first = m_samples.constFirst();
+    const Sample &last = m_samples.constLast();
+    double filled = qMin(1.0, static_cast<double>(last.time - first.time) / m_windowMs);
+
+    // 窗口内各段速率的变异系数越大，剩余时间越不可靠
+    double sum = 0.0;
+    double squares = 0.0;
+    int count = 0;
+    for (int i = 1; i < m_samples.size(); ++i) {
+        qint64 elapsed = m_samples.at(i).time - m_samples.at(i - 1).time;
+        if (elapsed <= 0)
+            continue;
+        double speed = (m_samples.at(i).bytes - m_samples.at(i - 1).bytes) * 1000.0 / elapsed;
+        sum += speed;
+        squares += speed * speed;
+        ++count;
+    }
+    if (count == 0 || sum <= 0.0)
+        return 0.0;
+    double mean = sum / count;
+    double variance = qMax(0.0, squares / count - mean * mean);
+    double variation = qSqrt(variance) / mean;
+    return filled / (1.0 + variation);
+}
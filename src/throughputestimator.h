@@ -0,0 +1,50 @@
+#ifndef THROUGHPUTESTIMATOR_H
+#define THROUGHPUTESTIMATOR_H
+
+#include <QList>
+#include <QtGlobal>
+
+// 按时间窗口估计传输速率和剩余时间。样本是某一时刻的累计字节数，
+// 应按固定周期采样（没有进度时也要采样），这样停滞时窗口速率会逐渐降到 0，
+// 不会一直显示停滞前的速度。
+// 剩余时间的可信度取决于窗口是否已经填满，以及窗口内各段速率的波动。
+class ThroughputEstimator
+{
+public:
+    explicit ThroughputEstimator(qint64 windowMs = 10000, qint64 stallMs = 5000);
+
+    // 重新开始估计，例如暂停后继续时，暂停期间不计入
+    void reset(qint64 now, qint64 bytes);
+    void addSample(qint64 now, qint64 bytes);
+
+    // 最近两个样本之间的速率，字节/秒
+    qint64 instantRate() const;
+    // 时间窗口内的速率
+    qint64 windowRate() const;
+    // 自开始估计以来的平均速率
+    qint64 averageRate() const;
+    // 超过 stallMs 没有任何进度
+    bool isStalled() const;
+    // 显示用的速率：停滞时为 0，否则为窗口速率
+    qint64 rate() const { return isStalled() ? 0 : windowRate(); }
+
+    // 按窗口速率估计传完 remainingBytes 需要的秒数，无法估计时返回 -1
+    qint64 secondsRemaining(qint64 remainingBytes) const;
+    // 剩余时间的可信度，0 到 1
+    double confidence() const;
+
+private:
+    struct Sample {
+        qint64 time;
+        qint64 bytes;
+    };
+
+    qint64 m_windowMs;
+    qint64 m_stallMs;
+    qint64 m_startTime;
+    qint64 m_startBytes;
+    qint64 m_lastProgress;      // 最近一次字节数增加的时间
+    QList<Sample> m_samples;    // 按时间递增，第一个样本在窗口起点或之前
+};
+
+#endif // THROUGHPUTESTIMATOR_H
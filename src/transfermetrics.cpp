@@ -0,0 +1,132 @@
+#include "transfermetrics.h"
+#include <QAtomicInteger>
+#include <QStringList>
+
+namespace {
+
+// 第 i 个桶统计不超过 2^i 微秒的操作，最后一个桶约 34 秒，更长的只计入 +Inf
+const int kBucketCount = 26;
+
+const char *const kOperationNames[OperationCount] = {"open", "seek", "read", "write"};
+
+struct Histogram {
+    QAtomicInteger<qint64> buckets[kBucketCount];   // 每个桶只计本桶，导出时再累加
+    QAtomicInteger<qint64> overflow;
+    QAtomicInteger<qint64> sumMicros;
+    QAtomicInteger<qint64> errors;
+};
+
+Histogram g_operations[OperationCount];
+QAtomicInteger<qint64> g_bytesRead;
+QAtomicInteger<qint64> g_bytesWritten;
+QAtomicInteger<qint64> g_resumed;
+QAtomicInteger<qint64> g_stalls;
+QAtomicInteger<qint64> g_activeWorkers;
+QAtomicInteger<qint64> g_bufferBytes;
+
+int bucketOf(qint64 micros)
+{
+    int bucket = 0;
+    while (bucket < kBucketCount && (Q_INT64_C(1) << bucket) < micros)
+        ++bucket;
+    return bucket;
+}
+
+} // namespace
+
+void recordOperation(TransferOperation operation, qint64 nanoseconds, bool failed)
+{
+    Histogram &histogram = g_operations[operation];
+    qint64 micros = qMax<qint64>(0, nanoseconds / 1000);
+    int bucket = bucketOf(micros);
+    if (bucket < kBucketCount)
+        histogram.buckets[bucket].fetchAndAddRelaxed(1);
+    else
+        histogram.overflow.fetchAndAddRelaxed(1);
+    histogram.sumMicros.fetchAndAddRelaxed(micros);
+    if (failed)
+        histogram.errors.fetchAndAddRelaxed(1);
+}
+
+void recordBytesRead(qint64 bytes)
+{
+    g_bytesRead.fetchAndAddRelaxed(bytes);
+}
+
+void recordBytesWritten(qint64 bytes)
+{
+    g_bytesWritten.fetchAndAddRelaxed(bytes);
+}
+
+void recordResumedTransfer()
+{
+    g_resumed.fetchAndAddRelaxed(1);
+}
+
+void recordStall()
+{
+    g_stalls.fetchAndAddRelaxed(1);
+}
+
+void adjustActiveWorkers(int delta)
+{
+    g_activeWorkers.fetchAndAddRelaxed(delta);
+}
+
+void adjustBufferBytes(qint64 delta)
+{
+    g_bufferBytes.fetchAndAddRelaxed(delta);
+}
+
+QString transferMetricsText(const QString &prefix)
+{
+    QStringList lines;
+    auto counter = [&](const QString &name, const QString &help, qint64 value) {
+        lines << QString("# HELP %1%2 %3").arg(prefix, name, help)
+              << QString("# TYPE %1%2 counter").arg(prefix, name)
+              << QString("%1%2 %3").arg(prefix, name).arg(value);
+    };
+    auto gauge = [&](const QString &name, const QString &help, qint64 value) {
+        lines << QString("# HELP %1%2 %3").arg(prefix, name, help)
+              << QString("# TYPE %1%2 gauge").arg(prefix, name)
+              << QString("%1%2 %3").arg(prefix, name).arg(value);
+    };
+
+    counter("read_bytes_total", "Bytes read from source files.", g_bytesRead.loadRelaxed());
+    counter("written_bytes_total", "Bytes written to destination files.", g_bytesWritten.loadRelaxed());
+    counter("resumed_transfers_total", "Transfers continued from an existing partial file.",
+            g_resumed.loadRelaxed());
+    counter("stalls_total", "Times a downloading task made no progress for a whole stall period.",
+            g_stalls.loadRelaxed());
+    gauge("active_workers", "Transfer worker threads currently running.", g_activeWorkers.loadRelaxed());
+    gauge("buffer_bytes", "Bytes held by copy buffers of running transfers.", g_bufferBytes.loadRelaxed());
+
+    QString errors = prefix + "operation_errors_total";
+    lines << QString("# HELP %1 Failed source and destination operations.").arg(errors)
+          << QString("# TYPE %1 counter").arg(errors);
+    for (int op = 0; op < OperationCount; ++op) {
+        lines << QString("%1{op=\"%2\"} %3").arg(errors, QLatin1String(kOperationNames[op]))
+                     .arg(g_operations[op].errors.loadRelaxed());
+    }
+
+    QString latency = prefix + "operation_duration_seconds";
+    lines << QString("# HELP %1 Duration of source and destination operations.").arg(latency)
+          << QString("# TYPE %1 histogram").arg(latency);
+    for (int op = 0; op < OperationCount; ++op) {
+        const Histogram &histogram = g_operations[op];
+        QLatin1String name(kOperationNames[op]);
+        qint64 cumulative = 0;
+        for (int bucket = 0; bucket < kBucketCount; ++bucket) {
+            cumulative += histogram.buckets[bucket].loadRelaxed();
+            double bound = static_cast<double>(Q_INT64_C(1) << bucket) / 1e6;
+            lines << QString("%1_bucket{op=\"%2\",le=\"%3\"} %4")
+                         .arg(latency, name, QString::number(bound, 'g', 6)).arg(cumulative);
+        }
+        cumulative += histogram.overflow.loadRelaxed();
+        lines << QString("%1_bucket{op=\"%2\",le=\"+Inf\"} %3").arg(latency, name).arg(cumulative)
+              << QString("%1_sum{op=\"%2\"} %3").arg(latency, name)
+                     .arg(QString::number(histogram.sumMicros.loadRelaxed() / 1e6, 'f', 6))
+              << QString("%1_count{op=\"%2\"} %3").arg(latency, name).arg(cumulative);
+    }
+    return lines.join('\n') + '\n';
+}
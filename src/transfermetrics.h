@@ -0,0 +1,35 @@
+#ifndef TRANSFERMETRICS_H
+#define TRANSFERMETRICS_H
+
+#include <QString>
+#include <QtGlobal>
+
+// 传输引擎的计数器和延迟直方图。工作线程在热路径上只做几次无锁的原子加法，
+// 导出时（MetricsExporter）再读取并格式化，读到的是各计数器近似同一时刻的值。
+// 延迟直方图按 2 的幂分桶（微秒），不需要预先知道延迟的分布。
+
+enum TransferOperation {
+    OperationOpen,      // 打开远程文件
+    OperationSeek,      // 断点续传时定位
+    OperationRead,      // 每次读取一块
+    OperationWrite,     // 每次写入一块
+    OperationCount
+};
+
+// 一次操作的耗时（纳秒）；failed 为 true 时同时计入该操作的错误次数
+void recordOperation(TransferOperation operation, qint64 nanoseconds, bool failed = false);
+void recordBytesRead(qint64 bytes);
+void recordBytesWritten(qint64 bytes);
+// 从已有的部分文件继续传输
+void recordResumedTransfer();
+// 下载中的任务整个停滞判定周期没有进度
+void recordStall();
+
+// 正在运行的工作线程数和复制缓冲区占用的字节，进入和离开时成对调用
+void adjustActiveWorkers(int delta);
+void adjustBufferBytes(qint64 delta);
+
+// Prometheus 文本格式的引擎指标，名称以 prefix 开头
+QString transferMetricsText(const QString &prefix);
+
+#endif // TRANSFERMETRICS_H
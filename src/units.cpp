@@ -0,0 +1,25 @@
+#include "units.h"
+
+bool parseBytes(QString text, qint64 *bytes)
+{
+    text = text.trimmed().toUpper();
+    if (text.endsWith('B'))
+        text.chop(1);
+
+    qint64 unit = 1;
+    if (text.endsWith('K'))
+        unit = 1024;
+    else if (text.endsWith('M'))
+        unit = 1024 * 1024;
+    else if (text.endsWith('G'))
+        unit = 1024 * 1024 * 1024;
+    if (unit > 1)
+        text.chop(1);
+
+    bool ok = false;
+    double value = text.toDouble(&ok);
+    if (!ok || value < 0)
+        return false;
+    *bytes = static_cast<qint64>(value * unit);
+    return true;
+}
@@ -0,0 +1,10 @@
+#ifndef UNITS_H
+#define UNITS_H
+
+#include <QString>
+
+// 解析带单位的字节数，如 "512"、"10K"、"1.5MB"、"2g"：单位不区分大小写，
+// 可选 B/K/KB/M/MB/G/GB，按 1024 进位；数值可以带小数，不能为负
+bool parseBytes(QString text, qint64 *bytes);
+
+#endif // UNITS_H